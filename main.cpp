@@ -1,12 +1,28 @@
 #include "httplib.h"
 #include "my_json/my_json.h"
+#include "port_scanner/gossip.h"
 #include "port_scanner/port_scanner.h"
+#include "proxy/access_log.h"
+#include "proxy/gateway_shard.h"
+#include "proxy/l4_relay.h"
+#include "proxy/route.h"
+#include "proxy/service_registry.h"
+#include "proxy/splice_relay.h"
+#include "simple_log/binary_log.h"
+#include "simple_log/log_sink.h"
 #include "simple_log/simple_log.h"
 
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
 #include <fstream>
 #include <filesystem>
 #include <format>
+#include <map>
+#include <optional>
 #include <regex>
+#include <sstream>
 
 #ifdef WIN32
 #include <Windows.h>
@@ -18,15 +34,233 @@ public:
 } chcp;
 #endif // WIN32
 
+/**
+ * ************************************************************************
+ * @brief 配置文件结构: 字段名即 JSON 键名, 由 module::from_json::from_json 整体反序列化;
+ *        JSON 缺少的键保留此处的默认值, 可选功能的段落为 std::optional, 存在即开启
+ * ************************************************************************
+ */
+// 闭区间 [begin, end]
+struct PortRangeConfig {
+    int begin{-1};
+    int end{-1};
+};
+
 // base
-static uint16_t g_base_port{}; // 基准端口
-static std::string g_host{};
-static uint16_t g_port{};
+struct BaseConfig {
+    uint16_t base_port{}; // 基准端口, 必填
+    std::string host{"0.0.0.0"};
+    uint16_t port{11000};
+};
 
 // scanner
-static uint16_t g_begin{};
-static uint16_t g_end{};
-static uint16_t g_scan_interval{5};
+struct ScannerConfig {
+    int begin{-1};                                      // 未配置 ranges 时使用 begin/end 单一区间
+    int end{-1};
+    std::optional<std::vector<PortRangeConfig>> ranges; // 扫描的端口区间
+    std::optional<int> scan_interval;                   // 兼容旧配置: 最长周期(秒)
+    std::optional<int> max_scan_interval_ms;            // 最长扫描周期, 稳定时逐轮退避至此
+    int min_scan_interval_ms{100};                      // 最短扫描周期, 变化或转发失败后使用
+    std::string shm_name{};                             // 共享内存快照名称, 空为不发布
+    std::string snapshot_path{};                        // 快照文件, 空为不持久化
+};
+
+// gateway
+struct ShardingConfig {
+    int shards{1};         // 分片数, 1 为单监听模式, 0 为每个 CPU 核一个分片
+    int worker_threads{0}; // 每个分片的工作线程数, 0 使用默认值
+    bool pin_cores{false}; // 分片线程是否绑定 CPU 核
+    int journal_size{256}; // 每个分片保留的服务变化版本数, 供 since 增量同步与 SSE 补发
+    int max_streams{0};    // httplib 路径每个分片同时挂起的长轮询与 SSE 上限, 0 为工作线程数的一半
+};
+
+// relay
+struct RelayConfig {
+    bool splice{false};            // 大响应体是否走 splice 零拷贝转发
+    int splice_min_bytes{1 << 20}; // 走零拷贝的最小响应体字节数
+};
+
+// engine
+struct EngineConfig {
+    std::string type{"httplib"}; // 分片 I/O 路径: httplib | epoll | io_uring
+    int buffers{1024};           // 注册缓冲区个数
+    int buffer_size{16 * 1024};  // 单个缓冲区字节数
+};
+
+// l4
+struct L4Config {
+    uint16_t listen_base{0};   // 每台机器的监听端口 = listen_base + machine_no, 0 不开启
+    uint16_t preamble_port{0}; // 前导路由监听端口, 0 不开启
+    int idle_timeout_sec{5};   // 两个方向都没有数据时断开, 与 HTTP 路径的读写超时一致, 秒
+};
+
+// remote.hosts: 主机的第 i 个端口(按 ports 区间顺序展开)对应服务号 machine_base + i
+struct RemoteHostConfig {
+    std::string host{};
+    int machine_base{-1};
+};
+
+// remote
+struct RemoteConfig {
+    int timeout_ms{200};                 // 单轮探测超时
+    int max_in_flight{4096};             // 同时进行中的连接数上限
+    std::vector<PortRangeConfig> ports;  // 每台主机探测的端口区间
+    std::vector<RemoteHostConfig> hosts; // 远程探测目标, key 为 base_port + machine_no
+};
+
+// unix
+struct UnixConfig {
+    std::string socket_dir{};           // Unix 域套接字目录, 其中 <port>.sock 视为服务
+    std::map<int, std::string> sockets; // 服务号 -> Unix 域套接字路径
+};
+
+// registry
+struct RegistryConfig {
+    int tick_ms{100};          // 租期检查精度
+    int default_ttl_ms{10000}; // 注册时未指定 ttl_ms 的租期
+    int max_ttl_ms{300000};    // 租期上限
+};
+
+// admin
+struct AdminConfig {
+    std::vector<std::string> allow{"127.0.0.1", "::1"}; // 可访问 /admin/* 与注册写接口的客户端, IP 或 CIDR
+};
+
+// gossip
+struct GossipConfig {
+    std::string bind{};                      // UDP 监听地址, 为空时绑定 advertise_host
+    uint16_t port{7946};                     // UDP 监听端口
+    std::string advertise_host{"127.0.0.1"}; // 其他网关访问本机的地址
+    std::vector<std::string> seeds;          // 种子节点 host:port
+    std::string secret{};                    // 集群共享密钥, 非空时报文附带 HMAC-SHA256
+    int period_ms{200};                      // 探测周期
+    int suspect_timeout_ms{2000};            // 怀疑到判定失效的时间
+};
+
+// access_log
+struct AccessLogConfig {
+    std::string path{"access.log"};                                      // 访问日志文件
+    xiunneg::AccessLog::Format format{xiunneg::AccessLog::Format::JSON}; // json 或 combined
+    int buffer_bytes{64 * 1024};                                         // 线程缓冲区写满即批量写出
+    int flush_interval_ms{1000};                                         // 未写满的缓冲区最长滞留时间
+};
+
+// log.sinks 中的一项, 按 type 取用其余字段
+struct LogSinkEntryConfig {
+    std::string type{};            // console | file | syslog
+    std::string path{};            // file
+    int buffer_bytes{0};           // file
+    std::string host{"127.0.0.1"}; // syslog
+    int port{514};                 // syslog
+    int facility{16};              // syslog
+    std::string app{"gateway"};    // syslog
+};
+
+// log
+struct LogConfig {
+    bool binary{false};                                           // 日志是否写为延迟格式化的二进制文件
+    std::string binary_path{"gateway.blog"};                      // 二进制日志文件
+    int buffer_bytes{1 << 20};                                    // 每个线程的环形缓冲区字节数
+    int flush_interval_ms{100};                                   // 后台线程取出缓冲区的周期
+    module::LogLevel level{module::LogLevel::INFO};               // 日志器默认级别
+    std::map<std::string, module::LogLevel> levels;               // 按日志器名称覆盖默认级别
+    int rotate_mb{0};                                             // 文本日志超过该大小(MB)时轮转, 0 为不按大小轮转
+    int rotate_interval_s{0};                                     // 文本日志按时间轮转的周期(秒), 0 为不按时间轮转
+    int retention{7};                                             // 每个日志器保留的历史文件数, 0 为不删除
+    bool compress{true};                                          // 历史文件是否在后台压缩为 .gz
+    std::map<std::string, LogSinkEntryConfig> sinks;              // 命名输出端, 为空时每个日志器独占一个文件
+    std::vector<std::string> default_sinks;                       // 未单独指定的日志器写入的输出端, 为空时写入全部
+    std::map<std::string, std::vector<std::string>> logger_sinks; // 按日志器名称指定输出端
+    int suppress_burst{10};                                       // 同一条逐请求错误日志每个窗口最多输出的条数, 0 为不限制
+    int suppress_window_ms{1000};                                 // 限流窗口, 窗口结束后输出被抑制的条数
+    int suppress_max_keys{1024};                                  // 每个分片同时跟踪的不同消息数
+    int info_sample_percent{100};                                 // 逐请求 info 日志的采样百分比
+};
+
+// 整个配置文件; unix 为预定义宏, 字段取名 unix_
+struct GatewayConfig {
+    BaseConfig base;
+    ScannerConfig scanner;
+    ShardingConfig gateway;
+    RelayConfig relay;
+    EngineConfig engine;
+    L4Config l4;
+    RemoteConfig remote;
+    UnixConfig unix_;
+    std::optional<RegistryConfig> registry;
+    AdminConfig admin;
+    std::optional<GossipConfig> gossip;
+    std::optional<AccessLogConfig> access_log;
+    LogConfig log;
+};
+
+static GatewayConfig g_config{};
+
+// 由 g_config 校验后展开, 直接交给各模块
+static std::vector<xiunneg::PortScanner::PortRange> g_scan_ranges;       // 扫描的端口区间
+static std::vector<xiunneg::PortScanner::RemoteTarget> g_remote_targets; // 远程探测目标
+static std::map<uint16_t, std::string> g_unix_sockets;                   // 服务端口 -> Unix 域套接字路径
+static std::map<std::string, module::LogSinkConfig> g_log_sinks;         // 命名输出端
+
+// 客户端地址规则, 前缀按地址族的位数计; IPv4 映射的 IPv6 地址按 IPv4 匹配
+struct AddressRule {
+    int family{AF_INET};
+    std::array<uint8_t, 16> bytes{};
+    int prefix{32};
+};
+static std::vector<AddressRule> g_admin_allow; // 由 admin.allow 解析
+
+static bool parse_address(const std::string &text, int &family, std::array<uint8_t, 16> &bytes) {
+    bytes.fill(0);
+    if (inet_pton(AF_INET, text.c_str(), bytes.data()) == 1) {
+        family = AF_INET;
+        return true;
+    }
+    if (inet_pton(AF_INET6, text.c_str(), bytes.data()) != 1) return false;
+    family = AF_INET6;
+    // ::ffff:a.b.c.d
+    static constexpr uint8_t kMapped[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff};
+    if (std::equal(std::begin(kMapped), std::end(kMapped), bytes.begin())) {
+        std::copy(bytes.begin() + 12, bytes.end(), bytes.begin());
+        std::fill(bytes.begin() + 4, bytes.end(), 0);
+        family = AF_INET;
+    }
+    return true;
+}
+
+// "10.0.0.0/8"、"::1" 等, 无效时抛出 std::invalid_argument
+static AddressRule parse_address_rule(const std::string &text) {
+    AddressRule rule;
+    auto slash = text.find('/');
+    if (!parse_address(text.substr(0, slash), rule.family, rule.bytes)) {
+        throw std::invalid_argument(std::format("admin.allow[{}] 不是有效的地址", text));
+    }
+    int bits = rule.family == AF_INET ? 32 : 128;
+    rule.prefix = bits;
+    if (slash != std::string::npos) {
+        auto prefix = text.substr(slash + 1);
+        auto [end, ec] = std::from_chars(prefix.data(), prefix.data() + prefix.size(), rule.prefix);
+        if (ec != std::errc{} || end != prefix.data() + prefix.size() || rule.prefix < 0 || rule.prefix > bits) {
+            throw std::invalid_argument(std::format("admin.allow[{}] 的前缀长度无效", text));
+        }
+    }
+    return rule;
+}
+
+static bool admin_allowed(const std::string &remote_addr) {
+    int family{};
+    std::array<uint8_t, 16> bytes{};
+    if (!parse_address(remote_addr, family, bytes)) return false;
+    return std::any_of(g_admin_allow.begin(), g_admin_allow.end(), [family, &bytes](const AddressRule &rule) {
+        if (rule.family != family) return false;
+        int full = rule.prefix / 8;
+        int rest = rule.prefix % 8;
+        if (!std::equal(bytes.begin(), bytes.begin() + full, rule.bytes.begin())) return false;
+        if (rest == 0) return true;
+        uint8_t mask = static_cast<uint8_t>(0xff << (8 - rest));
+        return (bytes[full] & mask) == (rule.bytes[full] & mask);
+    });
+}
 
 static inline bool load_from_json(std::string_view path) {
     bool is_error{false};
@@ -43,23 +277,189 @@ static inline bool load_from_json(std::string_view path) {
     file >> root;
 
     try {
-        // base
         if (!root.isMember("base")) {
             throw std::invalid_argument("JSON 缺少 base 结构");
         }
-        auto &base_root = root["base"];
-        g_base_port = module::from_json::get_value<int>(base_root, "base_port");
-        g_host = module::from_json::get_value_or<std::string>(base_root, "host", "0.0.0.0");
-        g_port = module::from_json::get_value_or<int>(base_root, "port", 11000);
-
-        // scanner
         if (!root.isMember("scanner")) {
             throw std::invalid_argument("JSON 缺少 scanner 结构");
         }
-        auto &scanner_root = root["scanner"];
-        g_begin = module::from_json::get_value<int>(scanner_root, "begin");
-        g_end = module::from_json::get_value<int>(scanner_root, "end");
-        g_scan_interval = module::from_json::get_value_or<int>(scanner_root, "scan_interval", 5);
+        // base_port 没有默认值
+        module::from_json::get_value<int>(root["base"], "base_port");
+        module::from_json::from_json(root, g_config);
+        const auto &base = g_config.base;
+
+        // scanner
+        auto &scanner = g_config.scanner;
+        if (!scanner.ranges) {
+            scanner.ranges = std::vector<PortRangeConfig>{{scanner.begin, scanner.end}};
+        } else if (scanner.ranges->empty()) {
+            throw std::invalid_argument("scanner.ranges 不能为空");
+        }
+        for (const auto &range : *scanner.ranges) {
+            if (range.begin < 0 || range.end > 65535 || range.end < range.begin) {
+                throw std::invalid_argument(std::format("scanner 端口区间[{}, {}] 无效", range.begin, range.end));
+            }
+            g_scan_ranges.push_back({static_cast<uint16_t>(range.begin), static_cast<uint16_t>(range.end)});
+        }
+        if (!scanner.max_scan_interval_ms) {
+            scanner.max_scan_interval_ms = scanner.scan_interval.value_or(5) * 1000;
+        }
+        if (scanner.min_scan_interval_ms <= 0 || *scanner.max_scan_interval_ms <= 0) {
+            throw std::invalid_argument(std::format("scanner 扫描周期[{}, {}]ms 须为正数", scanner.min_scan_interval_ms, *scanner.max_scan_interval_ms));
+        }
+
+        // gateway
+        if (g_config.gateway.journal_size <= 0) {
+            throw std::invalid_argument(std::format("gateway.journal_size[{}] 须为正数", g_config.gateway.journal_size));
+        }
+        if (g_config.gateway.max_streams < 0) {
+            throw std::invalid_argument(std::format("gateway.max_streams[{}] 不能为负数", g_config.gateway.max_streams));
+        }
+
+        // engine
+        const auto &engine = g_config.engine.type;
+        if (engine != "httplib" && engine != "epoll" && engine != "io_uring") {
+            throw std::invalid_argument(std::format("engine.type[{}] 无效, 可选 httplib/epoll/io_uring", engine));
+        }
+
+        // l4: 网关自己的监听端口落入扫描范围会被当作服务发现
+        const auto &l4 = g_config.l4;
+        if (l4.idle_timeout_sec <= 0) {
+            throw std::invalid_argument(std::format("l4.idle_timeout_sec[{}] 须为正数", l4.idle_timeout_sec));
+        }
+        for (const auto &service : g_scan_ranges) {
+            int listen_begin = l4.listen_base + service.begin - base.base_port;
+            int listen_end = l4.listen_base + service.end - base.base_port;
+            for (const auto &range : g_scan_ranges) {
+                if (l4.listen_base > 0 && listen_begin <= range.end && listen_end >= range.begin) {
+                    throw std::invalid_argument(std::format("l4.listen_base[{}] 对应的监听端口与扫描范围重叠", l4.listen_base));
+                }
+            }
+            if (l4.preamble_port > 0 && l4.preamble_port >= service.begin && l4.preamble_port <= service.end) {
+                throw std::invalid_argument(std::format("l4.preamble_port[{}] 落在扫描范围内", l4.preamble_port));
+            }
+        }
+
+        // remote: 按 ports 区间展开每台主机的探测目标
+        std::vector<uint16_t> remote_ports;
+        for (const auto &range : g_config.remote.ports) {
+            if (range.begin < 0 || range.end > 65535 || range.end < range.begin) {
+                throw std::invalid_argument(std::format("remote 端口区间[{}, {}] 无效", range.begin, range.end));
+            }
+            for (int port = range.begin; port <= range.end; ++port) {
+                remote_ports.push_back(static_cast<uint16_t>(port));
+            }
+        }
+        for (const auto &host : g_config.remote.hosts) {
+            if (host.host.empty()) {
+                throw std::invalid_argument("remote.hosts 的每一项须指定 host");
+            }
+            for (std::size_t i = 0; i < remote_ports.size(); ++i) {
+                int key = base.base_port + host.machine_base + static_cast<int>(i);
+                if (host.machine_base < 0 || key > 65535) {
+                    throw std::invalid_argument(std::format("remote 主机[{}] 的服务号超出范围", host.host));
+                }
+                g_remote_targets.push_back({static_cast<uint16_t>(key), {host.host, remote_ports[i]}});
+            }
+        }
+
+        // unix: 服务号换算为端口
+        for (const auto &[machine_no, socket_path] : g_config.unix_.sockets) {
+            int port = base.base_port + machine_no;
+            if (port < 0 || port > 65535) {
+                throw std::invalid_argument(std::format("unix.sockets[{}] 不是有效的服务号", machine_no));
+            }
+            g_unix_sockets[static_cast<uint16_t>(port)] = socket_path;
+        }
+
+        // registry
+        if (const auto &registry = g_config.registry) {
+            if (registry->tick_ms <= 0 || registry->default_ttl_ms <= 0 || registry->max_ttl_ms <= 0) {
+                throw std::invalid_argument("registry 的 tick_ms/default_ttl_ms/max_ttl_ms 须为正数");
+            }
+        }
+
+        // admin
+        for (const auto &text : g_config.admin.allow) {
+            g_admin_allow.push_back(parse_address_rule(text));
+        }
+
+        // access_log
+        if (const auto &access_log = g_config.access_log) {
+            if (access_log->buffer_bytes <= 0 || access_log->flush_interval_ms <= 0) {
+                throw std::invalid_argument("access_log 的 buffer_bytes/flush_interval_ms 须为正数");
+            }
+        }
+
+        // log
+        auto &log = g_config.log;
+        if (log.buffer_bytes <= 0 || log.flush_interval_ms <= 0) {
+            throw std::invalid_argument("log 的 buffer_bytes/flush_interval_ms 须为正数");
+        }
+        if (log.rotate_mb < 0 || log.rotate_interval_s < 0 || log.retention < 0) {
+            throw std::invalid_argument("log 的 rotate_mb/rotate_interval_s/retention 不能为负数");
+        }
+        for (const auto &[name, entry] : log.sinks) {
+            module::LogSinkConfig sink;
+            if (entry.type == "console") {
+                sink.type = module::LogSinkConfig::Type::CONSOLE;
+            } else if (entry.type == "file") {
+                if (entry.path.empty() || entry.buffer_bytes < 0) {
+                    throw std::invalid_argument(std::format("log.sinks[{}] 须指定 path, buffer_bytes 不能为负数", name));
+                }
+                sink.type = module::LogSinkConfig::Type::FILE;
+                sink.file.path = entry.path;
+                sink.file.buffer_bytes = static_cast<std::size_t>(entry.buffer_bytes);
+                sink.file.rotation = module::LogRotation{
+                    .max_bytes = static_cast<uint64_t>(log.rotate_mb) * 1024 * 1024,
+                    .interval_s = static_cast<uint32_t>(log.rotate_interval_s),
+                    .retention = static_cast<uint32_t>(log.retention),
+                    .compress = log.compress,
+                };
+            } else if (entry.type == "syslog") {
+                if (entry.port <= 0 || entry.port > 65535 || entry.facility < 0 || entry.facility > 23) {
+                    throw std::invalid_argument(std::format("log.sinks[{}] 的 port/facility 无效", name));
+                }
+                sink.type = module::LogSinkConfig::Type::SYSLOG;
+                sink.syslog.host = entry.host;
+                sink.syslog.port = static_cast<uint16_t>(entry.port);
+                sink.syslog.facility = static_cast<uint8_t>(entry.facility);
+                sink.syslog.app = entry.app;
+            } else {
+                throw std::invalid_argument(std::format("log.sinks[{}].type[{}] 无效, 可选 console/file/syslog", name, entry.type));
+            }
+            g_log_sinks[name] = std::move(sink);
+        }
+        auto check_sinks = [](const std::vector<std::string> &names, const std::string &key) {
+            for (const auto &name : names) {
+                if (!g_log_sinks.contains(name)) {
+                    throw std::invalid_argument(std::format("{} 引用了未定义的输出端 {}", key, name));
+                }
+            }
+        };
+        check_sinks(log.default_sinks, "log.default_sinks");
+        for (const auto &[name, sinks] : log.logger_sinks) {
+            check_sinks(sinks, std::format("log.logger_sinks[{}]", name));
+        }
+        // default_sinks 缺省或为空时写入全部输出端
+        if (log.default_sinks.empty()) {
+            for (const auto &[name, sink] : g_log_sinks) {
+                log.default_sinks.push_back(name);
+            }
+        }
+        if (log.suppress_burst < 0 || log.suppress_window_ms <= 0 || log.suppress_max_keys <= 0) {
+            throw std::invalid_argument("log 的 suppress_burst 不能为负数, suppress_window_ms/suppress_max_keys 须为正数");
+        }
+        if (log.info_sample_percent < 0 || log.info_sample_percent > 100) {
+            throw std::invalid_argument(std::format("log.info_sample_percent[{}] 须在 0 到 100 之间", log.info_sample_percent));
+        }
+
+        // gossip
+        if (const auto &gossip = g_config.gossip) {
+            if (gossip->port == 0 || gossip->period_ms <= 0 || gossip->suspect_timeout_ms <= 0) {
+                throw std::invalid_argument("gossip 的 port/period_ms/suspect_timeout_ms 无效");
+            }
+        }
     } catch (const Json::Exception &ex) {
         std::cerr << "解析JSON时发生错误" << ex.what() << std::endl;
         is_error = true;
@@ -80,87 +480,1225 @@ static inline std::string get_program_current_path() {
 
 // 服务发现 API 返回结构
 struct ServiceSearchRespone {
+    uint64_t version; // 服务集合版本, 作为长轮询 wait 参数
     std::size_t cnt;
     std::vector<uint16_t> machine_list;
 };
 
+// /machine-list?since=<version> 返回结构: full 为 false 时只含 since 之后的净变化,
+// 为 true 时 since 已超出保留范围, machine_list 为全量
+struct MachineDeltaRespone {
+    uint64_t version;
+    uint64_t since;
+    bool full;
+    std::vector<uint16_t> machine_list;
+    std::vector<uint16_t> added;
+    std::vector<uint16_t> removed;
+    std::vector<uint16_t> rebound;
+};
+
+// 端口所属进程
+struct MachineOwnerRespone {
+    int machine_no;
+    uint32_t pid;
+    std::string name;
+    uint64_t start_time; // Unix 毫秒
+};
+
+// /machine-list?verbose=1 返回结构
+struct ServiceVerboseRespone {
+    uint64_t version;
+    std::size_t cnt;
+    std::vector<uint16_t> machine_list;
+    std::vector<MachineOwnerRespone> owners;
+};
+
+// 服务变化事件, SSE 的 data 部分
+struct MachineEventRespone {
+    std::vector<uint16_t> machine_list;
+};
+
 // 失败回复
 struct ErrorRespone {
     std::string error_msg;
 };
 
-int main() {
+// 注册/心跳 API 返回结构, 服务以 id 续期与注销
+struct RegisterRespone {
+    uint64_t id;
+    int machine_no;
+    uint32_t ttl_ms;
+};
+
+// 心跳/注销成功
+struct RegistryAckRespone {
+    uint64_t id;
+};
+
+// 已注册服务, metadata 在序列化后补入
+struct RegisteredServiceRespone {
+    uint64_t id;
+    int machine_no;
+    std::string name;
+    std::string host;
+    uint16_t port;
+    uint32_t weight;
+    uint32_t ttl_ms;
+};
+
+struct ServiceListRespone {
+    std::size_t cnt;
+    std::vector<RegisteredServiceRespone> services;
+};
+
+// gossip 成员, state 为 alive/suspect/dead
+struct GossipMemberRespone {
+    std::string id;
+    std::string state;
+    uint64_t incarnation;
+};
+
+// /admin/gossip 返回结构, 含本节点
+struct GossipRespone {
+    std::string self;
+    std::size_t cnt;
+    std::vector<GossipMemberRespone> members;
+};
+
+// 日志器及其运行时级别
+struct LoggerLevelRespone {
+    std::string name;
+    std::string level;
+};
+
+// /admin/log-level 返回结构
+struct LogLevelRespone {
+    std::size_t cnt;
+    std::vector<LoggerLevelRespone> loggers;
+};
+
+// 分片指标
+struct ShardMetricsRespone {
+    std::size_t id;
+    uint64_t requests;
+    uint64_t forwarded;
+    uint64_t rejected;
+    uint64_t upstream_errors;
+    uint64_t bytes_out;
+    uint64_t log_suppressed;   // 限流丢弃的错误日志
+    uint64_t log_sampled_out;  // 采样丢弃的 info 日志
+};
+
+// 指标 API 返回结构, 跨分片聚合
+struct MetricsRespone {
+    std::size_t shards;
+    uint64_t startup_ms;    // 进程启动到开始接受请求的耗时
+    uint64_t first_scan_ms; // 其中首次同步扫描的耗时
+    uint64_t requests;
+    uint64_t forwarded;
+    uint64_t rejected;
+    uint64_t upstream_errors;
+    uint64_t bytes_out;
+    uint64_t log_suppressed;
+    uint64_t log_sampled_out;
+    std::vector<ShardMetricsRespone> per_shard;
+};
+
+// /machine-list 的预渲染响应, 每次服务集合变化只渲染一次
+struct MachineListView {
+    uint64_t version = 0;
+    std::string body;        // 紧凑 JSON, 默认返回
+    std::string etag;        // 强 ETag, 由响应体内容计算
+    std::string pretty_body; // pretty=1 时返回
+    std::string pretty_etag;
+    std::string verbose_body; // verbose=1 时返回, 附带端口所属进程
+    std::string verbose_etag;
+    std::string verbose_pretty_body;
+    std::string verbose_pretty_etag;
+};
+using MachineListViewPtr = std::shared_ptr<const MachineListView>;
+
+using ShardList = std::vector<std::unique_ptr<xiunneg::GatewayShard>>;
+using LoggerMap = std::map<std::string, std::shared_ptr<module::SimpleLoggerInterface>>;
+
+// 路由处理所需的进程级对象, 由 main 持有
+struct GatewayContext {
+    ShardList shards;
+    std::unique_ptr<xiunneg::SpliceRelay> splice_relay; // 未启用零拷贝转发时为空
+    std::atomic<MachineListViewPtr> machine_list;       // 扫描线程在投递快照前更新
+    xiunneg::PortScanner *scanner = nullptr;            // 转发失败时剔除服务或请求加速扫描
+    xiunneg::ServiceRegistry *registry = nullptr;       // 未开启服务注册时为空
+    xiunneg::GossipNode *gossip = nullptr;              // 未开启 gossip 时为空
+    xiunneg::AccessLog *access_log = nullptr;           // 未开启访问日志时为空
+    xiunneg::L4Relay *l4_relay = nullptr;               // 未开启四层透传时为空
+    const LoggerMap *loggers = nullptr;                 // 全部日志器, 按名称调整级别
+    uint64_t startup_ms = 0;                            // 启动耗时, 分片开始监听前写入
+    uint64_t first_scan_ms = 0;
+};
+
+// 计算分片数, 平台不支持端口复用时退化为单分片
+static inline std::size_t resolve_shard_count(module::SimpleLoggerInterface &logger) {
+    std::size_t shards = g_config.gateway.shards > 0 ? g_config.gateway.shards : std::max(1u, std::thread::hardware_concurrency());
+    if (shards > 1 && !xiunneg::shard_reuseport_supported()) {
+        logger.warn(std::format("当前平台不支持 SO_REUSEPORT, 分片数 {} 退化为 1", shards));
+        shards = 1;
+    }
+    return shards;
+}
+
+// 客户端请求的字节数: 请求行、请求头与请求体, 不含服务端补入的地址头
+static uint64_t request_bytes(const httplib::Request &req) {
+    uint64_t bytes = req.method.size() + req.target.size() + req.version.size() + 4 + 2 + req.body.size();
+    for (const auto &[key, value] : req.headers) {
+        if (key == "REMOTE_ADDR" || key == "REMOTE_PORT" || key == "LOCAL_ADDR" || key == "LOCAL_PORT") continue;
+        bytes += key.size() + value.size() + 4;
+    }
+    return bytes;
+}
+
+// 写访问日志, 路由失败时 result 为默认值
+static void write_access_log(const GatewayContext &context, const httplib::Request &req, const httplib::Response &res, const xiunneg::ForwardResult &result, std::string_view error) {
+    if (!context.access_log) return;
+
+    int machine_no = -1;
+    if (result.port != 0) {
+        machine_no = result.port - g_config.base.base_port;
+    } else {
+        auto param = req.get_param_value("machine_no");
+        int parsed{};
+        auto [end, ec] = std::from_chars(param.data(), param.data() + param.size(), parsed);
+        if (ec == std::errc{} && end == param.data() + param.size()) machine_no = parsed;
+    }
+
+    auto referer = req.get_header_value("Referer");
+    auto user_agent = req.get_header_value("User-Agent");
+    bool received = result.received != std::chrono::steady_clock::time_point{};
+    context.access_log->record({
+        .remote_addr = req.remote_addr,
+        .remote_port = req.remote_port,
+        .method = req.method,
+        .target = req.target,
+        .version = req.version,
+        .referer = referer,
+        .user_agent = user_agent,
+        .machine_no = machine_no,
+        .upstream_port = result.port,
+        .status = res.status > 0 ? res.status : 200,
+        .upstream_status = result.upstream_status,
+        .bytes_in = request_bytes(req),
+        .bytes_out = error.empty() ? result.body_bytes : res.body.size(),
+        .queue_us = result.queue_us,
+        .connect_us = result.connect_us,
+        .ttfb_us = result.ttfb_us,
+        .total_us = received ? xiunneg::elapsed_us(result.received, std::chrono::steady_clock::now()) : -1,
+        .error = error,
+    });
+}
+
+// 转发前解析路由, 失败时写入错误响应并返回 ok 为 false 的路由
+static xiunneg::Route begin_forward(const GatewayContext &context, xiunneg::GatewayShard &shard, const httplib::Request &req, httplib::Response &res) {
+    auto &metrics = shard.metrics();
+    metrics.requests.fetch_add(1, std::memory_order_relaxed);
+
+    auto route = xiunneg::resolve_route(req, g_config.base.base_port, *shard.snapshot());
+    if (!route.ok) {
+        ErrorRespone resp;
+        resp.error_msg = std::move(route.error_msg);
+        SIMPLE_LOG_ERROR_LIMITED(shard.limiter(), resp.error_msg, "{}:{} {}", req.remote_addr, req.remote_port, resp.error_msg);
+        res.set_content(module::to_json::dump(module::to_json::to_json(resp), 4), "application/json");
+        metrics.rejected.fetch_add(1, std::memory_order_relaxed);
+        write_access_log(context, req, res, xiunneg::ForwardResult{}, resp.error_msg);
+    }
+    return route;
+}
+
+// 转发结束后写入响应并记录, httplib 与异步 I/O 路径共用
+static void finish_forward(const GatewayContext &context, xiunneg::GatewayShard &shard, const httplib::Request &req, httplib::Response &res, xiunneg::ForwardResult &&result) {
+    auto &logger = shard.logger();
+    auto &metrics = shard.metrics();
+
+    if (!result.error_msg.empty()) {
+        ErrorRespone resp;
+        resp.error_msg = std::format("转发服务[{}]失败! {}", req.get_param_value("machine_no"), result.error_msg);
+        SIMPLE_LOG_ERROR_LIMITED(shard.limiter(), resp.error_msg, "{}:{} {}", req.remote_addr, req.remote_port, resp.error_msg);
+        res.set_content(module::to_json::dump(module::to_json::to_json(resp), 4), "application/json");
+        metrics.upstream_errors.fetch_add(1, std::memory_order_relaxed);
+        write_access_log(context, req, res, result, result.error_msg);
+        // 确已不在监听的服务立即退出路由, 其余失败尽快重扫以更新路由
+        if (context.scanner && result.upstream_gone()) {
+            context.scanner->report_failure(result.port);
+        } else if (context.scanner) {
+            context.scanner->accelerate();
+        }
+        return;
+    }
+
+    if (!result.spliced) {
+        res.set_content(std::move(result.body), "application/json");
+    }
+    SIMPLE_LOG_INFO_SAMPLED(shard.limiter(), "{}:{} GET {}{}", req.remote_addr, req.remote_port, req.target, result.spliced ? " [splice]" : "");
+    SIMPLE_LOG_DEBUG(logger, "{}:{} 上游 {} 状态 {} 响应 {} 字节, 首字节 {}us", req.remote_addr, req.remote_port, result.port, result.upstream_status, result.body_bytes, result.ttfb_us);
+    metrics.forwarded.fetch_add(1, std::memory_order_relaxed);
+    metrics.bytes_out.fetch_add(result.body_bytes, std::memory_order_relaxed);
+    write_access_log(context, req, res, result, {});
+}
+
+static constexpr std::chrono::seconds kLongPollTimeout{30};    // 长轮询默认等待时间
+static constexpr std::chrono::seconds kLongPollMaxTimeout{60}; // 长轮询最长等待时间
+static constexpr std::chrono::seconds kSseHeartbeat{15};       // SSE 无变化时的心跳间隔
+
+// FNV-1a, 用于由响应体计算 ETag
+static uint64_t fnv1a(std::string_view data) {
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static MachineListViewPtr render_machine_list(const xiunneg::PortScanner::Snapshot &snapshot) {
+    ServiceSearchRespone resp;
+    resp.version = snapshot.version;
+    resp.cnt = snapshot.ports.size();
+    for (const auto &service_port : snapshot.ports)
+        resp.machine_list.push_back(service_port - g_config.base.base_port);
+
+    ServiceVerboseRespone verbose_resp;
+    verbose_resp.version = resp.version;
+    verbose_resp.cnt = resp.cnt;
+    verbose_resp.machine_list = resp.machine_list;
+    for (const auto &[port, owner] : snapshot.owners) {
+        verbose_resp.owners.push_back({port - g_config.base.base_port, owner.pid, owner.name, owner.start_time});
+    }
+
+    auto json = module::to_json::to_json(resp);
+    auto verbose_json = module::to_json::to_json(verbose_resp);
+    auto view = std::make_shared<MachineListView>();
+    auto render = [](const Json::Value &json, int indent, std::string &body, std::string &etag) {
+        body = module::to_json::dump(json, indent);
+        etag = std::format("\"{:016x}\"", fnv1a(body));
+    };
+    view->version = snapshot.version;
+    render(json, 0, view->body, view->etag);
+    render(json, 4, view->pretty_body, view->pretty_etag);
+    render(verbose_json, 0, view->verbose_body, view->verbose_etag);
+    render(verbose_json, 4, view->verbose_pretty_body, view->verbose_pretty_etag);
+    return view;
+}
+
+// 优先使用扫描线程渲染好的响应, 版本不一致时(分片尚未收到对应快照)现场渲染
+static MachineListViewPtr machine_list_view(const GatewayContext &context, const xiunneg::PortScanner::Snapshot &snapshot) {
+    auto view = context.machine_list.load(std::memory_order_acquire);
+    if (view && view->version == snapshot.version) return view;
+    return render_machine_list(snapshot);
+}
+
+// If-None-Match 中是否有与 etag 相同的项, 按弱比较忽略 W/ 前缀
+static bool etag_matches(std::string_view if_none_match, std::string_view etag) {
+    while (!if_none_match.empty()) {
+        auto comma = if_none_match.find(',');
+        auto item = if_none_match.substr(0, comma);
+        if_none_match = comma == std::string_view::npos ? std::string_view{} : if_none_match.substr(comma + 1);
+
+        while (!item.empty() && item.front() == ' ') item.remove_prefix(1);
+        while (!item.empty() && item.back() == ' ') item.remove_suffix(1);
+        if (item.starts_with("W/")) item.remove_prefix(2);
+        if (item == "*" || item == etag) return true;
+    }
+    return false;
+}
+
+static void write_machine_list(const httplib::Request &req, httplib::Response &res, const MachineListView &view) {
+    bool pretty = req.get_param_value("pretty") == "1";
+    bool verbose = req.get_param_value("verbose") == "1";
+    const auto &etag = verbose ? (pretty ? view.verbose_pretty_etag : view.verbose_etag) : (pretty ? view.pretty_etag : view.etag);
+    const auto &body = verbose ? (pretty ? view.verbose_pretty_body : view.verbose_body) : (pretty ? view.pretty_body : view.body);
+    res.set_header("ETag", etag);
+    res.set_header("Cache-Control", "no-cache");
+    if (etag_matches(req.get_header_value("If-None-Match"), etag)) {
+        res.status = httplib::StatusCode::NotModified_304;
+        return;
+    }
+    res.set_content(body, "application/json");
+}
+
+static void write_error(httplib::Response &res, std::string error_msg) {
+    ErrorRespone resp;
+    resp.error_msg = std::move(error_msg);
+    res.set_content(module::to_json::dump(module::to_json::to_json(resp), 4), "application/json");
+}
+
+// 管理与注册写接口只接受 admin.allow 中的客户端, 其余返回 403
+template <typename Handler>
+static auto admin_only(Handler handler) {
+    return [handler = std::move(handler)](const httplib::Request &req, httplib::Response &res) {
+        if (!admin_allowed(req.remote_addr)) {
+            res.status = httplib::StatusCode::Forbidden_403;
+            write_error(res, std::format("客户端 {} 不在 admin.allow 中", req.remote_addr));
+            return;
+        }
+        handler(req, res);
+    };
+}
+
+// httplib 路径上挂起的长轮询与 SSE 已达 gateway.max_streams, 返回 503 让客户端稍后重试, 工作线程留给转发
+static void write_streams_busy(xiunneg::GatewayShard &shard, const httplib::Request &req, httplib::Response &res) {
+    SIMPLE_LOG_WARN_LIMITED(shard.limiter(), "长连接名额已满", "{}:{} GET {} 长轮询与 SSE 名额已满", req.remote_addr, req.remote_port, req.path);
+    res.status = httplib::StatusCode::ServiceUnavailable_503;
+    res.set_header("Retry-After", "1");
+    write_error(res, "长轮询与 SSE 连接数已达上限, 请稍后重试或使用异步 I/O 引擎");
+}
+
+static std::optional<uint64_t> parse_version(const std::string &text) {
+    uint64_t version{};
+    auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), version);
+    if (ec != std::errc{} || end != text.data() + text.size()) return std::nullopt;
+    return version;
+}
+
+// 长轮询参数: wait 为调用方已知的版本, timeout 为最长等待秒数
+struct LongPoll {
+    uint64_t version;
+    std::chrono::milliseconds timeout;
+};
+
+// 解析 /machine-list?wait=<version>&timeout=<秒>, 参数无效时抛出 std::invalid_argument
+static LongPoll parse_long_poll(const httplib::Request &req) {
+    auto version = parse_version(req.get_param_value("wait"));
+    if (!version) {
+        throw std::invalid_argument(std::format("wait[{}] 不是有效的版本号", req.get_param_value("wait")));
+    }
+
+    std::chrono::seconds timeout = kLongPollTimeout;
+    if (req.has_param("timeout")) {
+        auto seconds = parse_version(req.get_param_value("timeout"));
+        if (!seconds) {
+            throw std::invalid_argument(std::format("timeout[{}] 不是有效的秒数", req.get_param_value("timeout")));
+        }
+        timeout = std::min(std::chrono::seconds(*seconds), kLongPollMaxTimeout);
+    }
+    return {*version, timeout};
+}
+
+// 解析 /machine-list?since=<version>, 未带参数时返回空, 参数无效时抛出 std::invalid_argument
+static std::optional<uint64_t> parse_since(const httplib::Request &req) {
+    if (!req.has_param("since")) return std::nullopt;
+    auto version = parse_version(req.get_param_value("since"));
+    if (!version) {
+        throw std::invalid_argument(std::format("since[{}] 不是有效的版本号", req.get_param_value("since")));
+    }
+    return version;
+}
+
+static std::vector<uint16_t> to_machine_list(const std::set<uint16_t> &ports) {
+    std::vector<uint16_t> machine_list;
+    machine_list.reserve(ports.size());
+    for (const auto &port : ports)
+        machine_list.push_back(port - g_config.base.base_port);
+    return machine_list;
+}
+
+// 增量同步, 响应大小与 since 之后的变化量成正比; since 超出保留范围时退化为全量
+static void write_machine_delta(httplib::Response &res, const xiunneg::DiscoveryFeed &feed, uint64_t since) {
+    xiunneg::PortScanner::SnapshotPtr snapshot;
+    auto delta = feed.delta_since(since, snapshot);
+
+    MachineDeltaRespone resp{};
+    resp.version = snapshot->version;
+    resp.since = since;
+    resp.full = !delta;
+    if (delta) {
+        resp.added = to_machine_list(delta->added);
+        resp.removed = to_machine_list(delta->removed);
+        resp.rebound = to_machine_list(delta->rebound);
+    } else {
+        resp.machine_list = to_machine_list(snapshot->ports);
+    }
+    res.set_header("Cache-Control", "no-cache");
+    res.set_content(module::to_json::dump(module::to_json::to_json(resp), 0), "application/json");
+}
+
+// SSE 客户端的发送进度
+struct SseCursor {
+    bool started = false;
+    uint64_t version = 0;
+};
+
+// 断线重连时浏览器带回最后收到的事件 id, 即版本号
+static SseCursor make_sse_cursor(const httplib::Request &req) {
+    SseCursor cursor;
+    if (auto version = parse_version(req.get_header_value("Last-Event-ID"))) {
+        cursor.started = true;
+        cursor.version = *version;
+    }
+    return cursor;
+}
+
+// data 须为单行, JSON 以无缩进方式输出
+static std::string format_sse(std::string_view event, uint64_t version, const std::string &data) {
+    return std::format("id: {}\nevent: {}\ndata: {}\n\n", version, event, data);
+}
+
+static std::string format_sse_ports(std::string_view event, uint64_t version, const std::set<uint16_t> &ports) {
+    MachineEventRespone resp;
+    resp.machine_list = to_machine_list(ports);
+    return format_sse(event, version, module::to_json::dump(module::to_json::to_json(resp), 0));
+}
+
+// 生成 cursor 之后的 SSE 数据并推进进度, 首次或历史不足时发送全量快照, 无变化时返回空
+static std::string next_sse_payload(const GatewayContext &context, xiunneg::DiscoveryFeed &feed, SseCursor &cursor) {
+    auto snapshot = feed.current();
+    auto events = cursor.started ? feed.events_since(cursor.version) : std::nullopt;
+    cursor.started = true;
+
+    if (!events) {
+        cursor.version = snapshot->version;
+        return format_sse("snapshot", snapshot->version, machine_list_view(context, *snapshot)->body);
+    }
+
+    std::string payload;
+    for (const auto &event : *events) {
+        if (!event.added.empty()) payload += format_sse_ports("add", event.version, event.added);
+        if (!event.removed.empty()) payload += format_sse_ports("remove", event.version, event.removed);
+        if (!event.rebound.empty()) payload += format_sse_ports("rebound", event.version, event.rebound);
+        cursor.version = std::max(cursor.version, event.version);
+    }
+    // 仅 Unix 域套接字路径变化的版本没有事件, 同样推进进度
+    cursor.version = std::max(cursor.version, snapshot->version);
+    return payload;
+}
+
+// 异步 I/O 路径的 /machine-list, 长轮询期间挂起协程而不占用线程
+static xiunneg::coro::Task<> machine_list_async(const GatewayContext &context, xiunneg::GatewayShard &shard, xiunneg::AsyncContext &ctx) {
+    auto snapshot = shard.feed().current();
+    std::optional<uint64_t> since;
     try {
-        xiunneg::WSADATARAII wsa_data;
+        since = parse_since(ctx.req);
+    } catch (const std::invalid_argument &e) {
+        write_error(ctx.res, e.what());
+        co_return;
+    }
+    if (ctx.req.has_param("wait")) {
+        LongPoll poll;
+        try {
+            poll = parse_long_poll(ctx.req);
+        } catch (const std::invalid_argument &e) {
+            write_error(ctx.res, e.what());
+            co_return;
+        }
 
-        if (load_from_json(std::format("{}\\config\\config.json", get_program_current_path()))) {
-            return -1;
+        auto deadline = std::chrono::steady_clock::now() + poll.timeout;
+        while (snapshot->version == poll.version) {
+            auto remain = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            if (remain.count() <= 0 || !co_await ctx.wait(remain)) break;
+            snapshot = shard.feed().current();
         }
+    }
+    if (since) {
+        write_machine_delta(ctx.res, shard.feed(), *since);
+        co_return;
+    }
+    write_machine_list(ctx.req, ctx.res, *machine_list_view(context, *snapshot));
+}
 
-        xiunneg::PortScanner::Config config{
-            .begin = g_begin,
-            .end = g_end,
-            .scan_interval = g_scan_interval,
+// 异步 I/O 路径的 /machine-events
+static xiunneg::coro::Task<> machine_events_async(const GatewayContext &context, xiunneg::GatewayShard &shard, xiunneg::AsyncContext &ctx) {
+    auto &feed = shard.feed();
+    auto cursor = make_sse_cursor(ctx.req);
+    ctx.res.set_header("Content-Type", "text/event-stream");
+    ctx.res.set_header("Cache-Control", "no-cache");
+    if (!co_await ctx.begin_stream()) co_return;
+
+    for (;;) {
+        auto payload = next_sse_payload(context, feed, cursor);
+        if (payload.empty()) payload = ": ping\n\n";
+        if (!co_await ctx.write(std::move(payload))) co_return;
+        // 通知只在事件循环线程中投递, 检查与挂起之间不会漏掉变化
+        if (feed.current()->version == cursor.version) {
+            co_await ctx.wait(kSseHeartbeat);
+        }
+    }
+}
+
+// 解析注册请求体 {name, host, port, machine_no, weight, ttl_ms, metadata}, 参数无效时抛出 std::invalid_argument
+static xiunneg::ServiceRegistry::Registration parse_registration(const std::string &body) {
+    Json::Value root;
+    Json::CharReaderBuilder builder;
+    std::string errors;
+    std::istringstream stream(body);
+    if (!Json::parseFromStream(builder, stream, &root, &errors) || !root.isObject()) {
+        throw std::invalid_argument(std::format("请求体不是有效的 JSON 对象 {}", errors));
+    }
+
+    int port = module::from_json::get_value<int>(root, "port");
+    if (port <= 0 || port > 65535) {
+        throw std::invalid_argument(std::format("port[{}] 无效", port));
+    }
+    // 未指定服务号时按本机约定 port = base_port + machine_no 推算
+    int machine_no = module::from_json::get_value_or<int>(root, "machine_no", port - g_config.base.base_port);
+    int key = g_config.base.base_port + machine_no;
+    if (machine_no < 0 || key > 65535) {
+        throw std::invalid_argument(std::format("machine_no[{}] 超出范围", machine_no));
+    }
+    int weight = module::from_json::get_value_or<int>(root, "weight", 1);
+    int ttl_ms = module::from_json::get_value_or<int>(root, "ttl_ms", 0);
+    if (weight <= 0 || ttl_ms < 0) {
+        throw std::invalid_argument("weight 须为正数, ttl_ms 不能为负数");
+    }
+
+    xiunneg::ServiceRegistry::Registration registration{
+        .key = static_cast<uint16_t>(key),
+        .info = {
+            .name = module::from_json::get_value_or<std::string>(root, "name", ""),
+            .endpoint = {module::from_json::get_value_or<std::string>(root, "host", "127.0.0.1"), static_cast<uint16_t>(port)},
+            .weight = static_cast<uint32_t>(weight),
+            .metadata = {},
+        },
+        .ttl_ms = static_cast<uint32_t>(ttl_ms),
+    };
+    // metadata: { "<key>": "<value>" }
+    if (root.isMember("metadata")) {
+        auto &metadata_root = root["metadata"];
+        if (!metadata_root.isObject()) {
+            throw std::invalid_argument("metadata 须为对象");
+        }
+        for (const auto &name : metadata_root.getMemberNames()) {
+            registration.info.metadata[name] = module::from_json::get_value<std::string>(metadata_root, name);
+        }
+    }
+    return registration;
+}
+
+// 解析心跳/注销的 id 参数, 无效时写入错误响应
+static std::optional<uint64_t> parse_registration_id(const httplib::Request &req, httplib::Response &res) {
+    auto id = parse_version(req.get_param_value("id"));
+    if (!id) {
+        write_error(res, std::format("id[{}] 不是有效的注册 id", req.get_param_value("id")));
+    }
+    return id;
+}
+
+// 服务注册 API, httplib 与异步 I/O 路径共用
+static void register_registry_routes(xiunneg::ServiceRegistry &registry, xiunneg::PortScanner &scanner, auto &&post, auto &&get) {
+    // 注册或以相同地址重复注册(续期并更新信息), 之后按 ttl_ms 发送心跳
+    post("/register", admin_only([&registry, &scanner](const httplib::Request &req, httplib::Response &res) {
+        xiunneg::ServiceRegistry::Registration registration;
+        try {
+            registration = parse_registration(req.body);
+        } catch (const std::invalid_argument &e) {
+            write_error(res, e.what());
+            return;
+        }
+        // 注册不能改写扫描到的在线服务
+        if (scanner.claimed_by_scan(registration.key, registration.info.endpoint)) {
+            write_error(res, std::format("注册服务失败! 服务[{}] 已被扫描到的服务占用", registration.key - g_config.base.base_port));
+            return;
+        }
+
+        std::string error_msg;
+        auto id = registry.register_service(registration, error_msg);
+        if (!id) {
+            write_error(res, std::format("注册服务失败! {}", error_msg));
+            return;
+        }
+        RegisterRespone resp{
+            .id = *id,
+            .machine_no = registration.key - g_config.base.base_port,
+            .ttl_ms = registry.lease_ms(registration.ttl_ms),
         };
-        xiunneg::PortScanner port_scanner(config);
-        port_scanner.run();
+        res.set_content(module::to_json::dump(module::to_json::to_json(resp), 4), "application/json");
+    }));
 
-        httplib::Server proxy_gateway;
-        module::SimpleLogger proxy_gateway_logger("proxy_gateway_logger", module::SimpleLoggerInterface::LoggerMode::CONSOLE_AND_FILE);
+    // 心跳续期, 注册已过期时返回错误, 服务应重新注册
+    post("/heartbeat", admin_only([&registry](const httplib::Request &req, httplib::Response &res) {
+        auto id = parse_registration_id(req, res);
+        if (!id) return;
+        if (!registry.heartbeat(*id)) {
+            write_error(res, std::format("注册[{}] 不存在或已过期, 请重新注册", *id));
+            return;
+        }
+        res.set_content(module::to_json::dump(module::to_json::to_json(RegistryAckRespone{*id}), 4), "application/json");
+    }));
 
-        // 服务发现
-        proxy_gateway.Get("/machine-list", [&port_scanner](const httplib::Request &req, httplib::Response &res) {
-            ServiceSearchRespone resp;
-            auto services = port_scanner.get_occupied_ports();
-            resp.cnt = services.size();
-            for (const auto &service_port : services)
-                resp.machine_list.push_back(service_port - g_base_port);
+    post("/deregister", admin_only([&registry](const httplib::Request &req, httplib::Response &res) {
+        auto id = parse_registration_id(req, res);
+        if (!id) return;
+        if (!registry.deregister(*id)) {
+            write_error(res, std::format("注册[{}] 不存在或已过期", *id));
+            return;
+        }
+        res.set_content(module::to_json::dump(module::to_json::to_json(RegistryAckRespone{*id}), 4), "application/json");
+    }));
 
-            res.set_content(module::to_json::dump(module::to_json::to_json(resp), 4), "application/json");
-        });
+    get("/services", [&registry](const httplib::Request &, httplib::Response &res) {
+        ServiceListRespone resp{};
+        auto items = registry.list();
+        for (const auto &[id, registration] : items) {
+            resp.services.push_back({
+                .id = id,
+                .machine_no = registration.key - g_config.base.base_port,
+                .name = registration.info.name,
+                .host = registration.info.endpoint.host,
+                .port = registration.info.endpoint.port,
+                .weight = registration.info.weight,
+                .ttl_ms = registration.ttl_ms,
+            });
+        }
+        resp.cnt = resp.services.size();
 
-        // GET 请求转发 必选参数 machine_no[服务号]
-        proxy_gateway.Get("/.*", [&](const httplib::Request &req, httplib::Response &res) {
-            if (!req.has_param("machine_no")) {
-                ErrorRespone resp;
-                resp.error_msg = "缺少参数 machine_no";
-                proxy_gateway_logger.error(std::format("{}:{} {}", req.remote_addr, req.remote_port, resp.error_msg));
-                res.set_content(module::to_json::dump(module::to_json::to_json(resp), 4), "application/json");
-                return;
+        // 元数据为键值对, 序列化后逐项补入
+        auto root = module::to_json::to_json(resp);
+        for (std::size_t i = 0; i < items.size(); ++i) {
+            Json::Value metadata(Json::objectValue);
+            for (const auto &[key, value] : items[i].second.info.metadata) {
+                metadata[key] = value;
             }
+            root["services"][static_cast<Json::ArrayIndex>(i)]["metadata"] = metadata;
+        }
+        res.set_content(module::to_json::dump(root, 4), "application/json");
+    });
+}
 
-            int machine_no{};
+// 在分片上注册路由, 请求处理只访问本分片的状态, 仅 /admin 接口跨分片读取
+static void register_routes(xiunneg::GatewayShard &shard, const GatewayContext &context) {
+    auto &server = shard.server();
+    const auto &shards = context.shards;
 
+    // 服务发现, 响应体按版本预渲染; wait 参数为已知版本时阻塞到服务集合变化或超时, since 参数时只返回增量
+    server.Get("/machine-list", [&shard, &context](const httplib::Request &req, httplib::Response &res) {
+        auto snapshot = shard.snapshot();
+        std::optional<uint64_t> since;
+        try {
+            since = parse_since(req);
+        } catch (const std::invalid_argument &e) {
+            write_error(res, e.what());
+            return;
+        }
+        if (req.has_param("wait")) {
+            LongPoll poll;
             try {
-                machine_no = std::stoi(req.get_param_value("machine_no"));
-            } catch (const std::out_of_range &e) {
-                ErrorRespone resp;
-                resp.error_msg = std::format("参数 machine_no[{}] 超出范围! {}", req.get_param_value("machine_no"), e.what());
-                proxy_gateway_logger.error(std::format("{}:{} {}", req.remote_addr, req.remote_port, resp.error_msg));
-                res.set_content(module::to_json::dump(module::to_json::to_json(resp), 4), "application/json");
+                poll = parse_long_poll(req);
+            } catch (const std::invalid_argument &e) {
+                write_error(res, e.what());
                 return;
             }
+            if (snapshot->version == poll.version) {
+                if (!shard.try_acquire_stream()) {
+                    write_streams_busy(shard, req, res);
+                    return;
+                }
+                snapshot = shard.feed().wait_change(poll.version, poll.timeout);
+                shard.release_stream();
+            }
+        }
+        if (since) {
+            write_machine_delta(res, shard.feed(), *since);
+            return;
+        }
+        write_machine_list(req, res, *machine_list_view(context, *snapshot));
+    });
+
+    // 服务变化推送(SSE), 连接后先发送全量快照, 之后逐版本发送 add/remove 事件
+    server.Get("/machine-events", [&shard, &context](const httplib::Request &req, httplib::Response &res) {
+        if (!shard.try_acquire_stream()) {
+            write_streams_busy(shard, req, res);
+            return;
+        }
+        auto cursor = std::make_shared<SseCursor>(make_sse_cursor(req));
+        res.set_header("Cache-Control", "no-cache");
+        // 名额随 Response 析构归还, 客户端断开或服务停止都会释放
+        res.set_chunked_content_provider(
+            "text/event-stream",
+            [&shard, &context, cursor](std::size_t, httplib::DataSink &sink) {
+                auto &feed = shard.feed();
+                if (cursor->started && feed.current()->version == cursor->version) {
+                    feed.wait_change(cursor->version, kSseHeartbeat);
+                }
+                if (feed.closed()) {
+                    sink.done();
+                    return true;
+                }
+                auto payload = next_sse_payload(context, feed, *cursor);
+                if (payload.empty()) payload = ": ping\n\n";
+                return sink.write(payload.data(), payload.size());
+            },
+            [&shard](bool) {
+                shard.release_stream();
+            });
+    });
+
+    // 指标聚合
+    auto admin_metrics = [&shards, &context](const httplib::Request &, httplib::Response &res) {
+        MetricsRespone resp{};
+        resp.shards = shards.size();
+        resp.startup_ms = context.startup_ms;
+        resp.first_scan_ms = context.first_scan_ms;
+        for (const auto &item : shards) {
+            const auto &metrics = item->metrics();
+            ShardMetricsRespone shard_resp{
+                .id = item->id(),
+                .requests = metrics.requests.load(std::memory_order_relaxed),
+                .forwarded = metrics.forwarded.load(std::memory_order_relaxed),
+                .rejected = metrics.rejected.load(std::memory_order_relaxed),
+                .upstream_errors = metrics.upstream_errors.load(std::memory_order_relaxed),
+                .bytes_out = metrics.bytes_out.load(std::memory_order_relaxed),
+                .log_suppressed = item->limiter().suppressed(),
+                .log_sampled_out = item->limiter().sampled_out(),
+            };
+            resp.requests += shard_resp.requests;
+            resp.forwarded += shard_resp.forwarded;
+            resp.rejected += shard_resp.rejected;
+            resp.upstream_errors += shard_resp.upstream_errors;
+            resp.bytes_out += shard_resp.bytes_out;
+            resp.log_suppressed += shard_resp.log_suppressed;
+            resp.log_sampled_out += shard_resp.log_sampled_out;
+            resp.per_shard.push_back(shard_resp);
+        }
+        // 四层透传不属于任何分片, 只计入总数
+        if (context.l4_relay) {
+            resp.log_suppressed += context.l4_relay->limiter().suppressed();
+            resp.log_sampled_out += context.l4_relay->limiter().sampled_out();
+        }
+
+        res.set_content(module::to_json::dump(module::to_json::to_json(resp), 4), "application/json");
+    };
+    server.Get("/admin/metrics", admin_only(admin_metrics));
+
+    // gossip 成员状态, 未开启 gossip 时不注册
+    auto admin_gossip = [&context](const httplib::Request &, httplib::Response &res) {
+        GossipRespone resp{};
+        resp.self = context.gossip->id();
+        for (const auto &member : context.gossip->members()) {
+            resp.members.push_back({member.id, xiunneg::GossipNode::state_name(member.state), member.incarnation});
+        }
+        resp.cnt = resp.members.size();
+        res.set_content(module::to_json::dump(module::to_json::to_json(resp), 4), "application/json");
+    };
+    if (context.gossip) {
+        server.Get("/admin/gossip", admin_only(admin_gossip));
+    }
+
+    // 日志级别: GET 列出全部日志器, POST 以 level 参数修改, logger 参数为空时修改全部
+    auto admin_log_levels = [&context](const httplib::Request &, httplib::Response &res) {
+        LogLevelRespone resp{};
+        for (const auto &[name, logger] : *context.loggers) {
+            resp.loggers.push_back({name, module::level_name(logger->level())});
+        }
+        resp.cnt = resp.loggers.size();
+        res.set_content(module::to_json::dump(module::to_json::to_json(resp), 4), "application/json");
+    };
+    auto admin_set_log_level = [&context, admin_log_levels](const httplib::Request &req, httplib::Response &res) {
+        module::LogLevel level;
+        auto level_param = req.get_param_value("level");
+        if (!module::parse_level(level_param, level)) {
+            write_error(res, std::format("参数 level[{}] 无效, 可选 trace/debug/info/warn/error", level_param));
+            return;
+        }
+        auto name = req.get_param_value("logger");
+        if (!name.empty() && !context.loggers->contains(name)) {
+            write_error(res, std::format("日志器[{}] 不存在", name));
+            return;
+        }
+        for (const auto &[logger_name, logger] : *context.loggers) {
+            if (name.empty() || logger_name == name) logger->set_level(level);
+        }
+        admin_log_levels(req, res);
+    };
+    server.Get("/admin/log-level", admin_only(admin_log_levels));
+    server.Post("/admin/log-level", admin_only(admin_set_log_level));
+
+    if (context.registry) {
+        register_registry_routes(
+            *context.registry, *context.scanner,
+            [&server](const std::string &pattern, httplib::Server::Handler handler) { server.Post(pattern, std::move(handler)); },
+            [&server](const std::string &pattern, httplib::Server::Handler handler) { server.Get(pattern, std::move(handler)); });
+    }
+
+    // GET 请求转发 必选参数 machine_no[服务号]
+    server.Get("/.*", [&shard, &context](const httplib::Request &req, httplib::Response &res) {
+        auto route = begin_forward(context, shard, req, res);
+        if (!route.ok) return;
+
+        auto port = route.port;
+        xiunneg::ForwardResult result;
+        result.port = port;
+        result.received = xiunneg::GatewayServer::request_received();
+        result.queue_us = xiunneg::GatewayServer::request_queue_us() + xiunneg::elapsed_us(result.received, std::chrono::steady_clock::now());
+        if (context.splice_relay) {
+            // 零拷贝转发, 大响应体不经过用户态, 其余响应复用保持连接的上游
+            auto relay = context.splice_relay->forward(route, req, res, xiunneg::GatewayServer::current_socket());
+            result.error_msg = relay.ok ? "" : relay.error_msg;
+            result.body_bytes = relay.body_bytes;
+            result.spliced = relay.spliced;
+            result.body = std::move(relay.body);
+            result.connect_error = relay.connect_error;
+            result.upstream_status = relay.upstream_status;
+            result.connect_us = relay.connect_us;
+            result.ttfb_us = relay.ttfb_us;
+        } else {
+            auto client = shard.pool().acquire(route);
+            httplib::Headers headers = req.headers;
+            // httplib 在 Get 内部按需建连, 首字节时间含建连耗时
+            auto request_begin = std::chrono::steady_clock::now();
+            std::string body;
+            auto client_resp = client->Get(
+                req.target, headers,
+                [&result, request_begin](const httplib::Response &) {
+                    result.ttfb_us = xiunneg::elapsed_us(request_begin, std::chrono::steady_clock::now());
+                    return true;
+                },
+                [&body](const char *data, std::size_t length) {
+                    body.append(data, length);
+                    return true;
+                });
+            if (client_resp) {
+                shard.pool().release(port, std::move(client));
+                result.upstream_status = client_resp->status;
+                result.body_bytes = body.size();
+                result.body = std::move(body);
+            } else {
+                result.error_msg = httplib::to_string(client_resp.error());
+                if (client_resp.error() == httplib::Error::ConnectionTimeout) {
+                    result.connect_error = ETIMEDOUT;
+                } else if (client_resp.error() == httplib::Error::Connection) {
+                    // httplib 不保留 connect 的错误码, 重新探测一次(最多等 100ms); 此次连上(0)说明只是瞬时失败
+                    result.connect_error = xiunneg::probe_connect_error(route, 100);
+                }
+            }
+        }
+        finish_forward(context, shard, req, res, std::move(result));
+    });
 
-            int target_sevice = g_base_port + machine_no;
+    // 异步 I/O 路径, 本地路由复用同一处理函数, 转发在事件循环中完成
+    if (auto *loop = shard.async_loop()) {
+        loop->GetAsync("/machine-list", [&shard, &context](xiunneg::AsyncContext &ctx) {
+            return machine_list_async(context, shard, ctx);
+        });
+        loop->GetAsync("/machine-events", [&shard, &context](xiunneg::AsyncContext &ctx) {
+            return machine_events_async(context, shard, ctx);
+        });
+        loop->Get("/admin/metrics", admin_only(admin_metrics));
+        loop->Get("/admin/log-level", admin_only(admin_log_levels));
+        loop->Post("/admin/log-level", admin_only(admin_set_log_level));
+        if (context.gossip) {
+            loop->Get("/admin/gossip", admin_only(admin_gossip));
+        }
+        if (context.registry) {
+            register_registry_routes(
+                *context.registry, *context.scanner,
+                [loop](const std::string &pattern, xiunneg::AsyncLoop::Handler handler) { loop->Post(pattern, std::move(handler)); },
+                [loop](const std::string &pattern, xiunneg::AsyncLoop::Handler handler) { loop->Get(pattern, std::move(handler)); });
+        }
+        loop->set_forward_hooks({
+            .resolve = [&shard, &context](const httplib::Request &req, httplib::Response &res) {
+                return begin_forward(context, shard, req, res);
+            },
+            .complete = [&shard, &context](const httplib::Request &req, httplib::Response &res, xiunneg::ForwardResult &&result) {
+                finish_forward(context, shard, req, res, std::move(result));
+            },
+        });
+    }
+}
+
+// 析构时停止扫描线程, 声明在扫描器订阅的对象之后, 使其先于这些对象析构
+struct ScannerStopper {
+    xiunneg::PortScanner &scanner;
+
+    ~ScannerStopper() {
+        scanner.stop();
+    }
+};
+
+// 本机视图中可供其他网关访问的服务: 本机端口与回环地址替换为 advertise_host,
+// 经 gossip 获知的服务不再转发, 仅 IPv6 与 Unix 域套接字服务不对外发布
+static std::map<uint16_t, xiunneg::PortScanner::RemoteEndpoint> gossip_services(const xiunneg::PortScanner::Snapshot &snapshot) {
+    std::map<uint16_t, xiunneg::PortScanner::RemoteEndpoint> services;
+    for (auto port : snapshot.ports) {
+        if (snapshot.peers.contains(port) || snapshot.ipv6_only.contains(port) || snapshot.unix_paths.contains(port)) continue;
+        auto it = snapshot.remotes.find(port);
+        if (it == snapshot.remotes.end()) {
+            services.emplace(port, xiunneg::PortScanner::RemoteEndpoint{g_config.gossip->advertise_host, port});
+            continue;
+        }
+        auto endpoint = it->second;
+        if (endpoint.host == "::1" || endpoint.host.starts_with("127.")) {
+            endpoint.host = g_config.gossip->advertise_host;
+        }
+        services.emplace(port, std::move(endpoint));
+    }
+    return services;
+}
+
+int main() {
+    auto startup_begin = std::chrono::steady_clock::now();
+    try {
+        xiunneg::WSADATARAII wsa_data;
 
-            // 本地转发
-            auto services = port_scanner.get_occupied_ports();
-            if (services.find(target_sevice) != services.end()) {
-                httplib::Client client("127.0.0.1", target_sevice);
-                httplib::Headers headers = req.headers;
-                auto client_resp = client.Get(req.target, headers);
-                proxy_gateway_logger.info(std::format("{}:{} GET {}", req.remote_addr, req.remote_port, req.target));
-                res.set_content(client_resp->body, "application/json");
+        if (load_from_json((std::filesystem::path(get_program_current_path()) / "config" / "config.json").string())) {
+            return -1;
+        }
+
+        xiunneg::PortScanner::Config config{
+            .ranges = g_scan_ranges,
+            .remote_targets = g_remote_targets,
+            .remote_timeout_ms = static_cast<uint32_t>(std::max(1, g_config.remote.timeout_ms)),
+            .remote_max_in_flight = static_cast<uint32_t>(std::max(1, g_config.remote.max_in_flight)),
+            .min_scan_interval_ms = static_cast<uint32_t>(g_config.scanner.min_scan_interval_ms),
+            .max_scan_interval_ms = static_cast<uint32_t>(*g_config.scanner.max_scan_interval_ms),
+            .unix_socket_dir = g_config.unix_.socket_dir,
+            .unix_sockets = g_unix_sockets,
+            .shm_name = g_config.scanner.shm_name,
+            .snapshot_path = g_config.scanner.snapshot_path,
+        };
+        // 二进制日志: 全部日志器写入同一文件, 由 Binlog_Decode 还原为文本
+        std::shared_ptr<module::BinaryLogWriter> binary_log;
+        if (g_config.log.binary) {
+            binary_log = std::make_shared<module::BinaryLogWriter>(module::BinaryLogWriter::Config{
+                .path = g_config.log.binary_path,
+                .buffer_bytes = static_cast<std::size_t>(g_config.log.buffer_bytes),
+                .flush_interval_ms = static_cast<uint32_t>(g_config.log.flush_interval_ms),
+            });
+            if (!binary_log->open()) {
+                std::cerr << std::format("打开二进制日志 {} 失败", g_config.log.binary_path) << std::endl;
+                return -1;
+            }
+        }
+        // 命名输出端: 配置了 log.sinks 时全部文本日志器按名称共用, 由后台线程周期写出缓冲
+        std::unique_ptr<module::LogSinkRegistry> sinks;
+        if (!binary_log && !g_log_sinks.empty()) {
+            sinks = std::make_unique<module::LogSinkRegistry>(static_cast<uint32_t>(g_config.log.flush_interval_ms));
+            for (const auto &[name, sink] : g_log_sinks) {
+                if (!sinks->create(name, sink)) {
+                    std::cerr << std::format("创建日志输出端 {} 失败", name) << std::endl;
+                    return -1;
+                }
+            }
+        }
+        // 创建的日志器按名称登记, 供 /admin/log-level 调整级别
+        LoggerMap loggers;
+        auto make_logger = [&binary_log, &sinks, &loggers](const std::string &name) -> std::shared_ptr<module::SimpleLoggerInterface> {
+            std::shared_ptr<module::SimpleLoggerInterface> logger;
+            if (binary_log) {
+                logger = std::make_shared<module::BinaryLogger>(name, binary_log);
+            } else if (sinks) {
+                auto it = g_config.log.logger_sinks.find(name);
+                std::vector<std::shared_ptr<module::LogSink>> logger_sinks;
+                for (const auto &sink_name : it != g_config.log.logger_sinks.end() ? it->second : g_config.log.default_sinks) {
+                    logger_sinks.push_back(sinks->find(sink_name));
+                }
+                logger = std::make_shared<module::SimpleLogger>(name, std::move(logger_sinks));
             } else {
-                ErrorRespone resp;
-                resp.error_msg = std::format("该服务[{}]不存在!", req.get_param_value("machine_no"));
-                proxy_gateway_logger.error(std::format("{}:{} {}", req.remote_addr, req.remote_port, resp.error_msg));
-                res.set_content(module::to_json::dump(module::to_json::to_json(resp), 4), "application/json");
-                return;
+                logger = std::make_shared<module::SimpleLogger>(name, module::SimpleLoggerInterface::LoggerMode::CONSOLE_AND_FILE,
+                                                                module::SimpleLogger::Rotation{
+                                                                    .max_bytes = static_cast<uint64_t>(g_config.log.rotate_mb) * 1024 * 1024,
+                                                                    .interval_s = static_cast<uint32_t>(g_config.log.rotate_interval_s),
+                                                                    .retention = static_cast<uint32_t>(g_config.log.retention),
+                                                                    .compress = g_config.log.compress,
+                                                                });
+            }
+            auto it = g_config.log.levels.find(name);
+            logger->set_level(it != g_config.log.levels.end() ? it->second : g_config.log.level);
+            loggers[name] = logger;
+            return logger;
+        };
+
+        xiunneg::PortScanner port_scanner(config, make_logger("port scanner logger"));
+
+        auto proxy_gateway_logger = make_logger("proxy_gateway_logger");
+
+        // 分片: 单分片沿用原日志器, 多分片时每个分片独占日志器, 互不争用
+        auto shard_count = resolve_shard_count(*proxy_gateway_logger);
+        auto cores = std::max(1u, std::thread::hardware_concurrency());
+        GatewayContext context;
+        context.scanner = &port_scanner;
+        context.loggers = &loggers;
+        auto &shards = context.shards;
+        xiunneg::IoEngine::Config engine_config{
+            .kind = g_config.engine.type == "epoll" ? xiunneg::IoEngine::Kind::EPOLL : xiunneg::IoEngine::Kind::IO_URING,
+            .buffer_count = static_cast<std::size_t>(std::max(1, g_config.engine.buffers)),
+            .buffer_size = static_cast<std::size_t>(std::max(4096, g_config.engine.buffer_size)),
+        };
+        // 逐请求与逐连接的日志限流, 各分片与四层透传各自计数
+        const module::LogLimiter::Config log_limit{
+            .burst = static_cast<uint32_t>(g_config.log.suppress_burst),
+            .window_ms = static_cast<uint32_t>(g_config.log.suppress_window_ms),
+            .max_keys = static_cast<std::size_t>(g_config.log.suppress_max_keys),
+            .sample_rate = g_config.log.info_sample_percent / 100.0,
+        };
+        for (std::size_t i = 0; i < shard_count; ++i) {
+            xiunneg::GatewayShard::Config shard_config{
+                .id = i,
+                .core = g_config.gateway.pin_cores ? static_cast<int>(i % cores) : -1,
+                .worker_threads = static_cast<std::size_t>(std::max(0, g_config.gateway.worker_threads)),
+                .async_io = g_config.engine.type != "httplib",
+                .engine = engine_config,
+                .journal_size = static_cast<std::size_t>(g_config.gateway.journal_size),
+                .max_streams = static_cast<std::size_t>(g_config.gateway.max_streams),
+                .log_limit = log_limit,
+            };
+            std::shared_ptr<module::SimpleLoggerInterface> shard_logger = proxy_gateway_logger;
+            if (shard_count > 1) {
+                shard_logger = make_logger(std::format("proxy_gateway_logger_{}", i));
+            }
+            shards.push_back(std::make_unique<xiunneg::GatewayShard>(shard_config, shard_logger));
+        }
+
+        // 零拷贝转发, 仅 Linux 可用
+        if (g_config.relay.splice) {
+            if (xiunneg::SpliceRelay::supported()) {
+                context.splice_relay = std::make_unique<xiunneg::SpliceRelay>(xiunneg::SpliceRelay::Config{
+                    .min_splice_bytes = static_cast<std::size_t>(std::max(0, g_config.relay.splice_min_bytes)),
+                });
+            } else {
+                proxy_gateway_logger->warn("当前平台不支持 splice, 零拷贝转发未启用");
+            }
+        }
+
+        // 四层透传, 仅 Linux 可用
+        std::unique_ptr<xiunneg::L4Relay> l4_relay;
+        if (g_config.l4.listen_base > 0 || g_config.l4.preamble_port > 0) {
+            if (xiunneg::L4Relay::supported()) {
+                auto l4_logger = make_logger("proxy_l4_logger");
+                l4_relay = std::make_unique<xiunneg::L4Relay>(xiunneg::L4Relay::Config{
+                                                                  .host = g_config.base.host,
+                                                                  .base_port = g_config.base.base_port,
+                                                                  .listen_base = g_config.l4.listen_base,
+                                                                  .preamble_port = g_config.l4.preamble_port,
+                                                                  .idle_timeout_sec = g_config.l4.idle_timeout_sec,
+                                                                  .engine = engine_config,
+                                                                  .log_limit = log_limit,
+                                                              },
+                                                              l4_logger);
+                context.l4_relay = l4_relay.get();
+            } else {
+                proxy_gateway_logger->warn("当前平台不支持异步 I/O 引擎, 四层透传未启用");
+            }
+        }
+
+        // 扫描器订阅 gossip 节点, 须先于 scanner_stopper 声明
+        std::unique_ptr<xiunneg::GossipNode> gossip;
+
+        // 扫描器以不可变快照的形式向各分片投递端口集合
+        port_scanner.subscribe([&context, &l4_relay](const xiunneg::PortScanner::SnapshotPtr &snapshot) {
+            // 每个版本只渲染一次 /machine-list, 各分片共享
+            context.machine_list.store(render_machine_list(*snapshot), std::memory_order_release);
+            for (auto &shard : context.shards) {
+                shard->on_snapshot(snapshot);
+            }
+            if (l4_relay) {
+                l4_relay->on_snapshot(snapshot);
+            }
+            if (context.splice_relay) {
+                // 与分片连接池一致, 换了进程的端口上的空闲连接一并丢弃
+                auto live = snapshot->ports;
+                for (auto port : snapshot->rebound) {
+                    live.erase(port);
+                }
+                context.splice_relay->retain(live);
             }
         });
+        // 首次扫描同步完成后才开始监听, 启动后的首批请求不会因快照为空被拒绝
+        auto first_scan_begin = std::chrono::steady_clock::now();
+        port_scanner.run();
+        // 之后的提前返回会先析构分片与四层透传, 须先停止仍在回调它们的扫描线程
+        ScannerStopper scanner_stopper{port_scanner};
+        context.first_scan_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - first_scan_begin).count();
+
+        // 服务注册: 注册表变化时与扫描结果合并, 发布同一路由视图
+        std::unique_ptr<xiunneg::ServiceRegistry> registry;
+        if (g_config.registry) {
+            auto registry_logger = make_logger("proxy_registry_logger");
+            registry = std::make_unique<xiunneg::ServiceRegistry>(xiunneg::ServiceRegistry::Config{
+                                                                      .tick_ms = static_cast<uint32_t>(g_config.registry->tick_ms),
+                                                                      .default_ttl_ms = static_cast<uint32_t>(g_config.registry->default_ttl_ms),
+                                                                      .max_ttl_ms = static_cast<uint32_t>(g_config.registry->max_ttl_ms),
+                                                                  },
+                                                                  registry_logger);
+            registry->set_listener([&port_scanner](const std::map<uint16_t, xiunneg::PortScanner::ServiceInfo> &services) {
+                port_scanner.update_registered(services);
+            });
+            registry->run();
+            context.registry = registry.get();
+        }
+
+        // 访问日志: 各线程格式化到本线程缓冲区, 后台线程批量写出
+        std::unique_ptr<xiunneg::AccessLog> access_log;
+        if (g_config.access_log) {
+            xiunneg::AccessLog::Config access_log_config{
+                .path = g_config.access_log->path,
+                .format = g_config.access_log->format,
+                .buffer_bytes = static_cast<std::size_t>(g_config.access_log->buffer_bytes),
+                .flush_interval_ms = static_cast<uint32_t>(g_config.access_log->flush_interval_ms),
+            };
+            access_log = std::make_unique<xiunneg::AccessLog>(access_log_config);
+            if (!access_log->open()) {
+                proxy_gateway_logger->error(std::format("打开访问日志 {} 失败", g_config.access_log->path));
+                return -1;
+            }
+            context.access_log = access_log.get();
+        }
+
+        // gossip: 向其他网关发布本机视图, 其他网关的服务补充到本机没有的编号上
+        if (g_config.gossip) {
+            auto gossip_logger = make_logger("proxy_gossip_logger");
+            gossip = std::make_unique<xiunneg::GossipNode>(xiunneg::GossipNode::Config{
+                                                               .bind_host = g_config.gossip->bind,
+                                                               .port = g_config.gossip->port,
+                                                               .advertise_host = g_config.gossip->advertise_host,
+                                                               .seeds = g_config.gossip->seeds,
+                                                               .secret = g_config.gossip->secret,
+                                                               .period_ms = static_cast<uint32_t>(g_config.gossip->period_ms),
+                                                               .ping_timeout_ms = static_cast<uint32_t>(std::max(1, g_config.gossip->period_ms * 2 / 5)),
+                                                               .suspect_timeout_ms = static_cast<uint32_t>(g_config.gossip->suspect_timeout_ms),
+                                                           },
+                                                           gossip_logger);
+            gossip->set_view_listener([&port_scanner](const std::map<uint16_t, xiunneg::PortScanner::RemoteEndpoint> &peers) {
+                port_scanner.update_peers(peers);
+            });
+            // 其他网关的判定只触发本机加速重扫, 由本机扫描确认后再改变路由;
+            // 直接剔除会使两个网关互相触发剔除, 服务在线时也反复抖动
+            gossip->set_verdict_listener([&port_scanner](uint16_t key, const xiunneg::PortScanner::RemoteEndpoint &endpoint, bool alive) {
+                auto local = gossip_services(*port_scanner.get_snapshot());
+                auto it = local.find(key);
+                if (alive ? it == local.end() : (it != local.end() && it->second == endpoint)) {
+                    port_scanner.accelerate();
+                }
+            });
+            if (!gossip->start()) {
+                return -1;
+            }
+            // 报文可改写其他网关的服务视图, 监听回环以外的地址却未设置密钥时提醒
+            const auto &bind = g_config.gossip->bind.empty() ? g_config.gossip->advertise_host : g_config.gossip->bind;
+            if (g_config.gossip->secret.empty() && !bind.starts_with("127.") && bind != "::1") {
+                gossip_logger->warn(std::format("gossip 监听 {} 但未设置 secret, 报文未经认证, 仅可在可信网络中使用", bind));
+            }
+            // 启动成功后才订阅, 扫描线程不会见到未启动或已释放的节点
+            port_scanner.subscribe([&gossip](const xiunneg::PortScanner::SnapshotPtr &snapshot) {
+                gossip->publish_local(gossip_services(*snapshot));
+            });
+            context.gossip = gossip.get();
+        }
+
+        if (l4_relay && !l4_relay->start()) {
+            return -1;
+        }
 
-        proxy_gateway.listen(g_host, g_port);
+        for (auto &shard : shards) {
+            register_routes(*shard, context);
+            if (!shard->bind(g_config.base.host, g_config.base.port)) {
+                return -1;
+            }
+        }
+        context.startup_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startup_begin).count();
+        for (auto &shard : shards) {
+            shard->start();
+        }
+        proxy_gateway_logger->info(std::format("网关就绪, 启动耗时 {}ms, 其中首次扫描 {}ms, 服务 {} 个",
+                                               context.startup_ms, context.first_scan_ms, port_scanner.get_snapshot()->ports.size()));
+        for (auto &shard : shards) {
+            shard->join();
+        }
     } catch (const std::exception &e) {
         std::cerr << "程序发生错误: " << e.what() << std::endl;
     } catch (...) {
@@ -168,4 +1706,4 @@ int main() {
     }
 
     return 0;
-}
\ No newline at end of file
+}
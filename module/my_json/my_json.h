@@ -9,7 +9,8 @@
  * @brief 序列化 to_json:: 基于 Boost.pfr、Jsoncpp 与 C++17折叠表达式,使 聚合POD 类型获得 '定义即序列化' 的能力，无需编写序列化接口，只出不进
  *  json 与 STL 的对应关系
  *  json_array -> std::vector
- * @brief 反序列化 from_json:: 提取json元素
+ * @brief 反序列化 from_json:: 提取json元素; from_json() 按字段名把 json 对象递归填入 聚合POD, 与 to_json 对称
+ *  json_array -> std::vector, json_object -> 嵌套 POD 或 std::map, 缺省字段 -> std::optional 为空
  * ************************************************************************
  * ************************************************************************
  */
@@ -27,7 +28,12 @@
 #include <string>
 #include <string_view>
 #include <array>
+#include <charconv>
+#include <map>
+#include <optional>
+#include <stdexcept>
 #include <type_traits>
+#include <utility>
 #include <fstream>
 #include <format> //
 
@@ -140,12 +146,12 @@ static inline std::string dump(const Json::Value &j, int dent = 0) {
 
 /**
  * ************************************************************************
- * @brief from_json 只支持到 字段 级
- *
- * TODO: 2026年度 开发计划，递归嵌套级反序列到 组合式 POD
+ * @brief from_json 提供 字段 级的 get_value 与 递归嵌套级的 from_json()
  * ************************************************************************
  */
 namespace module::from_json {
+namespace pfr = boost::pfr;
+
 template <typename T>
 concept FROM_JSON_TYPE =
     std::is_same_v<T, std::string>
@@ -213,4 +219,154 @@ static inline T get_value_or(const Json::Value &root, std::string_view key, T da
     }
 }
 
+namespace detail {
+template <typename T>
+struct is_vector : std::false_type {};
+template <typename T, typename A>
+struct is_vector<std::vector<T, A>> : std::true_type {};
+
+template <typename T>
+struct is_optional : std::false_type {};
+template <typename T>
+struct is_optional<std::optional<T>> : std::true_type {};
+
+template <typename T>
+struct is_map : std::false_type {};
+template <typename K, typename V, typename C, typename A>
+struct is_map<std::map<K, V, C, A>> : std::true_type {};
+
+static inline std::invalid_argument type_error(const std::string &path, std::string_view expect) {
+    return std::invalid_argument(std::format("key[{}] 不是期望的类型 {}!", path, expect));
+}
+
+template <typename T>
+void from_json_value(const Json::Value &json, T &value, const std::string &path);
+
+// 整数按目标类型检查范围, 不静默截断
+template <typename T>
+T to_integral(const Json::Value &json, const std::string &path) {
+    auto check = [&path](auto number) {
+        if (!std::in_range<T>(number)) {
+            throw std::invalid_argument(std::format("key[{}] 的值 {} 超出范围!", path, number));
+        }
+        return static_cast<T>(number);
+    };
+    if (json.isInt64()) return check(json.asInt64());
+    if (json.isUInt64()) return check(json.asUInt64());
+    throw type_error(path, "Integer");
+}
+
+// 枚举以字符串表示, 由与枚举同一命名空间的 parse_enum(std::string_view, E &) 解析; 未提供时取整数值
+template <typename T>
+void to_enum(const Json::Value &json, T &value, const std::string &path) {
+    if constexpr (requires { { parse_enum(std::string_view{}, value) } -> std::convertible_to<bool>; }) {
+        if (json.isString()) {
+            if (!parse_enum(std::string_view(json.asString()), value)) {
+                throw std::invalid_argument(std::format("key[{}] 的值 {} 无效!", path, json.asString()));
+            }
+            return;
+        }
+    }
+    value = static_cast<T>(to_integral<std::underlying_type_t<T>>(json, path));
+}
+
+// std::map 的键: 字符串、整数或枚举
+template <typename K>
+K to_key(const std::string &name, const std::string &path) {
+    if constexpr (std::is_same_v<K, std::string>) {
+        return name;
+    } else if constexpr (std::is_integral_v<K>) {
+        K key{};
+        auto [end, ec] = std::from_chars(name.data(), name.data() + name.size(), key);
+        if (ec != std::errc{} || end != name.data() + name.size()) {
+            throw std::invalid_argument(std::format("key[{}.{}] 不是有效的整数键!", path, name));
+        }
+        return key;
+    } else {
+        static_assert(std::is_enum_v<K>, "from_json: std::map 的键须为 std::string、整数或枚举");
+        K key{};
+        to_enum(Json::Value(name), key, path + "." + name);
+        return key;
+    }
+}
+
+template <typename T>
+void from_json_value(const Json::Value &json, T &value, const std::string &path) {
+    if constexpr (std::is_same_v<T, bool>) {
+        if (!json.isBool()) throw type_error(path, "Boolean");
+        value = json.asBool();
+    } else if constexpr (std::is_integral_v<T>) {
+        value = to_integral<T>(json, path);
+    } else if constexpr (std::is_floating_point_v<T>) {
+        if (!json.isNumeric()) throw type_error(path, "Real");
+        value = static_cast<T>(json.asDouble());
+    } else if constexpr (std::is_same_v<T, std::string>) {
+        if (!json.isString()) throw type_error(path, "String");
+        value = json.asString();
+    } else if constexpr (std::is_enum_v<T>) {
+        to_enum(json, value, path);
+    } else if constexpr (is_optional<T>::value) {
+        typename T::value_type item{};
+        from_json_value(json, item, path);
+        value = std::move(item);
+    } else if constexpr (is_vector<T>::value) {
+        if (!json.isArray()) throw type_error(path, "Array");
+        value.clear();
+        for (Json::ArrayIndex i = 0; i < json.size(); ++i) {
+            typename T::value_type item{};
+            from_json_value(json[i], item, std::format("{}[{}]", path, i));
+            value.push_back(std::move(item));
+        }
+    } else if constexpr (is_map<T>::value) {
+        if (!json.isObject()) throw type_error(path, "Object");
+        value.clear();
+        for (const auto &name : json.getMemberNames()) {
+            typename T::mapped_type item{};
+            from_json_value(json[name], item, path + "." + name);
+            value.insert_or_assign(to_key<typename T::key_type>(name, path), std::move(item));
+        }
+    } else {
+        static_assert(std::is_aggregate_v<T>, "from_json: T must be a C++ aggregate (POD) type");
+        if (!json.isObject()) throw type_error(path, "Object");
+        constexpr auto names = pfr::names_as_array<T>();
+        std::apply(
+            [&json, &path, &names](auto &...fields) {
+                std::size_t i = 0;
+                // json 缺少的字段保留默认成员初始化的值
+                ([&json, &path, &names, &i](auto &field) {
+                    std::string name(names[i++]);
+                    // 末尾的 _ 不计入键名, 用于避开关键字与宏, 如 unix_ 对应 "unix"
+                    if (name.size() > 1 && name.back() == '_') name.pop_back();
+                    if (json.isMember(name)) {
+                        from_json_value(json[name], field, path.empty() ? name : path + "." + name);
+                    }
+                }(fields),
+                 ...);
+            },
+            pfr::structure_tie(value));
+    }
+}
+} // namespace detail
+
+/**
+ * ************************************************************************
+ * @brief 核心接口,按 PFR 字段名将 Json 对象反序列化到 聚合POD, 支持嵌套
+ *  bool / 整数(检查范围) / 浮点 / std::string / 枚举 / std::vector / std::optional / std::map / 嵌套 POD;
+ *  json 缺少的字段保留默认值, std::optional 字段缺省时为空, 多余的键忽略; 字段名末尾的 _ 不计入键名
+ *
+ * @param[in] root  Json 对象
+ * @param[out] structure  POD, 调用前的值即各字段的默认值
+ *
+ * @exception 类型错误或取值超出范围, throw std::invalid_argument, 消息中带字段路径
+ * ************************************************************************
+ */
+template <typename T>
+void from_json(const Json::Value &root, T &structure) {
+    static_assert(
+        std::is_aggregate_v<T>,
+        "serialization::from_json: T must be a C++ aggregate (POD) type. "
+        "Ensure no private members, user-defined constructors, or virtual functions.");
+    detail::from_json_value(root, structure, "");
+}
+
 } // namespace module::from_json
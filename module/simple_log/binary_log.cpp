@@ -0,0 +1,226 @@
+// binary_log.cpp
+#include "binary_log.h"
+
+using namespace module;
+
+namespace {
+std::atomic<uint64_t> g_next_instance{1};
+
+// 调用点表, 下标即 id; 以函数内静态变量避免静态初始化顺序问题
+struct SiteTable {
+    std::mutex mtx;
+    std::vector<binlog::Site> sites;
+};
+
+SiteTable &site_table() {
+    static SiteTable table;
+    return table;
+}
+
+template <typename T>
+void append(std::string &out, const T &value) {
+    out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+void append_string(std::string &out, std::string_view text) {
+    append(out, static_cast<uint32_t>(text.size()));
+    out.append(text);
+}
+
+void append_block(std::string &out, binlog::BlockKind kind, const std::string &payload) {
+    append(out, kind);
+    append(out, static_cast<uint32_t>(payload.size()));
+    out.append(payload);
+}
+
+std::string clock_block(uint64_t dropped) {
+    std::string payload;
+    append(payload, binlog::now_ticks());
+    append(payload, static_cast<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count()));
+    append(payload, dropped);
+    std::string block;
+    append_block(block, binlog::BlockKind::CLOCK, payload);
+    return block;
+}
+} // namespace
+
+uint32_t binlog::register_site(const SiteInfo &info, std::vector<ArgType> args) {
+    auto &table = site_table();
+    std::lock_guard<std::mutex> lock(table.mtx);
+    table.sites.push_back(Site{info, std::move(args)});
+    return static_cast<uint32_t>(table.sites.size() - 1);
+}
+
+std::vector<binlog::Site> binlog::sites_since(std::size_t from) {
+    auto &table = site_table();
+    std::lock_guard<std::mutex> lock(table.mtx);
+    if (from >= table.sites.size()) return {};
+    return std::vector<Site>(table.sites.begin() + from, table.sites.end());
+}
+
+BinaryLogWriter::BinaryLogWriter(const Config &config) :
+    config_(config),
+    instance_(g_next_instance.fetch_add(1, std::memory_order_relaxed)) {
+    config_.buffer_bytes = std::max<std::size_t>(config_.buffer_bytes, 64 * 1024);
+    config_.flush_interval_ms = std::max<uint32_t>(config_.flush_interval_ms, 1);
+}
+
+BinaryLogWriter::~BinaryLogWriter() {
+    close();
+}
+
+bool BinaryLogWriter::open() {
+    // 追加写入; 重启后的进程另写文件头, 解码时据此重置调用点与日志器表
+    file_.open(config_.path, std::ios::out | std::ios::app | std::ios::binary);
+    if (!file_.is_open()) return false;
+    file_.write(binlog::FILE_MAGIC, sizeof(binlog::FILE_MAGIC));
+    auto block = clock_block(0);
+    file_.write(block.data(), static_cast<std::streamsize>(block.size()));
+    file_.flush();
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    running_ = true;
+    flusher_ = std::thread([this]() {
+        run();
+    });
+    return true;
+}
+
+void BinaryLogWriter::close() {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (!running_) return;
+        running_ = false;
+    }
+    cv_.notify_one();
+    if (flusher_.joinable())
+        flusher_.join();
+    flush(true);
+    file_.close();
+}
+
+uint16_t BinaryLogWriter::register_logger(const std::string &name) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    loggers_.push_back(name);
+    return static_cast<uint16_t>(loggers_.size() - 1);
+}
+
+std::shared_ptr<binlog::StagingBuffer> BinaryLogWriter::create_buffer() {
+    auto buffer = std::make_shared<binlog::StagingBuffer>(config_.buffer_bytes);
+    std::lock_guard<std::mutex> lock(mtx_);
+    buffers_.push_back(buffer);
+    return buffer;
+}
+
+void BinaryLogWriter::run() {
+    std::unique_lock<std::mutex> lock(mtx_);
+    while (running_) {
+        cv_.wait_for(lock, std::chrono::milliseconds(config_.flush_interval_ms), [this]() {
+            return !running_;
+        });
+        lock.unlock();
+        flush(false);
+        lock.lock();
+    }
+}
+
+void BinaryLogWriter::flush(bool final) {
+    std::vector<std::shared_ptr<binlog::StagingBuffer>> buffers;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        buffers = buffers_;
+    }
+
+    // 先取出记录再读取调用点与日志器: 记录可见时其调用点与日志器必已登记
+    std::string records;
+    std::vector<binlog::StagingBuffer *> orphaned;
+    for (auto &buffer : buffers) {
+        // 只剩本函数与 buffers_ 持有时所属线程已退出, 不会再写入, 取空后即可移除;
+        // 须在取出之前判断, 之后才退出的线程可能还有未取出的记录
+        bool owner_exited = buffer.use_count() == 2;
+        for (int segment = 0; segment < 2; ++segment) {
+            std::size_t bytes = 0;
+            auto *data = buffer->peek(bytes);
+            if (bytes == 0) break;
+            records.append(data, bytes);
+            buffer->consume(bytes);
+        }
+        std::size_t rest = 0;
+        buffer->peek(rest);
+        if (owner_exited && rest == 0) {
+            orphaned.push_back(buffer.get());
+        }
+    }
+    buffers.clear();
+
+    std::string out;
+    for (const auto &site : binlog::sites_since(written_sites_)) {
+        std::string payload;
+        append(payload, static_cast<uint32_t>(written_sites_++));
+        append(payload, site.info.level);
+        append(payload, site.info.line);
+        append_string(payload, site.info.file);
+        append_string(payload, site.info.format);
+        append(payload, static_cast<uint8_t>(site.args.size()));
+        for (auto type : site.args) {
+            append(payload, type);
+        }
+        append_block(out, binlog::BlockKind::SITE, payload);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        for (; written_loggers_ < loggers_.size(); ++written_loggers_) {
+            std::string payload;
+            append(payload, static_cast<uint16_t>(written_loggers_));
+            append_string(payload, loggers_[written_loggers_]);
+            append_block(out, binlog::BlockKind::LOGGER, payload);
+        }
+        if (!orphaned.empty()) {
+            std::erase_if(buffers_, [&orphaned](const auto &buffer) {
+                return std::find(orphaned.begin(), orphaned.end(), buffer.get()) != orphaned.end();
+            });
+        }
+    }
+
+    if (!records.empty()) {
+        append_block(out, binlog::BlockKind::RECORDS, records);
+    }
+    // 有记录时附带时钟校准, 解码时以首尾两次校准换算时间
+    if (!records.empty() || final) {
+        out += clock_block(dropped());
+    }
+    if (out.empty()) return;
+    file_.write(out.data(), static_cast<std::streamsize>(out.size()));
+    file_.flush();
+}
+
+BinaryLogger::BinaryLogger(const std::string &name, std::shared_ptr<BinaryLogWriter> writer) :
+    name_(name),
+    writer_(std::move(writer)),
+    id_(writer_->register_logger(name)) {
+}
+
+void BinaryLogger::trace(std::string_view log) {
+    if (!enabled(LogLevel::TRACE)) return;
+    write([] { return binlog::SiteInfo{LogLevel::TRACE, __FILE__, __LINE__, "{}"}; }, log);
+}
+
+void BinaryLogger::debug(std::string_view log) {
+    if (!enabled(LogLevel::DEBUG)) return;
+    write([] { return binlog::SiteInfo{LogLevel::DEBUG, __FILE__, __LINE__, "{}"}; }, log);
+}
+
+void BinaryLogger::info(std::string_view log) {
+    if (!enabled(LogLevel::INFO)) return;
+    write([] { return binlog::SiteInfo{LogLevel::INFO, __FILE__, __LINE__, "{}"}; }, log);
+}
+
+void BinaryLogger::error(std::string_view log) {
+    if (!enabled(LogLevel::ERR)) return;
+    write([] { return binlog::SiteInfo{LogLevel::ERR, __FILE__, __LINE__, "{}"}; }, log);
+}
+
+void BinaryLogger::warn(std::string_view log) {
+    if (!enabled(LogLevel::WARN)) return;
+    write([] { return binlog::SiteInfo{LogLevel::WARN, __FILE__, __LINE__, "{}"}; }, log);
+}
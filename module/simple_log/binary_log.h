@@ -0,0 +1,351 @@
+// binary_log.h
+#pragma once
+
+/**
+ * ************************************************************************
+ *
+ * @file binary_log.h
+ * @brief 延迟格式化的二进制日志: 调用点只写入调用点 id、时间戳计数与原始参数,
+ *        格式串在调用点首次执行时登记一次; 记录写入本线程的无锁环形缓冲区,
+ *        由后台线程整块写入文件, 格式化交给离线解码工具 tools/binlog_decode
+ * ************************************************************************
+ */
+
+#include "simple_log.h"
+
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define SIMPLE_LOG_HAS_TSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define SIMPLE_LOG_HAS_TSC 1
+#endif
+
+namespace module {
+namespace binlog {
+// 文件格式: 8 字节文件头, 之后为若干块, 每块为 1 字节类型、4 字节长度与内容;
+// 整数均为本机字节序, 字符串为 4 字节长度加内容
+inline constexpr char FILE_MAGIC[8] = {'G', 'W', 'B', 'L', 'O', 'G', '\0', '\1'};
+
+enum class BlockKind : uint8_t {
+    SITE = 1, // 调用点: id、级别、行号、源文件、格式串、参数个数与类型
+    LOGGER,   // 日志器: id、名称
+    CLOCK,    // 时钟校准: 时间戳计数、Unix 纳秒、累计丢弃的记录数
+    RECORDS   // 记录: 调用点 id、日志器 id、时间戳计数, 之后按调用点的参数类型依次存放参数
+};
+
+enum class ArgType : uint8_t {
+    INT,   // int64_t
+    UINT,  // uint64_t
+    FLOAT, // double
+    BOOL,  // uint8_t
+    STRING // 4 字节长度加内容
+};
+
+inline constexpr std::size_t RECORD_HEADER_BYTES = 4 + 2 + 8;
+inline constexpr uint32_t MAX_STRING_BYTES = 4096; // 更长的字符串参数截断
+
+template <typename T>
+constexpr ArgType arg_type() {
+    using U = std::remove_cvref_t<T>;
+    if constexpr (std::is_same_v<U, bool>) {
+        return ArgType::BOOL;
+    } else if constexpr (std::is_integral_v<U>) {
+        static_assert(!std::is_same_v<U, char>, "char 参数请转为 std::string_view 或整数");
+        return std::is_signed_v<U> ? ArgType::INT : ArgType::UINT;
+    } else if constexpr (std::is_floating_point_v<U>) {
+        return ArgType::FLOAT;
+    } else {
+        static_assert(std::is_convertible_v<const T &, std::string_view>, "二进制日志只支持整数、浮点数、布尔值与字符串参数");
+        return ArgType::STRING;
+    }
+}
+
+template <typename T>
+std::size_t encoded_size(const T &value) {
+    if constexpr (arg_type<T>() == ArgType::BOOL) {
+        return 1;
+    } else if constexpr (arg_type<T>() == ArgType::STRING) {
+        return 4 + std::min<std::size_t>(std::string_view(value).size(), MAX_STRING_BYTES);
+    } else {
+        return 8;
+    }
+}
+
+template <typename T>
+char *put(char *out, const T &value) {
+    std::memcpy(out, &value, sizeof(T));
+    return out + sizeof(T);
+}
+
+template <typename T>
+char *encode(char *out, const T &value) {
+    if constexpr (arg_type<T>() == ArgType::BOOL) {
+        return put(out, static_cast<uint8_t>(value));
+    } else if constexpr (arg_type<T>() == ArgType::INT) {
+        return put(out, static_cast<int64_t>(value));
+    } else if constexpr (arg_type<T>() == ArgType::UINT) {
+        return put(out, static_cast<uint64_t>(value));
+    } else if constexpr (arg_type<T>() == ArgType::FLOAT) {
+        return put(out, static_cast<double>(value));
+    } else {
+        std::string_view text(value);
+        auto length = static_cast<uint32_t>(std::min<std::size_t>(text.size(), MAX_STRING_BYTES));
+        out = put(out, length);
+        std::memcpy(out, text.data(), length);
+        return out + length;
+    }
+}
+
+// 时间戳计数: x86 上为 TSC, 其他平台为 steady_clock 纳秒; 由 CLOCK 块换算为绝对时间
+inline uint64_t now_ticks() {
+#ifdef SIMPLE_LOG_HAS_TSC
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+// 调用点的静态信息, 由宏在调用点生成
+struct SiteInfo {
+    LogLevel level;
+    const char *file;
+    uint32_t line;
+    const char *format;
+};
+
+struct Site {
+    SiteInfo info;
+    std::vector<ArgType> args;
+};
+
+// 登记调用点, 返回进程内唯一的 id; 每个调用点只在首次执行时登记
+uint32_t register_site(const SiteInfo &info, std::vector<ArgType> args);
+// id 不小于 from 的全部调用点
+std::vector<Site> sites_since(std::size_t from);
+
+/**
+ * ************************************************************************
+ * @brief 单生产者单消费者的环形缓冲区, 所属线程写入、后台线程取出;
+ *        一条记录总是连续存放, 尾部放不下时回绕到开头
+ * ************************************************************************
+ */
+class StagingBuffer {
+    std::unique_ptr<char[]> data_;
+    std::size_t size_;
+    alignas(64) std::atomic<std::size_t> head_{0};     // 生产者已提交的位置
+    std::atomic<std::size_t> wrap_end_{0};             // 回绕前的数据末尾, 以 head_ 的 release 发布
+    alignas(64) std::atomic<std::size_t> tail_{0};     // 消费者已取出的位置
+
+public:
+    explicit StagingBuffer(std::size_t size) :
+        data_(std::make_unique<char[]>(size)),
+        size_(size) {}
+
+    // 预留 bytes 字节, 空间不足返回 nullptr
+    char *reserve(std::size_t bytes) {
+        auto head = head_.load(std::memory_order_relaxed);
+        auto tail = tail_.load(std::memory_order_acquire);
+        if (tail <= head) {
+            if (size_ - head > bytes) return data_.get() + head;
+            // 严格大于, 保证回绕后 head 不会追上 tail
+            if (tail > bytes) {
+                wrap_end_.store(head, std::memory_order_relaxed);
+                head_.store(0, std::memory_order_release);
+                return data_.get();
+            }
+            return nullptr;
+        }
+        if (tail - head > bytes) return data_.get() + head;
+        return nullptr;
+    }
+
+    void commit(std::size_t bytes) {
+        head_.store(head_.load(std::memory_order_relaxed) + bytes, std::memory_order_release);
+    }
+
+    // 消费者: 取一段连续的已提交数据, 无数据时 bytes 为 0
+    const char *peek(std::size_t &bytes) {
+        auto head = head_.load(std::memory_order_acquire);
+        auto tail = tail_.load(std::memory_order_relaxed);
+        if (tail > head) {
+            auto end = wrap_end_.load(std::memory_order_relaxed);
+            if (tail < end) {
+                bytes = end - tail;
+                return data_.get() + tail;
+            }
+            tail = 0;
+            tail_.store(0, std::memory_order_release);
+        }
+        bytes = head - tail;
+        return data_.get() + tail;
+    }
+
+    void consume(std::size_t bytes) {
+        tail_.store(tail_.load(std::memory_order_relaxed) + bytes, std::memory_order_release);
+    }
+};
+} // namespace binlog
+
+/**
+ * ************************************************************************
+ * @brief 二进制日志文件, 多个日志器共用; 每个线程一个环形缓冲区,
+ *        后台线程每 flush_interval_ms 取出全部缓冲区写入文件,
+ *        缓冲区写满时丢弃新记录并计数, 调用线程从不阻塞
+ * ************************************************************************
+ */
+class BinaryLogWriter {
+public:
+    struct Config {
+        std::string path = "gateway.blog";
+        std::size_t buffer_bytes = 1 << 20; // 每个线程的环形缓冲区字节数
+        uint32_t flush_interval_ms = 100;   // 后台线程取出缓冲区的周期
+    };
+
+private:
+    Config config_;
+    uint64_t instance_; // 区分先后创建的实例, 线程局部缓存以此判断缓冲区归属
+
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::vector<std::shared_ptr<binlog::StagingBuffer>> buffers_;
+    std::vector<std::string> loggers_; // 日志器名称, 下标即 id
+    std::size_t written_loggers_ = 0;  // 已写入文件的日志器数
+    std::size_t written_sites_ = 0;    // 已写入文件的调用点数, 仅后台线程访问
+    bool running_ = false;
+    std::thread flusher_;
+
+    std::ofstream file_;
+    std::atomic<uint64_t> dropped_{0};
+
+public:
+    explicit BinaryLogWriter(const Config &config);
+    ~BinaryLogWriter();
+
+    BinaryLogWriter(const BinaryLogWriter &) = delete;
+    BinaryLogWriter &operator=(const BinaryLogWriter &) = delete;
+
+    // 打开文件并启动后台线程, 失败返回 false
+    bool open();
+    // 取出全部缓冲区并停止后台线程
+    void close();
+
+    uint16_t register_logger(const std::string &name);
+
+    binlog::StagingBuffer *local_buffer() {
+        struct Cached {
+            uint64_t instance = 0;
+            std::shared_ptr<binlog::StagingBuffer> buffer;
+        };
+        thread_local Cached cached;
+        if (cached.instance != instance_) {
+            cached = Cached{instance_, create_buffer()};
+        }
+        return cached.buffer.get();
+    }
+
+    void drop() { dropped_.fetch_add(1, std::memory_order_relaxed); }
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    std::shared_ptr<binlog::StagingBuffer> create_buffer();
+    void run();
+    void flush(bool final);
+};
+
+// 写入 BinaryLogWriter 的日志器, 不输出到控制台
+class BinaryLogger : public SimpleLoggerInterface {
+private:
+    std::string name_;
+    std::shared_ptr<BinaryLogWriter> writer_;
+    uint16_t id_;
+
+public:
+    BinaryLogger(const std::string &name, std::shared_ptr<BinaryLogWriter> writer);
+
+    // 已格式化的文本按 "{}" 调用点记录
+    void trace(std::string_view log) override;
+
+    void debug(std::string_view log) override;
+
+    void info(std::string_view log) override;
+
+    void error(std::string_view log) override;
+
+    void warn(std::string_view log) override;
+
+    BinaryLogger *binary() override { return this; }
+
+    /**
+     * ************************************************************************
+     * @brief 记录一条日志, 只拷贝参数, 不格式化; 一般经 SIMPLE_LOG_* 宏调用
+     *
+     * @param[in] site_fn  返回调用点信息的无捕获 lambda, 每个调用点的类型唯一
+     * @param[in] args     参数, 整数、浮点数、布尔值或字符串
+     * ************************************************************************
+     */
+    template <typename SiteFn, typename... Args>
+    void write(SiteFn, const Args &...args) {
+        static const uint32_t site = binlog::register_site(SiteFn{}(), {binlog::arg_type<Args>()...});
+        std::size_t bytes = binlog::RECORD_HEADER_BYTES + (std::size_t{0} + ... + binlog::encoded_size(args));
+        auto *buffer = writer_->local_buffer();
+        char *out = buffer->reserve(bytes);
+        if (out == nullptr) {
+            writer_->drop();
+            return;
+        }
+        out = binlog::put(out, site);
+        out = binlog::put(out, id_);
+        out = binlog::put(out, binlog::now_ticks());
+        ((out = binlog::encode(out, args)), ...);
+        buffer->commit(bytes);
+    }
+};
+} // namespace module
+
+// 级别是否编译进来; 默认 0 时比较恒为真, 会触发 -Wtype-limits, 与 enabled() 一致改在预处理期判断
+#if SIMPLE_LOG_MIN_LEVEL > 0
+#define SIMPLE_LOG_COMPILED(level) (static_cast<int>(level) >= SIMPLE_LOG_MIN_LEVEL)
+#else
+#define SIMPLE_LOG_COMPILED(level) true
+#endif
+
+// 带格式串的日志: 先按编译期与运行时级别过滤, 参数不会被求值;
+// 二进制日志器只记录参数, 其余日志器按 std::format 格式化
+#define SIMPLE_LOG(logger, level, method, fmt, ...)                                                   \
+    do {                                                                                               \
+        if constexpr (SIMPLE_LOG_COMPILED(level)) {                                                    \
+            auto &simple_log_logger_ = (logger);                                                       \
+            if (simple_log_logger_.enabled(level)) {                                                   \
+                if (auto *simple_log_binary_ = simple_log_logger_.binary()) {                          \
+                    simple_log_binary_->write([] {                                                     \
+                        return ::module::binlog::SiteInfo{level, __FILE__, __LINE__, fmt};             \
+                    }, ##__VA_ARGS__);                                                                 \
+                } else {                                                                               \
+                    simple_log_logger_.method(std::format(fmt, ##__VA_ARGS__));                        \
+                }                                                                                      \
+            }                                                                                          \
+        }                                                                                              \
+    } while (0)
+
+#define SIMPLE_LOG_TRACE(logger, fmt, ...) SIMPLE_LOG(logger, ::module::LogLevel::TRACE, trace, fmt, ##__VA_ARGS__)
+#define SIMPLE_LOG_DEBUG(logger, fmt, ...) SIMPLE_LOG(logger, ::module::LogLevel::DEBUG, debug, fmt, ##__VA_ARGS__)
+#define SIMPLE_LOG_INFO(logger, fmt, ...) SIMPLE_LOG(logger, ::module::LogLevel::INFO, info, fmt, ##__VA_ARGS__)
+#define SIMPLE_LOG_WARN(logger, fmt, ...) SIMPLE_LOG(logger, ::module::LogLevel::WARN, warn, fmt, ##__VA_ARGS__)
+#define SIMPLE_LOG_ERROR(logger, fmt, ...) SIMPLE_LOG(logger, ::module::LogLevel::ERR, error, fmt, ##__VA_ARGS__)
@@ -0,0 +1,164 @@
+// log_archiver.cpp
+#include "log_archiver.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#ifdef SIMPLE_LOG_ZLIB_SUPPORT
+#include <zlib.h>
+#endif
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace module;
+
+LogArchiver &LogArchiver::instance() {
+    static LogArchiver archiver;
+    return archiver;
+}
+
+LogArchiver::~LogArchiver() {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (!running_) return;
+        stopping_ = true;
+    }
+    cv_.notify_one();
+    if (worker_.joinable())
+        worker_.join();
+}
+
+bool LogArchiver::compression_supported() {
+#ifdef SIMPLE_LOG_ZLIB_SUPPORT
+    return true;
+#else
+    return false;
+#endif
+}
+
+void LogArchiver::submit(Job job) {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        jobs_.push_back(std::move(job));
+        if (!running_) {
+            running_ = true;
+            worker_ = std::thread([this]() {
+                run();
+            });
+        }
+    }
+    cv_.notify_one();
+}
+
+void LogArchiver::run() {
+    std::unique_lock<std::mutex> lock(mtx_);
+    for (;;) {
+        cv_.wait(lock, [this]() {
+            return stopping_ || !jobs_.empty();
+        });
+        // 退出前处理完已提交的文件, 避免留下未压缩的历史文件
+        if (jobs_.empty()) return;
+        auto job = std::move(jobs_.front());
+        jobs_.pop_front();
+        lock.unlock();
+
+        // 积压时前一次清理可能已删除该文件
+        std::error_code ec;
+        if (job.compress && compression_supported() && std::filesystem::exists(job.path, ec) && !compress(job.path)) {
+            std::cerr << "[ERROR] Failed to compress log file: " << job.path << std::endl;
+        }
+        if (job.retention > 0) {
+            prune(job.prefix, job.retention);
+        }
+
+        lock.lock();
+    }
+}
+
+bool LogArchiver::compress(const std::string &path) {
+#ifdef SIMPLE_LOG_ZLIB_SUPPORT
+    std::ifstream input(path, std::ios::in | std::ios::binary);
+    if (!input.is_open()) return false;
+
+    // 先写临时文件并落盘, 再替换为 .gz 并删除原文件, 中途退出不会丢失日志
+    auto temp_path = path + ".gz.tmp";
+#ifdef _WIN32
+    int fd = _open(temp_path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+    int fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+#endif
+    if (fd < 0) return false;
+#ifdef _WIN32
+    gzFile gz = gzdopen(_dup(fd), "wb6");
+#else
+    gzFile gz = gzdopen(::dup(fd), "wb6");
+#endif
+
+    bool ok = gz != nullptr;
+    std::vector<char> chunk(64 * 1024);
+    while (ok && input) {
+        input.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        auto n = input.gcount();
+        if (n > 0 && gzwrite(gz, chunk.data(), static_cast<unsigned>(n)) != n) ok = false;
+    }
+    if (gz != nullptr && gzclose(gz) != Z_OK) ok = false;
+#ifdef _WIN32
+    ok = ok && _commit(fd) == 0;
+    _close(fd);
+#else
+    ok = ok && ::fsync(fd) == 0;
+    ::close(fd);
+#endif
+    input.close();
+
+    std::error_code ec;
+    if (ok) {
+        std::filesystem::rename(temp_path, path + ".gz", ec);
+        ok = !ec;
+    }
+    if (!ok) {
+        std::filesystem::remove(temp_path, ec);
+        return false;
+    }
+    std::filesystem::remove(path, ec);
+    return true;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+void LogArchiver::prune(const std::string &prefix, uint32_t retention) {
+    std::filesystem::path prefix_path(prefix);
+    auto dir = prefix_path.parent_path();
+    if (dir.empty()) dir = ".";
+    auto name_prefix = prefix_path.filename().string();
+
+    // 历史文件名为 前缀 + 时间戳 + .log[.gz], 按名称排序即按时间排序
+    std::vector<std::filesystem::path> archived;
+    std::error_code ec;
+    for (const auto &entry : std::filesystem::directory_iterator(dir, ec)) {
+        auto name = entry.path().filename().string();
+        if (name.size() <= name_prefix.size() || name.compare(0, name_prefix.size(), name_prefix) != 0) continue;
+        if (!std::isdigit(static_cast<unsigned char>(name[name_prefix.size()]))) continue;
+        if (name.ends_with(".tmp")) continue;
+        archived.push_back(entry.path());
+    }
+    if (archived.size() <= retention) return;
+
+    std::sort(archived.begin(), archived.end());
+    for (std::size_t i = 0; i + retention < archived.size(); ++i) {
+        std::filesystem::remove(archived[i], ec);
+    }
+}
@@ -0,0 +1,55 @@
+// log_archiver.h
+#pragma once
+
+#include <stdint.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace module {
+/**
+ * ************************************************************************
+ * @brief 轮转后历史日志的后台处理: 压缩为 .gz(需 zlib, 编译时定义 SIMPLE_LOG_ZLIB_SUPPORT)、
+ *        落盘后删除原文件, 并按保留数删除最旧的历史文件; 进程内共用一个线程,
+ *        写日志的线程只做重命名, 不等待压缩与 fsync
+ * ************************************************************************
+ */
+class LogArchiver {
+public:
+    struct Job {
+        std::string path;   // 已重命名的历史文件
+        std::string prefix; // 同一日志的历史文件名前缀, 其后紧跟时间戳
+        uint32_t retention; // 保留的历史文件数, 0 为不删除
+        bool compress;
+    };
+
+private:
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::deque<Job> jobs_;
+    bool running_ = false;
+    bool stopping_ = false;
+    std::thread worker_;
+
+public:
+    static LogArchiver &instance();
+
+    LogArchiver(const LogArchiver &) = delete;
+    LogArchiver &operator=(const LogArchiver &) = delete;
+
+    // 提交一个历史文件, 首次提交时启动后台线程
+    void submit(Job job);
+
+    static bool compression_supported();
+
+private:
+    LogArchiver() = default;
+    ~LogArchiver();
+
+    void run();
+    static bool compress(const std::string &path);
+    static void prune(const std::string &prefix, uint32_t retention);
+};
+} // namespace module
@@ -0,0 +1,207 @@
+// log_limiter.cpp
+#include "log_limiter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <format>
+#include <random>
+#include <thread>
+
+using namespace module;
+
+namespace {
+// 进程内共用一个线程, 按最短的窗口周期调用各限流器的 flush_expired; 首个限流器创建时启动
+class LimiterTicker {
+private:
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::vector<std::pair<LogLimiter *, uint32_t>> limiters_; // 限流器 -> 窗口长度
+    bool stopping_ = false;
+    std::thread worker_;
+
+public:
+    static LimiterTicker &instance() {
+        static LimiterTicker ticker;
+        return ticker;
+    }
+
+    void add(LogLimiter *limiter, uint32_t window_ms) {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            limiters_.emplace_back(limiter, window_ms);
+            if (!worker_.joinable()) {
+                worker_ = std::thread([this]() {
+                    run();
+                });
+            }
+        }
+        cv_.notify_one();
+    }
+
+    // 调用 flush_expired 时持有 mtx_, 返回后限流器不会再被访问
+    void remove(LogLimiter *limiter) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        std::erase_if(limiters_, [limiter](const auto &item) {
+            return item.first == limiter;
+        });
+    }
+
+    ~LimiterTicker() {
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            stopping_ = true;
+        }
+        cv_.notify_one();
+        if (worker_.joinable())
+            worker_.join();
+    }
+
+private:
+    LimiterTicker() = default;
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        while (!stopping_) {
+            uint32_t period_ms = 1000;
+            for (const auto &[limiter, window_ms] : limiters_) {
+                period_ms = std::min(period_ms, window_ms);
+            }
+            cv_.wait_for(lock, std::chrono::milliseconds(period_ms), [this]() {
+                return stopping_;
+            });
+            for (const auto &[limiter, window_ms] : limiters_) {
+                limiter->flush_expired();
+            }
+        }
+    }
+};
+} // namespace
+
+LogLimiter::LogLimiter(const Config &config, std::shared_ptr<SimpleLoggerInterface> logger) :
+    config_(config),
+    logger_(std::move(logger)) {
+    config_.window_ms = std::max<uint32_t>(config_.window_ms, 1);
+    config_.max_keys = std::max<std::size_t>(config_.max_keys, 1);
+    if (config_.burst > 0) {
+        LimiterTicker::instance().add(this, config_.window_ms);
+    }
+}
+
+LogLimiter::~LogLimiter() {
+    if (config_.burst > 0) {
+        LimiterTicker::instance().remove(this);
+    }
+    std::vector<Summary> summaries;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        for (auto &[key, entry] : entries_) {
+            close_window(key, entry, summaries);
+        }
+        close_window({}, overflow_, summaries);
+    }
+    emit(summaries);
+}
+
+int64_t LogLimiter::now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void LogLimiter::close_window(std::string_view key, Entry &entry, std::vector<Summary> &summaries) const {
+    if (entry.suppressed > 0) {
+        summaries.emplace_back(entry.level, key.empty()
+                                                ? std::format("另有 {} 条日志被抑制(跟踪的键超过 {} 个)", entry.suppressed, config_.max_keys)
+                                                : std::format("另有 {} 条相似日志被抑制: {}", entry.suppressed, key));
+    }
+    entry.count = 0;
+    entry.suppressed = 0;
+}
+
+void LogLimiter::emit(const std::vector<Summary> &summaries) {
+    for (const auto &[level, text] : summaries) {
+        if (!logger_->enabled(level)) continue;
+        switch (level) {
+        case LogLevel::TRACE: logger_->trace(text); break;
+        case LogLevel::DEBUG: logger_->debug(text); break;
+        case LogLevel::INFO: logger_->info(text); break;
+        case LogLevel::WARN: logger_->warn(text); break;
+        case LogLevel::ERR: logger_->error(text); break;
+        }
+    }
+}
+
+void LogLimiter::sweep_locked(int64_t now, std::vector<Summary> &summaries) {
+    // 每个窗口清理一次已结束的键, 停止出现的键也能补上汇总
+    if (now < next_sweep_ms_) return;
+    next_sweep_ms_ = now + config_.window_ms;
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        if (now - it->second.window_start_ms < config_.window_ms) {
+            ++it;
+            continue;
+        }
+        close_window(it->first, it->second, summaries);
+        it = entries_.erase(it);
+    }
+    // 超出 max_keys 的共用计数同样按窗口结束
+    if (now - overflow_.window_start_ms >= config_.window_ms) {
+        close_window({}, overflow_, summaries);
+        overflow_.window_start_ms = now;
+    }
+}
+
+void LogLimiter::flush_expired() {
+    std::vector<Summary> summaries;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        sweep_locked(now_ms(), summaries);
+    }
+    emit(summaries);
+}
+
+bool LogLimiter::admit(LogLevel level, std::string_view key) {
+    if (config_.burst == 0) return true;
+
+    auto now = now_ms();
+    bool admitted = true;
+    std::vector<Summary> summaries;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        sweep_locked(now, summaries);
+
+        Entry *entry = nullptr;
+        if (auto it = entries_.find(key); it != entries_.end()) {
+            entry = &it->second;
+        } else if (entries_.size() < config_.max_keys) {
+            entry = &entries_.emplace(std::string(key), Entry{level, now, 0, 0}).first->second;
+        } else {
+            entry = &overflow_;
+            key = {};
+        }
+
+        if (now - entry->window_start_ms >= config_.window_ms) {
+            close_window(key, *entry, summaries);
+            entry->window_start_ms = now;
+        }
+        entry->level = std::max(entry->level, level);
+        if (++entry->count > config_.burst) {
+            --entry->count;
+            ++entry->suppressed;
+            admitted = false;
+        }
+    }
+    if (!admitted) {
+        suppressed_.fetch_add(1, std::memory_order_relaxed);
+    }
+    emit(summaries);
+    return admitted;
+}
+
+bool LogLimiter::sample() {
+    if (config_.sample_rate >= 1.0) return true;
+
+    thread_local std::minstd_rand rng(static_cast<uint32_t>(std::random_device{}() ^ std::hash<std::thread::id>{}(std::this_thread::get_id())));
+    std::uniform_real_distribution<double> distribution(0.0, 1.0);
+    if (distribution(rng) < config_.sample_rate) return true;
+    sampled_out_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
@@ -0,0 +1,112 @@
+// log_limiter.h
+#pragma once
+
+#include "binary_log.h"
+
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace module {
+/**
+ * ************************************************************************
+ * @brief 日志风暴抑制: 同一键在一个窗口内最多输出 burst 条, 其余计数后丢弃,
+ *        窗口结束后补一条 "另有 N 条相似日志被抑制" 的汇总, 进程内共用的后台线程定期输出, 不依赖后续日志;
+ *        另可按比例采样逐请求的 info 日志.
+ *        键通常取不含客户端地址的消息, 使只差来源地址的错误归为一类
+ * ************************************************************************
+ */
+class LogLimiter {
+public:
+    struct Config {
+        uint32_t burst = 10;          // 每个窗口内同一键最多输出的条数, 0 为不限制
+        uint32_t window_ms = 1000;    // 窗口长度
+        std::size_t max_keys = 1024;  // 同时跟踪的键数, 超出后新键共用一个计数
+        double sample_rate = 1.0;     // 逐请求 info 日志的采样率, 1 为全部输出
+    };
+
+private:
+    struct Entry {
+        LogLevel level;
+        int64_t window_start_ms;
+        uint32_t count;      // 窗口内已输出
+        uint64_t suppressed; // 窗口内已丢弃
+    };
+
+    // 以 string_view 查找, 未丢弃的键不必先构造 std::string
+    struct KeyHash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view key) const { return std::hash<std::string_view>{}(key); }
+    };
+
+    // 汇总在释放锁之后再写入日志器
+    using Summary = std::pair<LogLevel, std::string>;
+
+    Config config_;
+    std::shared_ptr<SimpleLoggerInterface> logger_;
+
+    std::mutex mtx_;
+    std::unordered_map<std::string, Entry, KeyHash, std::equal_to<>> entries_;
+    Entry overflow_{};
+    int64_t next_sweep_ms_ = 0;
+
+    std::atomic<uint64_t> suppressed_{0};
+    std::atomic<uint64_t> sampled_out_{0};
+
+public:
+    LogLimiter(const Config &config, std::shared_ptr<SimpleLoggerInterface> logger);
+    ~LogLimiter();
+
+    LogLimiter(const LogLimiter &) = delete;
+    LogLimiter &operator=(const LogLimiter &) = delete;
+
+    SimpleLoggerInterface &logger() { return *logger_; }
+
+    // 返回 false 时调用方应丢弃该条日志; 顺带输出已结束窗口的汇总
+    bool admit(LogLevel level, std::string_view key);
+
+    // 输出已结束窗口的汇总并移除其键, 由后台线程每个窗口调用一次
+    void flush_expired();
+
+    // 按 sample_rate 决定是否输出, 各线程独立取随机数
+    bool sample();
+
+    // 累计丢弃的条数, 供指标使用
+    uint64_t suppressed() const { return suppressed_.load(std::memory_order_relaxed); }
+    uint64_t sampled_out() const { return sampled_out_.load(std::memory_order_relaxed); }
+
+private:
+    static int64_t now_ms();
+    void close_window(std::string_view key, Entry &entry, std::vector<Summary> &summaries) const;
+    // 清理已结束窗口的键, 须持有 mtx_
+    void sweep_locked(int64_t now, std::vector<Summary> &summaries);
+    void emit(const std::vector<Summary> &summaries);
+};
+} // namespace module
+
+// 同一键限流后按 SIMPLE_LOG 记录, 被丢弃时不格式化
+#define SIMPLE_LOG_LIMITED(limiter, level, method, key, fmt, ...)                                      \
+    do {                                                                                               \
+        auto &simple_log_limiter_ = (limiter);                                                         \
+        if (simple_log_limiter_.logger().enabled(level) && simple_log_limiter_.admit(level, key)) {    \
+            SIMPLE_LOG(simple_log_limiter_.logger(), level, method, fmt, ##__VA_ARGS__);               \
+        }                                                                                              \
+    } while (0)
+
+#define SIMPLE_LOG_WARN_LIMITED(limiter, key, fmt, ...) SIMPLE_LOG_LIMITED(limiter, ::module::LogLevel::WARN, warn, key, fmt, ##__VA_ARGS__)
+#define SIMPLE_LOG_ERROR_LIMITED(limiter, key, fmt, ...) SIMPLE_LOG_LIMITED(limiter, ::module::LogLevel::ERR, error, key, fmt, ##__VA_ARGS__)
+
+// 逐请求的 info 日志, 按采样率输出
+#define SIMPLE_LOG_INFO_SAMPLED(limiter, fmt, ...)                                                     \
+    do {                                                                                               \
+        auto &simple_log_limiter_ = (limiter);                                                         \
+        if (simple_log_limiter_.logger().enabled(::module::LogLevel::INFO) && simple_log_limiter_.sample()) { \
+            SIMPLE_LOG_INFO(simple_log_limiter_.logger(), fmt, ##__VA_ARGS__);                         \
+        }                                                                                              \
+    } while (0)
@@ -0,0 +1,345 @@
+// log_sink.cpp
+#include "log_sink.h"
+#include "log_archiver.h"
+
+#include <algorithm>
+#include <ctime>
+#include <filesystem>
+#include <format>
+#include <iostream>
+
+#ifdef _WIN32
+#define _WINSOCK_DEPRECATED_NO_WARNINGS
+#define NOMINMAX // windows min() max() 冲突
+#include <ws2tcpip.h>
+
+#include <winsock2.h>
+#include <process.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using namespace module;
+
+namespace {
+constexpr std::uintptr_t INVALID_SOCKET_VALUE = ~static_cast<std::uintptr_t>(0);
+
+std::tm to_tm(std::time_t time, bool utc) {
+    std::tm tm_snapshot;
+#if defined(_MSC_VER)
+    if (utc) {
+        gmtime_s(&tm_snapshot, &time);
+    } else {
+        localtime_s(&tm_snapshot, &time);
+    }
+#else
+    if (utc) {
+        gmtime_r(&time, &tm_snapshot);
+    } else {
+        localtime_r(&time, &tm_snapshot);
+    }
+#endif
+    return tm_snapshot;
+}
+
+void close_socket(std::uintptr_t socket) {
+#ifdef _WIN32
+    closesocket(static_cast<SOCKET>(socket));
+#else
+    ::close(static_cast<int>(socket));
+#endif
+}
+
+// RFC 5424 严重性: 7 debug, 6 informational, 4 warning, 3 error
+int syslog_severity(LogLevel level) {
+    switch (level) {
+    case LogLevel::TRACE:
+    case LogLevel::DEBUG: return 7;
+    case LogLevel::INFO: return 6;
+    case LogLevel::WARN: return 4;
+    case LogLevel::ERR: return 3;
+    }
+    return 6;
+}
+} // namespace
+
+std::shared_ptr<ConsoleSink> ConsoleSink::instance() {
+    static auto sink = std::make_shared<ConsoleSink>();
+    return sink;
+}
+
+void ConsoleSink::write(const LogRecord &record) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    std::cout << record.line;
+}
+
+void ConsoleSink::flush() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    std::cout.flush();
+}
+
+FileSink::FileSink(const Config &config) :
+    config_(config) {
+}
+
+FileSink::~FileSink() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    write_out();
+}
+
+bool FileSink::open() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    file_.open(config_.path, std::ios::out | std::ios::app);
+    if (!file_.is_open()) return false;
+
+    std::error_code ec;
+    auto size = std::filesystem::file_size(config_.path, ec);
+    file_bytes_ = ec ? 0 : size;
+    if (config_.rotation.interval_s > 0) {
+        auto interval = std::chrono::seconds(config_.rotation.interval_s);
+        auto now = std::chrono::floor<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch());
+        next_rotation_ = std::chrono::system_clock::time_point(now / interval * interval + interval);
+    }
+    return true;
+}
+
+void FileSink::write(const LogRecord &record) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (!file_.is_open()) return;
+
+    if (rotation_due(record.time, record.line.size())) {
+        rotate(record.time);
+        if (!file_.is_open()) return;
+    }
+    buffer_.append(record.line);
+    file_bytes_ += record.line.size();
+    // WARN 及以上立即落到文件, 进程异常退出时不会留在缓冲区
+    if (record.level >= LogLevel::WARN) {
+        write_out();
+        file_.flush();
+    } else if (buffer_.size() >= config_.buffer_bytes) {
+        write_out();
+    }
+}
+
+void FileSink::flush() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    write_out();
+    file_.flush();
+}
+
+void FileSink::write_out() {
+    if (buffer_.empty() || !file_.is_open()) return;
+    file_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    buffer_.clear();
+}
+
+bool FileSink::rotation_due(std::chrono::system_clock::time_point now, std::size_t incoming) const {
+    const auto &rotation = config_.rotation;
+    if (rotation.max_bytes > 0 && file_bytes_ > 0 && file_bytes_ + incoming > rotation.max_bytes) return true;
+    return rotation.interval_s > 0 && now >= next_rotation_;
+}
+
+// 只做关闭、重命名与重新打开, 压缩与清理交给后台线程
+void FileSink::rotate(std::chrono::system_clock::time_point now) {
+    const auto &rotation = config_.rotation;
+    if (rotation.interval_s > 0) {
+        auto interval = std::chrono::seconds(rotation.interval_s);
+        next_rotation_ = std::chrono::system_clock::time_point(std::chrono::floor<std::chrono::seconds>(now.time_since_epoch()) / interval * interval + interval);
+    }
+    if (file_bytes_ == 0) return;
+
+    auto tm_snapshot = to_tm(std::chrono::system_clock::to_time_t(now), false);
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count() % 1000;
+    char buffer[32];
+    std::strftime(buffer, sizeof(buffer), "%Y%m%d-%H%M%S", &tm_snapshot);
+
+    // a/b.log -> a/b.<时间戳>.log
+    std::filesystem::path path(config_.path);
+    auto extension = path.extension().string();
+    auto prefix = (path.parent_path() / path.stem()).string() + ".";
+    auto archived = std::format("{}{}-{:03}{}", prefix, buffer, ms, extension);
+    std::error_code ec;
+    for (int i = 1; std::filesystem::exists(archived, ec) || std::filesystem::exists(archived + ".gz", ec); ++i) {
+        archived = std::format("{}{}-{:03}-{}{}", prefix, buffer, ms, i, extension);
+    }
+
+    write_out();
+    file_.close();
+    std::filesystem::rename(config_.path, archived, ec);
+    file_.open(config_.path, std::ios::out | std::ios::app);
+    if (!file_.is_open()) return;
+    // 重命名失败(如文件被其他进程占用)时继续写原文件, 再写满 max_bytes 或到下一时刻才重试, 不在每行上重试
+    file_bytes_ = 0;
+    if (ec) {
+        if (!rotate_failed_) {
+            std::cerr << "[ERROR] Failed to rotate log file: " << config_.path << ", " << ec.message() << std::endl;
+        }
+        rotate_failed_ = true;
+        return;
+    }
+    rotate_failed_ = false;
+    LogArchiver::instance().submit({archived, prefix, rotation.retention, rotation.compress});
+}
+
+SyslogSink::SyslogSink(const Config &config) :
+    config_(config),
+    socket_(INVALID_SOCKET_VALUE) {
+#ifdef _WIN32
+    WSADATA wsa_data;
+    WSAStartup(MAKEWORD(2, 2), &wsa_data);
+#endif
+}
+
+SyslogSink::~SyslogSink() {
+    if (socket_ != INVALID_SOCKET_VALUE) {
+        close_socket(socket_);
+    }
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+bool SyslogSink::open() {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo *result = nullptr;
+    auto port = std::to_string(config_.port);
+    if (getaddrinfo(config_.host.c_str(), port.c_str(), &hints, &result) != 0 || result == nullptr) return false;
+
+    // 连接后直接 send, 采集器未启动时的 ICMP 错误在 send 时被忽略
+    bool ok = false;
+    auto sock = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+#ifdef _WIN32
+    if (sock != INVALID_SOCKET) {
+        u_long non_blocking = 1;
+        ok = connect(sock, result->ai_addr, static_cast<int>(result->ai_addrlen)) == 0 && ioctlsocket(sock, FIONBIO, &non_blocking) == 0;
+        if (!ok) closesocket(sock);
+    }
+#else
+    if (sock >= 0) {
+        ok = connect(sock, result->ai_addr, result->ai_addrlen) == 0 && fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) | O_NONBLOCK) == 0;
+        if (!ok) ::close(sock);
+    }
+#endif
+    freeaddrinfo(result);
+    if (!ok) return false;
+    socket_ = static_cast<std::uintptr_t>(sock);
+
+    char hostname[256] = {};
+    if (gethostname(hostname, sizeof(hostname) - 1) == 0 && hostname[0] != '\0') {
+        hostname_ = hostname;
+    } else {
+        hostname_ = "-";
+    }
+    return true;
+}
+
+// <PRI>1 时间 主机 应用 进程号 日志器名称 - 内容
+void SyslogSink::write(const LogRecord &record) {
+    if (socket_ == INVALID_SOCKET_VALUE) return;
+
+    auto tm_snapshot = to_tm(std::chrono::system_clock::to_time_t(record.time), true);
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(record.time.time_since_epoch()).count() % 1000;
+    char timestamp[32];
+    std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%S", &tm_snapshot);
+
+    // MSGID 不允许空格且最长 32 字符
+    std::string msgid(record.logger.substr(0, 32));
+    std::replace(msgid.begin(), msgid.end(), ' ', '_');
+#ifdef _WIN32
+    auto pid = _getpid();
+#else
+    auto pid = getpid();
+#endif
+    auto datagram = std::format("<{}>1 {}.{:03}Z {} {} {} {} - {}",
+                                config_.facility * 8 + syslog_severity(record.level),
+                                timestamp,
+                                ms,
+                                hostname_,
+                                config_.app,
+                                pid,
+                                msgid,
+                                record.message);
+#ifdef _WIN32
+    send(static_cast<SOCKET>(socket_), datagram.data(), static_cast<int>(datagram.size()), 0);
+#else
+    send(static_cast<int>(socket_), datagram.data(), datagram.size(), MSG_DONTWAIT);
+#endif
+}
+
+LogSinkRegistry::LogSinkRegistry(uint32_t flush_interval_ms) :
+    flush_interval_ms_(std::max<uint32_t>(flush_interval_ms, 1)) {
+    flusher_ = std::thread([this]() {
+        std::unique_lock<std::mutex> lock(mtx_);
+        while (running_) {
+            cv_.wait_for(lock, std::chrono::milliseconds(flush_interval_ms_), [this]() {
+                return !running_;
+            });
+            lock.unlock();
+            flush();
+            lock.lock();
+        }
+    });
+}
+
+LogSinkRegistry::~LogSinkRegistry() {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        running_ = false;
+    }
+    cv_.notify_one();
+    if (flusher_.joinable())
+        flusher_.join();
+    flush();
+}
+
+void LogSinkRegistry::add(const std::string &name, std::shared_ptr<LogSink> sink) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    sinks_[name] = std::move(sink);
+}
+
+bool LogSinkRegistry::create(const std::string &name, const LogSinkConfig &config) {
+    switch (config.type) {
+    case LogSinkConfig::Type::CONSOLE:
+        add(name, ConsoleSink::instance());
+        return true;
+    case LogSinkConfig::Type::FILE: {
+        auto sink = std::make_shared<FileSink>(config.file);
+        if (!sink->open()) return false;
+        add(name, std::move(sink));
+        return true;
+    }
+    case LogSinkConfig::Type::SYSLOG: {
+        auto sink = std::make_shared<SyslogSink>(config.syslog);
+        if (!sink->open()) return false;
+        add(name, std::move(sink));
+        return true;
+    }
+    }
+    return false;
+}
+
+std::shared_ptr<LogSink> LogSinkRegistry::find(const std::string &name) const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto it = sinks_.find(name);
+    return it != sinks_.end() ? it->second : nullptr;
+}
+
+void LogSinkRegistry::flush() {
+    std::vector<std::shared_ptr<LogSink>> sinks;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        for (const auto &[name, sink] : sinks_) {
+            sinks.push_back(sink);
+        }
+    }
+    for (auto &sink : sinks) {
+        sink->flush();
+    }
+}
@@ -0,0 +1,168 @@
+// log_sink.h
+#pragma once
+
+#include "simple_log.h"
+
+#include <stdint.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace module {
+// 一条日志, 由 SimpleLogger 生成后交给其全部输出端
+struct LogRecord {
+    LogLevel level;
+    std::chrono::system_clock::time_point time;
+    std::string_view logger;
+    std::string_view message;
+    std::string_view line; // 格式化后的整行 "[时间][名称][级别] 内容\n"
+};
+
+/**
+ * ************************************************************************
+ * @brief 日志输出端; 可被多个日志器共用, 各自加锁并管理自己的缓冲
+ * ************************************************************************
+ */
+class LogSink {
+public:
+    virtual void write(const LogRecord &record) = 0;
+
+    // 写出缓冲区中的内容, 由 LogSinkRegistry 的后台线程周期调用
+    virtual void flush() {}
+
+    virtual ~LogSink() = default;
+};
+
+// 标准输出, 进程内共用一个实例, 多个日志器的行不会交错
+class ConsoleSink : public LogSink {
+    std::mutex mtx_;
+
+public:
+    static std::shared_ptr<ConsoleSink> instance();
+
+    void write(const LogRecord &record) override;
+    void flush() override;
+};
+
+/**
+ * ************************************************************************
+ * @brief 文件输出端: 按 buffer_bytes 攒批写出, WARN 及以上立即写出;
+ *        支持按大小/时间轮转, 历史文件为 <路径去扩展名>.<时间戳><扩展名>, 由 LogArchiver 在后台压缩与清理
+ * ************************************************************************
+ */
+class FileSink : public LogSink {
+public:
+    using Rotation = LogRotation;
+
+    struct Config {
+        std::string path;
+        std::size_t buffer_bytes = 0; // 攒批写出的字节数, 0 为每行写出
+        Rotation rotation;
+    };
+
+private:
+    Config config_;
+    std::mutex mtx_;
+    std::ofstream file_;
+    std::string buffer_;
+    uint64_t file_bytes_ = 0;                               // 当前文件大小, 含未写出的缓冲区
+    std::chrono::system_clock::time_point next_rotation_{}; // 按时间轮转的下一时刻
+    bool rotate_failed_ = false;                            // 上次重命名失败, 恢复前只报告一次
+
+public:
+    explicit FileSink(const Config &config);
+    ~FileSink();
+
+    bool open();
+
+    const std::string &path() const { return config_.path; }
+
+    void write(const LogRecord &record) override;
+    void flush() override;
+
+private:
+    void write_out();
+    bool rotation_due(std::chrono::system_clock::time_point now, std::size_t incoming) const;
+    void rotate(std::chrono::system_clock::time_point now);
+};
+
+/**
+ * ************************************************************************
+ * @brief syslog 输出端: 每条日志以 RFC 5424 格式作为一个 UDP 数据报发往本机采集器,
+ *        发送失败时丢弃, 不阻塞写日志的线程
+ * ************************************************************************
+ */
+class SyslogSink : public LogSink {
+public:
+    struct Config {
+        std::string host = "127.0.0.1";
+        uint16_t port = 514;
+        uint8_t facility = 16; // 默认 local0
+        std::string app = "gateway";
+    };
+
+private:
+    Config config_;
+    std::string hostname_;
+    std::uintptr_t socket_;
+
+public:
+    explicit SyslogSink(const Config &config);
+    ~SyslogSink();
+
+    bool open();
+
+    void write(const LogRecord &record) override;
+};
+
+// 输出端配置, 按 type 取 file 或 syslog 中的字段
+struct LogSinkConfig {
+    enum class Type {
+        CONSOLE,
+        FILE,
+        SYSLOG
+    };
+
+    Type type = Type::CONSOLE;
+    FileSink::Config file;
+    SyslogSink::Config syslog;
+};
+
+/**
+ * ************************************************************************
+ * @brief 按名称登记的输出端, 日志器按名称引用; 后台线程每 flush_interval_ms 写出各输出端的缓冲
+ * ************************************************************************
+ */
+class LogSinkRegistry {
+    mutable std::mutex mtx_;
+    std::condition_variable cv_;
+    std::map<std::string, std::shared_ptr<LogSink>> sinks_;
+    uint32_t flush_interval_ms_;
+    bool running_ = true;
+    std::thread flusher_;
+
+public:
+    explicit LogSinkRegistry(uint32_t flush_interval_ms);
+    ~LogSinkRegistry();
+
+    LogSinkRegistry(const LogSinkRegistry &) = delete;
+    LogSinkRegistry &operator=(const LogSinkRegistry &) = delete;
+
+    void add(const std::string &name, std::shared_ptr<LogSink> sink);
+
+    // 按配置创建并登记, 打开文件或套接字失败时返回 false
+    bool create(const std::string &name, const LogSinkConfig &config);
+
+    // 未登记时返回 nullptr
+    std::shared_ptr<LogSink> find(const std::string &name) const;
+
+    void flush();
+};
+} // namespace module
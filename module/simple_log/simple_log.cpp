@@ -1,5 +1,6 @@
 // simple_log.cpp
 #include "simple_log.h"
+#include "log_sink.h"
 
 // c++ string format
 #include <format>
@@ -10,97 +11,78 @@
 using namespace module;
 
 SimpleLogger::SimpleLogger(const std::string &name, LoggerMode mode) :
-    name_(name),
-    use_console_(false),
-    use_file_(false) {
-    switch (mode) {
-    case LoggerMode::CONSOLE_ONLY:
-        use_console_ = true;
-        break;
-    case LoggerMode::FILE_ONLY:
-        use_file_ = true;
-        break;
-    case LoggerMode::CONSOLE_AND_FILE:
-        use_console_ = true;
-        use_file_ = true;
-        break;
-    default:
-        break;
-    }
-    init();
+    SimpleLogger(name, mode, Rotation{}) {
 }
 
-SimpleLogger::~SimpleLogger() {
-    if (log_file_ && log_file_->is_open()) {
-        log_file_->close();
+SimpleLogger::SimpleLogger(const std::string &name, LoggerMode mode, const Rotation &rotation) :
+    name_(name) {
+    bool use_console = mode == LoggerMode::CONSOLE_ONLY || mode == LoggerMode::CONSOLE_AND_FILE;
+    bool use_file = mode == LoggerMode::FILE_ONLY || mode == LoggerMode::CONSOLE_AND_FILE;
+    if (use_console) {
+        sinks_.push_back(ConsoleSink::instance());
+    }
+    if (use_file) {
+        auto path = name_ + "_" + std::string(logger_file_path_);
+        auto file = std::make_shared<FileSink>(FileSink::Config{.path = path, .rotation = rotation});
+        if (file->open()) {
+            sinks_.push_back(std::move(file));
+        } else if (use_console) {
+            std::cerr << "[ERROR] Failed to open log file: " << path << std::endl;
+        }
     }
 }
 
-void SimpleLogger::info(std::string_view log) {
-    std::unique_lock lck(logger_mtx_);
+SimpleLogger::SimpleLogger(const std::string &name, std::vector<std::shared_ptr<LogSink>> sinks) :
+    name_(name),
+    sinks_(std::move(sinks)) {
+}
 
-    std::string formatting_log = std::format("[{}][{}][{}] {}\n",
-                                             get_now_timestamp_string(),
-                                             name_,
-                                             "INFO",
-                                             log);
+SimpleLogger::~SimpleLogger() = default;
 
-    if (use_console_) {
-        std::cout << formatting_log;
-    }
-    if (use_file_) {
-        (*log_file_) << formatting_log;
-    }
+void SimpleLogger::trace(std::string_view log) {
+    write(LogLevel::TRACE, log);
 }
 
-void SimpleLogger::error(std::string_view log) {
-    std::unique_lock lck(logger_mtx_);
+void SimpleLogger::debug(std::string_view log) {
+    write(LogLevel::DEBUG, log);
+}
 
-    std::string formatting_log = std::format("[{}][{}][{}] {}\n",
-                                             get_now_timestamp_string(),
-                                             name_,
-                                             "ERROR",
-                                             log);
+void SimpleLogger::info(std::string_view log) {
+    write(LogLevel::INFO, log);
+}
 
-    if (use_console_) {
-        std::cout << formatting_log;
-    }
-    if (use_file_) {
-        (*log_file_) << formatting_log;
-    }
+void SimpleLogger::error(std::string_view log) {
+    write(LogLevel::ERR, log);
 }
 
 void SimpleLogger::warn(std::string_view log) {
-    std::unique_lock lck(logger_mtx_);
+    write(LogLevel::WARN, log);
+}
+
+// 只格式化一次, 各输出端自行加锁
+void SimpleLogger::write(LogLevel level, std::string_view log) {
+    if (!enabled(level)) return;
 
+    auto now = std::chrono::system_clock::now();
     std::string formatting_log = std::format("[{}][{}][{}] {}\n",
-                                             get_now_timestamp_string(),
+                                             get_now_timestamp_string(now),
                                              name_,
-                                             "WARN",
+                                             level_name(level),
                                              log);
 
-    if (use_console_) {
-        std::cout << formatting_log;
-    }
-    if (use_file_) {
-        (*log_file_) << formatting_log;
+    LogRecord record{
+        .level = level,
+        .time = now,
+        .logger = name_,
+        .message = log,
+        .line = formatting_log,
+    };
+    for (auto &sink : sinks_) {
+        sink->write(record);
     }
 }
 
-void SimpleLogger::init() {
-    if (use_file_) {
-        log_file_ = std::make_unique<std::fstream>(name_ + "_" + std::string(logger_file_path_), std::ios::out | std::ios::app);
-        if (!log_file_->is_open()) {
-            if (use_console_) {
-                std::cerr << "[ERROR] Failed to open log file: " << logger_file_path_ << std::endl;
-            }
-            use_file_ = false; // 禁用文件输出
-        }
-    }
-}
-
-std::string SimpleLogger::get_now_timestamp_string() {
-    auto now = std::chrono::system_clock::now();
+std::string SimpleLogger::get_now_timestamp_string(std::chrono::system_clock::time_point now) {
     auto time_t = std::chrono::system_clock::to_time_t(now);
     auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()) % 1000;
 
@@ -1,12 +1,77 @@
 // simple_log.h
 #pragma once
 
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <string>
 #include <string_view>
 #include <memory>
 #include <mutex>
 #include <fstream>
+#include <utility>
+#include <vector>
+
+// 编译期最低日志级别, 取 LogLevel 的数值; 低于该级别的 SIMPLE_LOG_* 调用不生成代码
+#ifndef SIMPLE_LOG_MIN_LEVEL
+#define SIMPLE_LOG_MIN_LEVEL 0
+#endif
 
 namespace module {
+// 日志级别; Windows.h 定义了 ERROR 宏, 故错误级别取名 ERR
+enum class LogLevel : uint8_t {
+    TRACE,
+    DEBUG,
+    INFO,
+    WARN,
+    ERR
+};
+
+inline const char *level_name(LogLevel level) {
+    switch (level) {
+    case LogLevel::TRACE: return "TRACE";
+    case LogLevel::DEBUG: return "DEBUG";
+    case LogLevel::INFO: return "INFO";
+    case LogLevel::WARN: return "WARN";
+    case LogLevel::ERR: return "ERROR";
+    }
+    return "UNKNOWN";
+}
+
+// 由小写名称 trace/debug/info/warn/error 解析级别
+inline bool parse_level(std::string_view name, LogLevel &level) {
+    static constexpr std::pair<std::string_view, LogLevel> names[] = {
+        {"trace", LogLevel::TRACE},
+        {"debug", LogLevel::DEBUG},
+        {"info", LogLevel::INFO},
+        {"warn", LogLevel::WARN},
+        {"error", LogLevel::ERR},
+    };
+    for (const auto &[text, candidate] : names) {
+        if (name == text) {
+            level = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+// 供 module::from_json 把配置中的级别字符串反序列化为 LogLevel
+inline bool parse_enum(std::string_view name, LogLevel &level) {
+    return parse_level(name, level);
+}
+
+// 日志文件轮转, 见 FileSink
+struct LogRotation {
+    uint64_t max_bytes = 0;  // 文件达到该大小时轮转, 0 为不按大小
+    uint32_t interval_s = 0; // 每隔该秒数轮转(按 UTC 对齐), 0 为不按时间
+    uint32_t retention = 7;  // 保留的历史文件数, 0 为不删除
+    bool compress = true;    // 历史文件压缩为 .gz, 未启用 zlib 时保留原文件
+};
+
+class BinaryLogger;
+class LogSink;
+
 class SimpleLoggerInterface {
 public:
     enum class LoggerMode {
@@ -15,29 +80,57 @@ public:
         CONSOLE_AND_FILE  // 控制台与文件
     };
 
+protected:
+    std::atomic<LogLevel> level_{LogLevel::INFO};
+
 public:
+    virtual void trace(std::string_view) = 0;
+    virtual void debug(std::string_view) = 0;
     virtual void info(std::string_view) = 0;
     virtual void error(std::string_view) = 0;
     virtual void warn(std::string_view) = 0;
+
+    // 运行时级别, 可在任意线程修改; 低于该级别的日志在格式化前丢弃
+    LogLevel level() const { return level_.load(std::memory_order_relaxed); }
+    void set_level(LogLevel level) { level_.store(level, std::memory_order_relaxed); }
+    bool enabled(LogLevel level) const {
+#if SIMPLE_LOG_MIN_LEVEL > 0
+        // 默认 0 时比较恒为真, 会触发 -Wtype-limits
+        if (static_cast<int>(level) < SIMPLE_LOG_MIN_LEVEL) return false;
+#endif
+        return level >= level_.load(std::memory_order_relaxed);
+    }
+
+    // 二进制日志器返回自身, 供 SIMPLE_LOG_* 宏跳过格式化, 见 binary_log.h
+    virtual BinaryLogger *binary() { return nullptr; }
     virtual ~SimpleLoggerInterface() = default;
 };
 
+// 文本日志器: 格式化一次后写入全部输出端, 输出端可与其他日志器共用, 见 log_sink.h
 class SimpleLogger : public SimpleLoggerInterface {
+public:
+    using Rotation = LogRotation;
+
 private:
     static constexpr std::string_view logger_file_path_ = "simple_logger.log";
 
-    std::unique_ptr<std::fstream> log_file_;
-
     std::string name_;
-    bool use_console_;
-    bool use_file_;
-    std::mutex logger_mtx_;
+    std::vector<std::shared_ptr<LogSink>> sinks_;
 
 public:
+    // 独占文件 <name>_simple_logger.log, 控制台与其他日志器共用
     SimpleLogger(const std::string &name, LoggerMode mode);
 
+    SimpleLogger(const std::string &name, LoggerMode mode, const Rotation &rotation);
+
+    SimpleLogger(const std::string &name, std::vector<std::shared_ptr<LogSink>> sinks);
+
     ~SimpleLogger();
 
+    void trace(std::string_view log) override;
+
+    void debug(std::string_view log) override;
+
     void info(std::string_view log) override;
 
     void error(std::string_view log) override;
@@ -45,8 +138,8 @@ public:
     void warn(std::string_view log) override;
 
 private:
-    void init();
+    void write(LogLevel level, std::string_view log);
 
-    std::string get_now_timestamp_string();
+    std::string get_now_timestamp_string(std::chrono::system_clock::time_point now);
 };
 } // namespace module
@@ -0,0 +1,796 @@
+// gossip.cpp
+#include "gossip.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <format>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+
+#ifdef _WIN32
+// Windows API
+#define _WINSOCK_DEPRECATED_NO_WARNINGS
+#define NOMINMAX // windows min() max() 冲突
+#include <ws2tcpip.h>
+
+#include <winsock2.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using namespace xiunneg;
+
+namespace {
+constexpr const char *kMagic = "GOSSIP1";
+constexpr std::size_t kMaxDatagram = 1400; // 不超过常见 MTU, 避免 IP 分片
+constexpr std::string_view kMacPrefix = "MAC ";
+constexpr std::size_t kMacLine = kMacPrefix.size() + 64 + 1; // 末行 "MAC <HMAC-SHA256 十六进制>\n"
+
+#ifdef _WIN32
+using Socket = SOCKET;
+using PollFd = WSAPOLLFD;
+constexpr Socket kInvalidSocket = INVALID_SOCKET;
+
+void close_socket(Socket sock) {
+    closesocket(sock);
+}
+
+bool set_non_blocking(Socket sock) {
+    u_long non_blocking = 1;
+    return ioctlsocket(sock, FIONBIO, &non_blocking) == 0;
+}
+
+int poll_socket(PollFd &fd, int timeout_ms) {
+    return WSAPoll(&fd, 1, timeout_ms);
+}
+
+int last_socket_error() {
+    return WSAGetLastError();
+}
+#else
+using Socket = int;
+using PollFd = pollfd;
+constexpr Socket kInvalidSocket = -1;
+
+void close_socket(Socket sock) {
+    ::close(sock);
+}
+
+bool set_non_blocking(Socket sock) {
+    int flags = fcntl(sock, F_GETFL);
+    return flags >= 0 && fcntl(sock, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+int poll_socket(PollFd &fd, int timeout_ms) {
+    return ::poll(&fd, 1, timeout_ms);
+}
+
+int last_socket_error() {
+    return errno;
+}
+#endif
+
+uint64_t unix_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+int to_sockaddr(const std::string &host, uint16_t port, sockaddr_storage &addr) {
+    addr = {};
+    auto *v4 = reinterpret_cast<sockaddr_in *>(&addr);
+    if (inet_pton(AF_INET, host.c_str(), &v4->sin_addr) == 1) {
+        v4->sin_family = AF_INET;
+        v4->sin_port = htons(port);
+        return sizeof(sockaddr_in);
+    }
+    auto *v6 = reinterpret_cast<sockaddr_in6 *>(&addr);
+    if (inet_pton(AF_INET6, host.c_str(), &v6->sin6_addr) == 1) {
+        v6->sin6_family = AF_INET6;
+        v6->sin6_port = htons(port);
+        return sizeof(sockaddr_in6);
+    }
+    return 0;
+}
+
+template <typename T>
+bool parse_number(const std::string &text, T &value) {
+    auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return ec == std::errc{} && end == text.data() + text.size();
+}
+
+// host:port, IPv6 地址本身含冒号, 以最后一个冒号分隔
+bool split_id(const std::string &id, std::string &host, uint16_t &port) {
+    auto pos = id.rfind(':');
+    if (pos == std::string::npos) return false;
+    host = id.substr(0, pos);
+    return PortScanner::is_ip_literal(host) && parse_number(id.substr(pos + 1), port) && port != 0;
+}
+
+// SHA-256(FIPS 180-4), 只用于报文 MAC, 不引入额外的加密库依赖
+class Sha256 {
+private:
+    static constexpr std::array<uint32_t, 64> kRound = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+    std::array<uint32_t, 8> state_ = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    std::array<uint8_t, 64> block_{};
+    std::size_t block_size_ = 0;
+    uint64_t total_ = 0;
+
+    void compress() {
+        std::array<uint32_t, 64> w{};
+        for (std::size_t i = 0; i < 16; ++i) {
+            w[i] = uint32_t{block_[i * 4]} << 24 | uint32_t{block_[i * 4 + 1]} << 16 | uint32_t{block_[i * 4 + 2]} << 8 | block_[i * 4 + 3];
+        }
+        for (std::size_t i = 16; i < 64; ++i) {
+            auto s0 = std::rotr(w[i - 15], 7) ^ std::rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            auto s1 = std::rotr(w[i - 2], 17) ^ std::rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        auto [a, b, c, d, e, f, g, h] = state_;
+        for (std::size_t i = 0; i < 64; ++i) {
+            auto t1 = h + (std::rotr(e, 6) ^ std::rotr(e, 11) ^ std::rotr(e, 25)) + ((e & f) ^ (~e & g)) + kRound[i] + w[i];
+            auto t2 = (std::rotr(a, 2) ^ std::rotr(a, 13) ^ std::rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        std::array<uint32_t, 8> add = {a, b, c, d, e, f, g, h};
+        for (std::size_t i = 0; i < 8; ++i) state_[i] += add[i];
+    }
+
+public:
+    void update(std::string_view data) {
+        total_ += data.size();
+        for (char ch : data) {
+            block_[block_size_++] = static_cast<uint8_t>(ch);
+            if (block_size_ == block_.size()) {
+                compress();
+                block_size_ = 0;
+            }
+        }
+    }
+
+    std::string digest() {
+        auto bits = total_ * 8;
+        update(std::string_view("\x80", 1));
+        while (block_size_ != 56) update(std::string_view("\0", 1));
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            block_[block_size_++] = static_cast<uint8_t>(bits >> shift);
+        }
+        compress();
+        std::string out;
+        for (auto word : state_) {
+            for (int shift = 24; shift >= 0; shift -= 8) out.push_back(static_cast<char>(word >> shift));
+        }
+        return out;
+    }
+};
+
+// HMAC-SHA256(RFC 2104), 以十六进制返回
+std::string hmac_sha256(std::string_view key, std::string_view message) {
+    std::string block_key(key);
+    if (block_key.size() > 64) {
+        Sha256 hash;
+        hash.update(block_key);
+        block_key = hash.digest();
+    }
+    block_key.resize(64, '\0');
+    std::string inner_pad(block_key), outer_pad(block_key);
+    for (std::size_t i = 0; i < 64; ++i) {
+        inner_pad[i] = static_cast<char>(inner_pad[i] ^ 0x36);
+        outer_pad[i] = static_cast<char>(outer_pad[i] ^ 0x5c);
+    }
+    Sha256 inner;
+    inner.update(inner_pad);
+    inner.update(message);
+    Sha256 outer;
+    outer.update(outer_pad);
+    outer.update(inner.digest());
+
+    std::string hex;
+    for (unsigned char byte : outer.digest()) hex += std::format("{:02x}", byte);
+    return hex;
+}
+
+// 逐字节比较全部内容, 耗时与首个不同字节的位置无关
+bool equal_constant_time(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    unsigned char diff = 0;
+    for (std::size_t i = 0; i < a.size(); ++i) diff |= static_cast<unsigned char>(a[i] ^ b[i]);
+    return diff == 0;
+}
+
+char state_code(GossipNode::State state) {
+    switch (state) {
+    case GossipNode::State::ALIVE: return 'A';
+    case GossipNode::State::SUSPECT: return 'S';
+    default: return 'D';
+    }
+}
+
+std::optional<GossipNode::State> parse_state(const std::string &code) {
+    if (code == "A") return GossipNode::State::ALIVE;
+    if (code == "S") return GossipNode::State::SUSPECT;
+    if (code == "D") return GossipNode::State::DEAD;
+    return std::nullopt;
+}
+} // namespace
+
+void GossipNode::Config::validate() {
+    if (bind_host.empty()) bind_host = advertise_host;
+    if (!PortScanner::is_ip_literal(bind_host) || !PortScanner::is_ip_literal(advertise_host)) {
+        throw std::runtime_error(std::format("gossip 参数错误 地址[{}]/[{}] 不是 IP 字面量", bind_host, advertise_host));
+    }
+    if (port == 0) {
+        throw std::runtime_error("gossip 参数错误 端口不能为 0");
+    }
+    for (const auto &seed : seeds) {
+        std::string host;
+        uint16_t seed_port{};
+        if (!split_id(seed, host, seed_port)) {
+            throw std::runtime_error(std::format("gossip 参数错误 种子节点[{}] 应为 IP:端口", seed));
+        }
+    }
+    period_ms = std::max<uint32_t>(period_ms, 10);
+    ping_timeout_ms = std::clamp<uint32_t>(ping_timeout_ms, 1, period_ms);
+    suspect_timeout_ms = std::max(suspect_timeout_ms, period_ms);
+    sync_periods = std::max<uint32_t>(sync_periods, 1);
+}
+
+GossipNode::GossipNode(const Config &config, Logger logger) :
+    config_(config),
+    logger_(logger),
+    incarnation_(unix_ms()),
+    version_(unix_ms()),
+    rng_(std::random_device{}()),
+    socket_(static_cast<std::uintptr_t>(kInvalidSocket)) {
+    if (logger_ == nullptr) {
+        logger_ = std::make_shared<module::SimpleLogger>(
+            "gossip logger",
+            module::SimpleLoggerInterface::LoggerMode::CONSOLE_AND_FILE);
+    }
+    config_.validate();
+    self_id_ = std::format("{}:{}", config_.advertise_host, config_.port);
+}
+
+GossipNode::~GossipNode() {
+    stop();
+}
+
+void GossipNode::set_view_listener(ViewListener listener) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    view_listener_ = std::move(listener);
+}
+
+void GossipNode::set_verdict_listener(VerdictListener listener) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    verdict_listener_ = std::move(listener);
+}
+
+const char *GossipNode::state_name(State state) {
+    switch (state) {
+    case State::ALIVE: return "alive";
+    case State::SUSPECT: return "suspect";
+    default: return "dead";
+    }
+}
+
+bool GossipNode::start() {
+    sockaddr_storage addr{};
+    int addr_len = to_sockaddr(config_.bind_host, config_.port, addr);
+    Socket sock = socket(addr.ss_family, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock == kInvalidSocket) {
+        logger_->error("创建 gossip 套接字失败");
+        return false;
+    }
+    if (bind(sock, reinterpret_cast<sockaddr *>(&addr), addr_len) != 0 || !set_non_blocking(sock)) {
+        logger_->error(std::format("gossip 绑定 {}:{} 失败 {}", config_.bind_host, config_.port, last_socket_error()));
+        close_socket(sock);
+        return false;
+    }
+#ifdef SIO_UDP_CONNRESET
+    // 对端未监听时 Windows 会让后续 recvfrom 返回 WSAECONNRESET, 关闭该行为
+    BOOL report_reset = FALSE;
+    DWORD bytes = 0;
+    WSAIoctl(sock, SIO_UDP_CONNRESET, &report_reset, sizeof(report_reset), nullptr, 0, &bytes, nullptr, nullptr);
+#endif
+    socket_ = static_cast<std::uintptr_t>(sock);
+    bound_ = true;
+    logger_->info(std::format("gossip 节点 {} 已启动, 种子节点 {}", self_id_, config_.seeds.size()));
+
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        enqueue(member_line(config_.advertise_host, config_.port, State::ALIVE, incarnation_));
+        for (const auto &seed : config_.seeds) {
+            std::string host;
+            uint16_t port{};
+            split_id(seed, host, port);
+            send(host, port, "PING", 0);
+        }
+    }
+
+    running_ = true;
+    worker_ = std::thread([this]() {
+        loop();
+    });
+    return true;
+}
+
+void GossipNode::stop() {
+    running_ = false;
+    if (worker_.joinable())
+        worker_.join();
+    if (bound_) {
+        close_socket(static_cast<Socket>(socket_));
+        bound_ = false;
+    }
+}
+
+void GossipNode::publish_local(const std::map<uint16_t, RemoteEndpoint> &services) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto &own = entries_[self_id_];
+    for (const auto &[key, endpoint] : services) {
+        auto it = own.find(key);
+        if (it != own.end() && it->second.alive && it->second.endpoint == endpoint) continue;
+        auto &entry = own[key];
+        entry = Entry{++version_, true, endpoint};
+        enqueue(entry_line(self_id_, key, entry));
+    }
+    for (auto &[key, entry] : own) {
+        if (!entry.alive || services.contains(key)) continue;
+        entry.alive = false;
+        entry.version = ++version_;
+        enqueue(entry_line(self_id_, key, entry));
+    }
+}
+
+std::vector<GossipNode::MemberInfo> GossipNode::members() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    std::vector<MemberInfo> items;
+    items.push_back(MemberInfo{self_id_, State::ALIVE, incarnation_});
+    for (const auto &[id, member] : members_) {
+        items.push_back(MemberInfo{id, member.state, member.incarnation});
+    }
+    return items;
+}
+
+void GossipNode::loop() {
+    std::vector<char> buffer(65536);
+    // 轮询粒度取探测超时的 1/4, 超时判断的误差不超过该值
+    const auto wait_ms = static_cast<int>(std::max<uint32_t>(1, config_.ping_timeout_ms / 4));
+    while (running_) {
+        PollFd fd{.fd = static_cast<Socket>(socket_), .events = POLLIN, .revents = 0};
+        if (poll_socket(fd, wait_ms) > 0) {
+            while (true) {
+                int received = static_cast<int>(recvfrom(static_cast<Socket>(socket_), buffer.data(), static_cast<int>(buffer.size()), 0, nullptr, nullptr));
+                if (received <= 0) break;
+                std::string datagram(buffer.data(), received);
+                if (!verify(datagram)) continue;
+                std::lock_guard<std::mutex> lock(mtx_);
+                handle(datagram, Clock::now());
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            tick(Clock::now());
+        }
+        fire_events();
+    }
+}
+
+void GossipNode::tick(Clock::time_point now) {
+    const auto period = std::chrono::milliseconds(config_.period_ms);
+
+    if (probe_) {
+        // 直接探测超时, 请其他成员代为探测, 排除本节点与目标之间的链路问题
+        if (!probe_->acked && !probe_->indirect_sent && now - probe_->sent >= std::chrono::milliseconds(config_.ping_timeout_ms)) {
+            probe_->indirect_sent = true;
+            auto it = members_.find(probe_->target);
+            if (it != members_.end()) {
+                for (const auto &relay : random_members(config_.indirect_probes, probe_->target)) {
+                    const auto &member = members_.at(relay);
+                    send(member.host, member.port, "PINGREQ", probe_->seq, std::format(" {} {}", it->second.host, it->second.port));
+                }
+            }
+        }
+    }
+    if (now < next_period_) return;
+    next_period_ = now + period;
+
+    if (probe_) {
+        if (!probe_->acked) {
+            auto it = members_.find(probe_->target);
+            if (it != members_.end() && it->second.state == State::ALIVE) {
+                it->second.state = State::SUSPECT;
+                it->second.state_since = now;
+                enqueue(member_line(it->second.host, it->second.port, State::SUSPECT, it->second.incarnation));
+                logger_->warn(std::format("gossip 成员 {} 无应答, 标记为怀疑", probe_->target));
+            }
+        }
+        probe_.reset();
+    }
+
+    ++periods_;
+
+    // 怀疑超时判定失效
+    for (auto &[id, member] : members_) {
+        if (member.state == State::SUSPECT && now - member.state_since >= std::chrono::milliseconds(config_.suspect_timeout_ms)) {
+            mark_dead(id, member, now);
+        }
+    }
+
+    for (auto it = relays_.begin(); it != relays_.end();) {
+        it = now - it->second.sent >= period ? relays_.erase(it) : std::next(it);
+    }
+
+    // 轮转探测: 每轮打乱顺序, 依次探测未失效的成员
+    for (std::size_t tries = 0; tries <= probe_order_.size(); ++tries) {
+        if (probe_index_ >= probe_order_.size()) {
+            probe_order_.clear();
+            for (const auto &[id, member] : members_) {
+                if (member.state != State::DEAD) probe_order_.push_back(id);
+            }
+            std::shuffle(probe_order_.begin(), probe_order_.end(), rng_);
+            probe_index_ = 0;
+            if (probe_order_.empty()) break;
+        }
+        const auto &target = probe_order_[probe_index_++];
+        auto it = members_.find(target);
+        if (it == members_.end() || it->second.state == State::DEAD) continue;
+        probe_ = Probe{target, next_seq_++, now};
+        send(it->second.host, it->second.port, "PING", probe_->seq);
+        break;
+    }
+
+    if (periods_ % config_.sync_periods == 0) {
+        // 尚未联系上的种子节点继续尝试, 集群分裂后也能重新合并
+        for (const auto &seed : config_.seeds) {
+            auto it = members_.find(seed);
+            if (seed == self_id_ || (it != members_.end() && it->second.state != State::DEAD)) continue;
+            std::string host;
+            uint16_t port{};
+            split_id(seed, host, port);
+            send(host, port, "PING", 0);
+        }
+        // 反熵: 捎带的更新可能丢失, 周期性推送全量状态
+        for (const auto &id : random_members(1, {})) {
+            pending_syncs_.emplace_back(id, false);
+        }
+    }
+
+    for (const auto &[id, request_reply] : pending_syncs_) {
+        auto it = members_.find(id);
+        if (it != members_.end()) send_sync(it->second.host, it->second.port, request_reply);
+    }
+    pending_syncs_.clear();
+}
+
+// 报文: 首行 GOSSIP1 <PING|ACK|PINGREQ|SYNC> <seq> <发送方 host> <port> <incarnation> [目标 host port],
+// PINGREQ 与转发的 ACK 带目标; SYNC 的 seq 为 1 时请对方回推全量状态,
+// 其后每行一条捎带的更新: M <host> <port> <A|S|D> <incarnation> | E <来源 id> <key> <version> <0|1> <host> <port>
+void GossipNode::handle(const std::string &datagram, Clock::time_point now) {
+    std::istringstream in(datagram);
+    std::string line;
+    if (!std::getline(in, line)) return;
+
+    std::istringstream header(line);
+    std::string magic, type, seq_text, host, port_text, inc_text;
+    header >> magic >> type >> seq_text >> host >> port_text >> inc_text;
+    uint64_t seq{}, incarnation{};
+    uint16_t port{};
+    if (magic != kMagic || !parse_number(seq_text, seq) || !parse_number(port_text, port) || !parse_number(inc_text, incarnation)
+        || !PortScanner::is_ip_literal(host)) {
+        return;
+    }
+    auto sender = std::format("{}:{}", host, port);
+    if (sender == self_id_) return;
+
+    // 收到报文即是发送方存活的直接证据
+    apply_member(host, port, State::ALIVE, incarnation, now);
+    if (auto it = members_.find(sender); it != members_.end() && it->second.state == State::DEAD) {
+        // 发送方以旧的 incarnation 被判定失效, 推送全量状态使其得知并反驳
+        pending_syncs_.emplace_back(sender, false);
+    }
+
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string kind;
+        fields >> kind;
+        if (kind == "M") {
+            std::string member_host, member_port, state, member_inc;
+            fields >> member_host >> member_port >> state >> member_inc;
+            uint16_t parsed_port{};
+            uint64_t parsed_inc{};
+            auto parsed_state = parse_state(state);
+            if (parsed_state && PortScanner::is_ip_literal(member_host) && parse_number(member_port, parsed_port) && parse_number(member_inc, parsed_inc)) {
+                apply_member(member_host, parsed_port, *parsed_state, parsed_inc, now);
+            }
+        } else if (kind == "E") {
+            std::string origin, key_text, version_text, alive_text, ep_host, ep_port;
+            fields >> origin >> key_text >> version_text >> alive_text >> ep_host >> ep_port;
+            uint16_t key{}, parsed_port{};
+            uint64_t version{};
+            if (parse_number(key_text, key) && parse_number(version_text, version) && (alive_text == "0" || alive_text == "1")
+                && PortScanner::is_ip_literal(ep_host) && parse_number(ep_port, parsed_port)) {
+                apply_entry(origin, key, Entry{version, alive_text == "1", RemoteEndpoint{ep_host, parsed_port}});
+            }
+        }
+    }
+
+    std::string target_host, target_port;
+    header >> target_host >> target_port;
+    uint16_t parsed_target_port{};
+    bool has_target = PortScanner::is_ip_literal(target_host) && parse_number(target_port, parsed_target_port);
+
+    if (type == "PING") {
+        send(host, port, "ACK", seq);
+    } else if (type == "ACK") {
+        // 转发的 ACK 以目标为准
+        auto target = has_target ? std::format("{}:{}", target_host, parsed_target_port) : sender;
+        if (probe_ && probe_->seq == seq && probe_->target == target) {
+            probe_->acked = true;
+        } else if (auto it = relays_.find(seq); it != relays_.end() && !has_target) {
+            // 间接探测的应答转给请求方
+            auto requester = members_.find(it->second.requester);
+            if (requester != members_.end()) {
+                send(requester->second.host, requester->second.port, "ACK", it->second.seq,
+                     std::format(" {} {}", it->second.target_host, it->second.target_port));
+            }
+            relays_.erase(it);
+        }
+    } else if (type == "PINGREQ" && has_target) {
+        auto relay_seq = next_seq_++;
+        relays_[relay_seq] = Relay{sender, seq, target_host, parsed_target_port, now};
+        send(target_host, parsed_target_port, "PING", relay_seq);
+    } else if (type == "SYNC" && seq == 1) {
+        pending_syncs_.emplace_back(sender, false);
+    }
+}
+
+void GossipNode::apply_member(const std::string &host, uint16_t port, State state, uint64_t incarnation, Clock::time_point now) {
+    auto id = std::format("{}:{}", host, port);
+    if (id == self_id_) {
+        // 被怀疑或判定失效: 递增 incarnation 反驳
+        if (state != State::ALIVE && incarnation >= incarnation_) {
+            incarnation_ = incarnation + 1;
+            enqueue(member_line(config_.advertise_host, config_.port, State::ALIVE, incarnation_));
+            logger_->warn(std::format("gossip 本节点被标记为 {}, 以 incarnation {} 反驳", state_name(state), incarnation_));
+        }
+        return;
+    }
+
+    auto it = members_.find(id);
+    if (it == members_.end()) {
+        if (state == State::DEAD) return;
+        members_.emplace(id, Member{host, port, state, incarnation, now});
+        enqueue(member_line(host, port, state, incarnation));
+        pending_syncs_.emplace_back(id, true);
+        view_dirty_ = true;
+        logger_->info(std::format("gossip 发现成员 {}", id));
+        return;
+    }
+
+    auto &member = it->second;
+    bool accept = false;
+    switch (state) {
+    case State::ALIVE:
+        accept = incarnation > member.incarnation;
+        break;
+    case State::SUSPECT:
+        accept = incarnation > member.incarnation || (incarnation == member.incarnation && member.state == State::ALIVE);
+        break;
+    case State::DEAD:
+        accept = incarnation >= member.incarnation && member.state != State::DEAD;
+        break;
+    }
+    if (!accept) return;
+
+    if (state == State::DEAD) {
+        member.incarnation = incarnation;
+        mark_dead(id, member, now);
+        return;
+    }
+    if (member.state == State::DEAD) {
+        logger_->info(std::format("gossip 成员 {} 重新加入", id));
+        pending_syncs_.emplace_back(id, true);
+        view_dirty_ = true;
+    }
+    member.state = state;
+    member.incarnation = incarnation;
+    member.state_since = now;
+    enqueue(member_line(host, port, state, incarnation));
+}
+
+void GossipNode::mark_dead(const std::string &id, Member &member, Clock::time_point now) {
+    member.state = State::DEAD;
+    member.state_since = now;
+    enqueue(member_line(member.host, member.port, State::DEAD, member.incarnation));
+    logger_->warn(std::format("gossip 成员 {} 判定失效, 移除其服务", id));
+    // 失效网关的条目不再可信, 重新加入后由其全量推送恢复
+    entries_.erase(id);
+    view_dirty_ = true;
+}
+
+void GossipNode::apply_entry(const std::string &origin, uint16_t key, Entry entry) {
+    // 本节点的条目只由本节点更新
+    if (origin == self_id_) return;
+    if (auto it = members_.find(origin); it != members_.end() && it->second.state == State::DEAD) return;
+
+    auto &entries = entries_[origin];
+    auto it = entries.find(key);
+    bool was_alive = false;
+    if (it != entries.end()) {
+        if (entry.version <= it->second.version) return;
+        was_alive = it->second.alive;
+        if (was_alive && entry.alive && it->second.endpoint != entry.endpoint) {
+            verdicts_.push_back(Verdict{key, it->second.endpoint, false});
+        }
+    }
+    if (was_alive != entry.alive || (entry.alive && it != entries.end() && it->second.endpoint != entry.endpoint)) {
+        verdicts_.push_back(Verdict{key, entry.endpoint, entry.alive});
+    }
+    enqueue(entry_line(origin, key, entry));
+    entries[key] = std::move(entry);
+    view_dirty_ = true;
+}
+
+void GossipNode::fire_events() {
+    ViewListener view_listener;
+    VerdictListener verdict_listener;
+    std::optional<std::map<uint16_t, RemoteEndpoint>> view;
+    std::vector<Verdict> verdicts;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (view_dirty_) {
+            view_dirty_ = false;
+            std::map<uint16_t, RemoteEndpoint> current;
+            for (const auto &[origin, entries] : entries_) {
+                if (origin == self_id_) continue;
+                auto it = members_.find(origin);
+                if (it == members_.end() || it->second.state == State::DEAD) continue;
+                for (const auto &[key, entry] : entries) {
+                    if (entry.alive) current.try_emplace(key, entry.endpoint);
+                }
+            }
+            if (current != view_) {
+                view_ = current;
+                view = std::move(current);
+            }
+        }
+        verdicts.swap(verdicts_);
+        view_listener = view_listener_;
+        verdict_listener = verdict_listener_;
+    }
+
+    // 监听者会更新端口扫描器, 不持有本节点的锁
+    if (view && view_listener) {
+        view_listener(*view);
+    }
+    if (verdict_listener) {
+        for (const auto &verdict : verdicts) {
+            verdict_listener(verdict.key, verdict.endpoint, verdict.alive);
+        }
+    }
+}
+
+void GossipNode::enqueue(std::string line) {
+    // 同一对象的旧更新已被取代
+    auto prefix = line.substr(0, line.find(' ', line.find(' ', line.find(' ') + 1) + 1));
+    std::erase_if(updates_, [&prefix](const Update &update) {
+        return update.line.starts_with(prefix + " ");
+    });
+    updates_.push_front(Update{std::move(line), retransmits()});
+}
+
+std::string GossipNode::member_line(const std::string &host, uint16_t port, State state, uint64_t incarnation) const {
+    return std::format("M {} {} {} {}", host, port, state_code(state), incarnation);
+}
+
+std::string GossipNode::entry_line(const std::string &origin, uint16_t key, const Entry &entry) const {
+    return std::format("E {} {} {} {} {} {}", origin, key, entry.version, entry.alive ? 1 : 0, entry.endpoint.host, entry.endpoint.port);
+}
+
+void GossipNode::send(const std::string &host, uint16_t port, const std::string &type, uint64_t seq, const std::string &extra) {
+    auto datagram = std::format("{} {} {} {} {} {}{}\n", kMagic, type, seq, config_.advertise_host, config_.port, incarnation_, extra);
+    // 捎带最新的更新, 每条发送 retransmits 次后不再捎带
+    for (auto it = updates_.begin(); it != updates_.end();) {
+        if (datagram.size() + it->line.size() + 1 > max_payload()) break;
+        datagram += it->line;
+        datagram += '\n';
+        it = --it->transmits == 0 ? updates_.erase(it) : std::next(it);
+    }
+    send_raw(host, port, datagram);
+}
+
+void GossipNode::send_sync(const std::string &host, uint16_t port, bool request_reply) {
+    auto header = std::format("{} SYNC {} {} {} {}\n", kMagic, request_reply ? 1 : 0, config_.advertise_host, config_.port, incarnation_);
+    std::vector<std::string> lines;
+    for (const auto &[id, member] : members_) {
+        lines.push_back(member_line(member.host, member.port, member.state, member.incarnation));
+    }
+    for (const auto &[origin, entries] : entries_) {
+        for (const auto &[key, entry] : entries) {
+            lines.push_back(entry_line(origin, key, entry));
+        }
+    }
+
+    // 按报文大小分片, 每片都带首行, 接收方逐片独立处理
+    auto datagram = header;
+    for (const auto &line : lines) {
+        if (datagram.size() + line.size() + 1 > max_payload()) {
+            send_raw(host, port, datagram);
+            datagram = header;
+        }
+        datagram += line;
+        datagram += '\n';
+    }
+    send_raw(host, port, datagram);
+}
+
+void GossipNode::send_raw(const std::string &host, uint16_t port, std::string datagram) {
+    sockaddr_storage addr{};
+    int addr_len = to_sockaddr(host, port, addr);
+    if (addr_len == 0 || !bound_) return;
+    if (!config_.secret.empty()) {
+        auto mac = hmac_sha256(config_.secret, datagram);
+        datagram += kMacPrefix;
+        datagram += mac;
+        datagram += '\n';
+    }
+    // 非阻塞发送, 缓冲区满时直接丢弃, 由后续周期重传
+    sendto(static_cast<Socket>(socket_), datagram.data(), static_cast<int>(datagram.size()), 0, reinterpret_cast<sockaddr *>(&addr), addr_len);
+}
+
+bool GossipNode::verify(std::string &datagram) const {
+    if (config_.secret.empty()) return true;
+    if (datagram.size() < kMacLine || datagram.back() != '\n') return false;
+    auto body_size = datagram.size() - kMacLine;
+    std::string_view line(datagram.data() + body_size, kMacLine - 1);
+    if (!line.starts_with(kMacPrefix)) return false;
+    // 未持有密钥的节点发出或被篡改的报文整体丢弃, 不更新成员与条目
+    if (!equal_constant_time(line.substr(kMacPrefix.size()), hmac_sha256(config_.secret, std::string_view(datagram.data(), body_size)))) return false;
+    datagram.resize(body_size);
+    return true;
+}
+
+std::size_t GossipNode::max_payload() const {
+    return config_.secret.empty() ? kMaxDatagram : kMaxDatagram - kMacLine;
+}
+
+std::vector<std::string> GossipNode::random_members(std::size_t count, const std::string &exclude) {
+    std::vector<std::string> candidates;
+    for (const auto &[id, member] : members_) {
+        if (member.state == State::ALIVE && id != exclude) candidates.push_back(id);
+    }
+    std::shuffle(candidates.begin(), candidates.end(), rng_);
+    if (candidates.size() > count) candidates.resize(count);
+    return candidates;
+}
+
+// 每条更新捎带 3 * ceil(log2(n + 1)) 次, n 为成员数, 感染式扩散可在 O(log n) 周期内覆盖全体
+uint32_t GossipNode::retransmits() const {
+    auto members = static_cast<uint32_t>(members_.size()) + 1;
+    return 3 * std::max<uint32_t>(1, std::bit_width(members));
+}
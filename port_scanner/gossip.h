@@ -0,0 +1,202 @@
+// gossip.h
+#pragma once
+
+/**
+ * ************************************************************************
+ *
+ * @file gossip.h
+ * @author xiunneg
+ * @brief  网关之间的 UDP gossip: SWIM 式成员管理(直接探测、间接探测、怀疑、失效,
+ *         以 incarnation 反驳误判), 并交换各网关自身发现的服务条目;
+ *         条目按来源网关独立编号, 只由来源更新, 较新的版本覆盖较旧的版本,
+ *         随探测报文捎带扩散, 另周期性向随机成员推送全量状态兜底
+ * ************************************************************************
+ * @copyright Copyright (c) 2025 xiunneg
+ * ************************************************************************
+ */
+
+#include "port_scanner.h"
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace xiunneg {
+
+class GossipNode {
+    using Logger = std::shared_ptr<module::SimpleLoggerInterface>;
+    using Clock = std::chrono::steady_clock;
+    using RemoteEndpoint = PortScanner::RemoteEndpoint;
+
+public:
+    struct Config {
+        std::string bind_host;                    // 为空时绑定 advertise_host, 不对其他网卡开放
+        uint16_t port = 7946;
+        std::string advertise_host = "127.0.0.1"; // 其他网关访问本机的地址, 与 port 一起作为本节点 id
+        std::vector<std::string> seeds;           // 启动时联系的节点, host:port
+        std::string secret;                       // 集群共享密钥, 非空时报文附带 HMAC-SHA256, 校验失败的报文丢弃
+
+        uint32_t period_ms = 200;           // 探测周期, 每周期探测一个成员
+        uint32_t ping_timeout_ms = 80;      // 直接探测无应答时改由其他成员间接探测
+        uint32_t indirect_probes = 3;       // 间接探测的中转成员数
+        uint32_t suspect_timeout_ms = 2000; // 怀疑状态持续该时间仍未反驳则判定失效
+        uint32_t sync_periods = 10;         // 每隔若干周期向随机成员推送全量状态
+
+        void validate();
+    };
+
+    enum class State {
+        ALIVE,
+        SUSPECT,
+        DEAD
+    };
+
+    struct MemberInfo {
+        std::string id; // host:port
+        State state;
+        uint64_t incarnation;
+    };
+
+    // 其他存活网关发现的服务: key -> 地址, 多个网关提供同一 key 时取 id 最小者; 在 gossip 线程中回调
+    using ViewListener = std::function<void(const std::map<uint16_t, RemoteEndpoint> &)>;
+    // 其他网关对某服务的判定发生变化, alive 为 false 表示其扫描或转发确认下线; 在 gossip 线程中回调
+    using VerdictListener = std::function<void(uint16_t key, const RemoteEndpoint &endpoint, bool alive)>;
+
+private:
+    struct Member {
+        std::string host;
+        uint16_t port;
+        State state;
+        uint64_t incarnation;
+        Clock::time_point state_since;
+    };
+
+    // 某来源网关对一个服务的判定
+    struct Entry {
+        uint64_t version;
+        bool alive;
+        RemoteEndpoint endpoint;
+    };
+
+    // 待捎带的更新, 每条发送若干次后丢弃
+    struct Update {
+        std::string line;
+        uint32_t transmits;
+    };
+
+    // 本周期的探测
+    struct Probe {
+        std::string target;
+        uint64_t seq;
+        Clock::time_point sent;
+        bool indirect_sent = false;
+        bool acked = false;
+    };
+
+    // 代其他成员发出的间接探测: 本节点的 seq -> 请求方、其 seq 与目标
+    struct Relay {
+        std::string requester;
+        uint64_t seq;
+        std::string target_host;
+        uint16_t target_port;
+        Clock::time_point sent;
+    };
+
+    struct Verdict {
+        uint16_t key;
+        RemoteEndpoint endpoint;
+        bool alive;
+    };
+
+    Config config_;
+    Logger logger_;
+    std::string self_id_;
+
+    std::mutex mtx_;
+    uint64_t incarnation_; // 以启动时间初始化, 重启后高于其他成员记录的旧值
+    uint64_t version_;     // 本节点条目的版本, 同样以启动时间初始化
+    std::map<std::string, Member> members_;                     // 不含自身
+    std::map<std::string, std::map<uint16_t, Entry>> entries_;  // 来源 id -> key -> 条目, 含自身
+    std::deque<Update> updates_;
+    std::optional<Probe> probe_;
+    Clock::time_point next_period_{};
+    std::unordered_map<uint64_t, Relay> relays_;
+    std::vector<std::string> probe_order_; // 每轮打乱一次, 保证每个成员在有限周期内被探测
+    std::size_t probe_index_ = 0;
+    std::vector<std::pair<std::string, bool>> pending_syncs_; // 待推送全量状态的成员, 是否请对方回推
+    uint64_t next_seq_ = 1;
+    uint64_t periods_ = 0;
+    std::mt19937 rng_;
+
+    bool view_dirty_ = false;
+    std::map<uint16_t, RemoteEndpoint> view_;
+    std::vector<Verdict> verdicts_;
+    ViewListener view_listener_;
+    VerdictListener verdict_listener_;
+
+    std::uintptr_t socket_;
+    bool bound_ = false;
+    std::thread worker_;
+    std::atomic<bool> running_{false};
+
+public:
+    GossipNode(const Config &config, Logger logger = nullptr);
+    ~GossipNode();
+
+    void set_view_listener(ViewListener listener);
+    void set_verdict_listener(VerdictListener listener);
+
+    // 绑定 UDP 端口并开始探测种子节点, 绑定失败返回 false
+    bool start();
+    void stop();
+
+    /**
+     * ************************************************************************
+     * @brief 以本机视图的全量服务更新本节点的条目, 变化的条目递增版本并扩散;
+     *        可在任意线程调用, 不会回调监听者
+     *
+     * @param[in] services  本机发现的服务, key -> 其他网关可访问的地址
+     * ************************************************************************
+     */
+    void publish_local(const std::map<uint16_t, RemoteEndpoint> &services);
+
+    const std::string &id() const { return self_id_; }
+    std::vector<MemberInfo> members();
+
+    static const char *state_name(State state);
+
+private:
+    void loop();
+    void tick(Clock::time_point now);
+    void handle(const std::string &datagram, Clock::time_point now);
+    void fire_events();
+
+    void apply_member(const std::string &host, uint16_t port, State state, uint64_t incarnation, Clock::time_point now);
+    void apply_entry(const std::string &origin, uint16_t key, Entry entry);
+    void mark_dead(const std::string &id, Member &member, Clock::time_point now);
+
+    void enqueue(std::string line);
+    std::string member_line(const std::string &host, uint16_t port, State state, uint64_t incarnation) const;
+    std::string entry_line(const std::string &origin, uint16_t key, const Entry &entry) const;
+
+    void send(const std::string &host, uint16_t port, const std::string &type, uint64_t seq, const std::string &extra = {});
+    void send_sync(const std::string &host, uint16_t port, bool request_reply);
+    void send_raw(const std::string &host, uint16_t port, std::string datagram);
+    // 去掉并校验报文末尾的 MAC 行, 未设置密钥时原样通过
+    bool verify(std::string &datagram) const;
+    // 单个报文可用于首行与捎带行的字节数, 扣除 MAC 行
+    std::size_t max_payload() const;
+    std::vector<std::string> random_members(std::size_t count, const std::string &exclude);
+    uint32_t retransmits() const;
+};
+} // namespace xiunneg
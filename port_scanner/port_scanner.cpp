@@ -2,15 +2,20 @@
 #include "port_scanner.h"
 
 #include <algorithm>
+#include <charconv>
 #include <chrono>
+#include <filesystem>
 #include <format>
+#include <fstream>
+#include <limits>
 #include <stdexcept>
 #include <sstream>
+#include <utility>
 
+#ifdef _WIN32
 // Windows API
 #define _WINSOCK_DEPRECATED_NO_WARNINGS
 #define NOMINMAX // windows min() max() 冲突
-#include <iostream>
 #include <ws2tcpip.h>
 
 #include <Windows.h>
@@ -22,9 +27,369 @@
 #include <winsock2.h>
 #pragma comment(lib, "ws2_32.lib")
 
+#include <afunix.h>
+#else
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
 using namespace xiunneg;
 
+namespace {
+#ifdef _WIN32
+using Socket = SOCKET;
+using PollFd = WSAPOLLFD;
+using UnixAddress = SOCKADDR_UN;
+constexpr Socket kInvalidSocket = INVALID_SOCKET;
+
+void close_socket(Socket sock) {
+    closesocket(sock);
+}
+
+bool set_non_blocking(Socket sock) {
+    u_long non_blocking = 1;
+    return ioctlsocket(sock, FIONBIO, &non_blocking) == 0;
+}
+
+int poll_sockets(PollFd *fds, std::size_t count, int timeout_ms) {
+    return WSAPoll(fds, static_cast<ULONG>(count), timeout_ms);
+}
+
+// 非阻塞 connect 已发起, 等待可写即可得知结果
+bool connect_in_progress() {
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+}
+#else
+using Socket = int;
+using PollFd = pollfd;
+using UnixAddress = sockaddr_un;
+constexpr Socket kInvalidSocket = -1;
+
+void close_socket(Socket sock) {
+    ::close(sock);
+}
+
+bool set_non_blocking(Socket sock) {
+    int flags = fcntl(sock, F_GETFL);
+    return flags >= 0 && fcntl(sock, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+int poll_sockets(PollFd *fds, std::size_t count, int timeout_ms) {
+    return ::poll(fds, static_cast<nfds_t>(count), timeout_ms);
+}
+
+bool connect_in_progress() {
+    return errno == EINPROGRESS;
+}
+#endif
+
+// 能否连上 Unix 域套接字, 排除服务退出后残留的套接字文件
+bool probe_unix_socket(const std::string &path) {
+    UnixAddress addr{};
+    if (path.size() >= sizeof(addr.sun_path)) return false;
+    addr.sun_family = AF_UNIX;
+    std::copy(path.begin(), path.end(), addr.sun_path);
+
+    Socket sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock == kInvalidSocket) return false;
+    bool ok = connect(sock, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0;
+    close_socket(sock);
+    return ok;
+}
+
+// 本机 TCP 表中落在区间内、处于监听或连接状态的端口, 及占用端口的进程
+struct TcpPorts {
+    std::set<uint16_t> ipv4;
+    std::set<uint16_t> ipv6;
+    std::map<uint16_t, uint32_t> owner_pids;
+};
+
+// 同一端口有多行(监听与已建立的连接)时以监听行的进程为准
+void record_owner(std::map<uint16_t, uint32_t> &owner_pids, uint16_t port, bool listening, uint32_t pid) {
+    if (listening) {
+        owner_pids[port] = pid;
+    } else {
+        owner_pids.try_emplace(port, pid);
+    }
+}
+
+#ifdef _WIN32
+// 读取 TCP 连接表, 失败返回空, 成功时由调用方 free
+template <typename Table, typename Getter>
+Table *load_tcp_table(Getter getter) {
+    ULONG ul_size = sizeof(Table);
+    Table *p_tcp_table = (Table *)malloc(ul_size);
+
+    if (p_tcp_table == nullptr)
+        throw std::runtime_error("PortScanner::scan_port 内存不足,申请失败!");
+
+    // 调用时若内存不足，则释放，再次申请
+    if (getter(p_tcp_table, &ul_size, TRUE) == ERROR_INSUFFICIENT_BUFFER) {
+        free(p_tcp_table);
+        p_tcp_table = (Table *)malloc(ul_size);
+        if (p_tcp_table == nullptr)
+            throw std::runtime_error("PortScanner::scan_port 内存不足,申请失败!");
+    }
+
+    if (getter(p_tcp_table, &ul_size, TRUE) != NO_ERROR) {
+        free(p_tcp_table);
+        return nullptr;
+    }
+    return p_tcp_table;
+}
+
+// 处于监听状态或连接状态
+bool is_occupied(DWORD state) {
+    return state == MIB_TCP_STATE_LISTEN || state == MIB_TCP_STATE_ESTAB;
+}
+
+// IPv4 与 IPv6 连接表各读取一次, 每行按区间掩码过滤
+TcpPorts list_tcp_ports(const std::bitset<65536> &mask, std::map<uint64_t, uint32_t> &) {
+    TcpPorts result;
+    if (auto *p_tcp_table = load_tcp_table<MIB_TCPTABLE2>(GetTcpTable2)) {
+        for (DWORD i = 0; i < p_tcp_table->dwNumEntries; ++i) {
+            const auto &row = p_tcp_table->table[i];
+            auto local_port = ntohs((u_short)row.dwLocalPort);
+            if (mask.test(local_port) && is_occupied(row.dwState)) {
+                result.ipv4.insert(local_port);
+                record_owner(result.owner_pids, local_port, row.dwState == MIB_TCP_STATE_LISTEN, row.dwOwningPid);
+            }
+        }
+        // 手动管理
+        free(p_tcp_table);
+    }
+    if (auto *p_tcp6_table = load_tcp_table<MIB_TCP6TABLE2>(GetTcp6Table2)) {
+        for (DWORD i = 0; i < p_tcp6_table->dwNumEntries; ++i) {
+            const auto &row = p_tcp6_table->table[i];
+            auto local_port = ntohs((u_short)row.dwLocalPort);
+            if (mask.test(local_port) && is_occupied(row.State)) {
+                result.ipv6.insert(local_port);
+                // IPv4 上已有监听进程时以其为准
+                if (!result.ipv4.contains(local_port)) {
+                    record_owner(result.owner_pids, local_port, row.State == MIB_TCP_STATE_LISTEN, row.dwOwningPid);
+                }
+            }
+        }
+        free(p_tcp6_table);
+    }
+    return result;
+}
+
+// 查询进程名与启动时间, 无权限(如系统进程)时只保留 pid
+PortScanner::ProcessInfo query_process(uint32_t pid) {
+    PortScanner::ProcessInfo info;
+    info.pid = pid;
+    HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+    if (process == nullptr) return info;
+
+    FILETIME creation{}, exit{}, kernel{}, user{};
+    if (GetProcessTimes(process, &creation, &exit, &kernel, &user)) {
+        // FILETIME 为 1601 年起的 100ns 计数
+        uint64_t ticks = (static_cast<uint64_t>(creation.dwHighDateTime) << 32) | creation.dwLowDateTime;
+        constexpr uint64_t kUnixEpoch = 116444736000000000ull;
+        info.start_time = ticks > kUnixEpoch ? (ticks - kUnixEpoch) / 10000 : 0;
+    }
+    char path[MAX_PATH]{};
+    DWORD size = MAX_PATH;
+    if (QueryFullProcessImageNameA(process, 0, path, &size)) {
+        info.name = std::filesystem::path(std::string(path, size)).filename().string();
+    }
+    CloseHandle(process);
+    return info;
+}
+#else
+// /proc/net/tcp 的一行: 本地端口、状态与套接字 inode
+struct ProcTcpRow {
+    uint16_t port;
+    bool listening;
+    uint64_t inode;
+};
+
+// 列依次为 sl local_address rem_address st tx:rx tr:when retrnsmt uid timeout inode, 地址与状态为十六进制
+void read_proc_tcp(const char *path, const std::bitset<65536> &mask, std::vector<ProcTcpRow> &rows) {
+    constexpr unsigned kEstablished = 0x01;
+    constexpr unsigned kListen = 0x0A;
+
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line); // 表头
+    while (std::getline(file, line)) {
+        std::istringstream in(line);
+        std::string slot, local, remote, queues, timer;
+        unsigned state = 0;
+        uint32_t retransmits = 0, uid = 0, timeout = 0;
+        uint64_t inode = 0;
+        if (!(in >> slot >> local >> remote >> std::hex >> state >> std::dec >> queues >> timer >> retransmits >> uid >> timeout >> inode)) continue;
+        if (state != kListen && state != kEstablished) continue;
+
+        auto colon = local.rfind(':');
+        unsigned port = 0;
+        if (colon == std::string::npos) continue;
+        auto [end, ec] = std::from_chars(local.data() + colon + 1, local.data() + local.size(), port, 16);
+        if (ec != std::errc{} || port > 65535 || !mask.test(port)) continue;
+        rows.push_back({static_cast<uint16_t>(port), state == kListen, inode});
+    }
+}
+
+// 套接字 inode -> 持有该套接字的进程; 遍历 /proc/<pid>/fd, 无权限的进程查不到, 记为 0
+void resolve_socket_owners(const std::set<uint64_t> &inodes, std::map<uint64_t, uint32_t> &owners) {
+    namespace fs = std::filesystem;
+    for (auto inode : inodes) {
+        owners.emplace(inode, 0);
+    }
+    std::error_code ec;
+    for (const auto &process : fs::directory_iterator("/proc", ec)) {
+        auto name = process.path().filename().string();
+        uint32_t pid = 0;
+        auto [end, parse_ec] = std::from_chars(name.data(), name.data() + name.size(), pid);
+        if (parse_ec != std::errc{} || end != name.data() + name.size()) continue;
+
+        std::error_code fd_ec;
+        for (const auto &fd : fs::directory_iterator(process.path() / "fd", fd_ec)) {
+            std::error_code link_ec;
+            auto target = fs::read_symlink(fd.path(), link_ec).string();
+            // 形如 socket:[12345]
+            if (link_ec || !target.starts_with("socket:[") || target.back() != ']') continue;
+            uint64_t inode = 0;
+            std::from_chars(target.data() + 8, target.data() + target.size() - 1, inode);
+            if (inodes.contains(inode)) {
+                owners[inode] = pid;
+            }
+        }
+    }
+}
+
+// 读取 /proc/net/tcp 与 /proc/net/tcp6; 进程按监听套接字的 inode 查找,
+// inode 不变时沿用缓存, 只有出现新的套接字时才遍历 /proc
+TcpPorts list_tcp_ports(const std::bitset<65536> &mask, std::map<uint64_t, uint32_t> &inode_owners) {
+    TcpPorts result;
+    std::vector<ProcTcpRow> rows4, rows6;
+    read_proc_tcp("/proc/net/tcp", mask, rows4);
+    read_proc_tcp("/proc/net/tcp6", mask, rows6);
+
+    // 每个端口只查一个套接字: 监听优先, IPv4 优先, 不为每条已建立的连接查找进程
+    std::map<uint16_t, const ProcTcpRow *> owner_rows;
+    auto pick = [&owner_rows](const ProcTcpRow &row) {
+        auto [it, inserted] = owner_rows.try_emplace(row.port, &row);
+        if (!inserted && row.listening && !it->second->listening) it->second = &row;
+    };
+    for (const auto &row : rows4) {
+        result.ipv4.insert(row.port);
+        pick(row);
+    }
+    for (const auto &row : rows6) {
+        result.ipv6.insert(row.port);
+        if (!result.ipv4.contains(row.port)) pick(row);
+    }
+
+    std::set<uint64_t> inodes;
+    bool unknown = false;
+    for (const auto &[port, row] : owner_rows) {
+        inodes.insert(row->inode);
+        unknown = unknown || !inode_owners.contains(row->inode);
+    }
+    std::map<uint64_t, uint32_t> owners;
+    if (unknown) {
+        resolve_socket_owners(inodes, owners);
+    } else {
+        for (auto inode : inodes) {
+            owners.emplace(inode, inode_owners.at(inode));
+        }
+    }
+    inode_owners = std::move(owners);
+
+    for (const auto &[port, row] : owner_rows) {
+        record_owner(result.owner_pids, port, row->listening, inode_owners.at(row->inode));
+    }
+    return result;
+}
+
+// 开机时刻, Unix 毫秒
+uint64_t boot_time_ms() {
+    static const uint64_t boot_ms = []() -> uint64_t {
+        std::ifstream file("/proc/stat");
+        std::string key;
+        uint64_t value = 0;
+        while (file >> key) {
+            if (key == "btime" && file >> value) return value * 1000;
+            file.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        }
+        return 0;
+    }();
+    return boot_ms;
+}
+
+// 查询进程名与启动时间, 进程已退出时只保留 pid
+PortScanner::ProcessInfo query_process(uint32_t pid) {
+    PortScanner::ProcessInfo info;
+    info.pid = pid;
+    if (pid == 0) return info;
+
+    auto dir = std::filesystem::path("/proc") / std::to_string(pid);
+    std::error_code ec;
+    auto exe = std::filesystem::read_symlink(dir / "exe", ec);
+    if (!ec) {
+        info.name = exe.filename().string();
+    } else {
+        // 其他用户的进程读不到 exe, comm 为截断到 15 字节的名称
+        std::ifstream comm(dir / "comm");
+        std::getline(comm, info.name);
+    }
+
+    // stat 的第 22 列为启动时刻, 单位为开机后的时钟周期; 第 2 列进程名可含空格, 从最后一个 ')' 之后数起
+    std::ifstream stat_file(dir / "stat");
+    std::string stat;
+    std::getline(stat_file, stat);
+    auto paren = stat.rfind(')');
+    if (paren == std::string::npos) return info;
+    std::istringstream in(stat.substr(paren + 1));
+    std::string field;
+    for (int column = 3; column < 22 && in >> field; ++column) {
+    }
+    uint64_t ticks = 0;
+    auto ticks_per_second = sysconf(_SC_CLK_TCK);
+    if (in >> ticks && ticks_per_second > 0) {
+        info.start_time = boot_time_ms() + ticks * 1000 / static_cast<uint64_t>(ticks_per_second);
+    }
+    return info;
+}
+#endif
+
+// 由 IP 字面量构造地址, 失败返回 0
+int make_sockaddr(const PortScanner::RemoteEndpoint &endpoint, sockaddr_storage &addr) {
+    auto *addr4 = reinterpret_cast<sockaddr_in *>(&addr);
+    auto *addr6 = reinterpret_cast<sockaddr_in6 *>(&addr);
+    if (inet_pton(AF_INET, endpoint.host.c_str(), &addr4->sin_addr) == 1) {
+        addr4->sin_family = AF_INET;
+        addr4->sin_port = htons(endpoint.port);
+        return sizeof(sockaddr_in);
+    }
+    if (inet_pton(AF_INET6, endpoint.host.c_str(), &addr6->sin6_addr) == 1) {
+        addr6->sin6_family = AF_INET6;
+        addr6->sin6_port = htons(endpoint.port);
+        return sizeof(sockaddr_in6);
+    }
+    return 0;
+}
+
+// 扫描结果中 key 的服务是否就是 endpoint: 远程目标比较地址, 本机 TCP 服务比较回环地址与端口, Unix 域套接字服务总不相同
+bool same_as_scanned(const PortScanner::Snapshot &scanned, uint16_t key, const PortScanner::RemoteEndpoint &endpoint) {
+    if (scanned.unix_paths.contains(key)) return false;
+    if (auto it = scanned.remotes.find(key); it != scanned.remotes.end()) {
+        return it->second == endpoint;
+    }
+    return endpoint.port == key && (endpoint.host == "127.0.0.1" || endpoint.host == "::1");
+}
+} // namespace
+
 xiunneg::WSADATARAII::WSADATARAII() {
+#ifdef _WIN32
     std::call_once(init, []() {
         WSADATA wsa_data;
         int result = WSAStartup(MAKEWORD(2, 2), &wsa_data);
@@ -32,28 +397,56 @@ xiunneg::WSADATARAII::WSADATARAII() {
             throw std::runtime_error("WSADATA Failure");
         }
     });
+#endif
 }
 
 xiunneg::WSADATARAII::~WSADATARAII() {
+#ifdef _WIN32
     std::call_once(close, []() {
         WSACleanup();
     });
+#endif
+}
+
+bool PortScanner::is_ip_literal(const std::string &host) {
+    in6_addr addr{};
+    return inet_pton(AF_INET, host.c_str(), &addr) == 1 || inet_pton(AF_INET6, host.c_str(), &addr) == 1;
 }
 
 void PortScanner::Config::validate() {
-    if (end < begin) {
-        auto error_log = std::format("端口扫描器参数错误 end[{}] < begin[{}]", end, begin);
-        throw std::runtime_error(error_log);
+    if (ranges.empty() && remote_targets.empty()) {
+        throw std::runtime_error("端口扫描器参数错误 未配置端口区间或远程目标");
+    }
+    for (const auto &range : ranges) {
+        if (range.end < range.begin) {
+            auto error_log = std::format("端口扫描器参数错误 end[{}] < begin[{}]", range.end, range.begin);
+            throw std::runtime_error(error_log);
+        }
     }
 
-    if (scan_interval < 5) {
-        // 最短为 5s
-        scan_interval = 5;
+    std::set<uint16_t> keys;
+    for (const auto &target : remote_targets) {
+        if (!is_ip_literal(target.endpoint.host)) {
+            throw std::runtime_error(std::format("端口扫描器参数错误 远程地址[{}] 不是 IP 字面量", target.endpoint.host));
+        }
+        auto in_ranges = std::any_of(ranges.begin(), ranges.end(), [&target](const PortRange &range) {
+            return range.begin <= target.key && target.key <= range.end;
+        });
+        if (in_ranges || !keys.insert(target.key).second) {
+            throw std::runtime_error(std::format("端口扫描器参数错误 远程目标编号[{}] 重复或与本机区间冲突", target.key));
+        }
     }
+    remote_timeout_ms = std::max<uint32_t>(remote_timeout_ms, 1);
+    remote_max_in_flight = std::max<uint32_t>(remote_max_in_flight, 1);
+
+    // 最短为 10ms
+    min_scan_interval_ms = std::max<uint32_t>(min_scan_interval_ms, 10);
+    max_scan_interval_ms = std::max(max_scan_interval_ms, min_scan_interval_ms);
 }
 
 PortScanner::PortScanner(const Config &config, Logger logger) :
     config_(config),
+    snapshot_(std::make_shared<Snapshot>()),
     running_(false),
     logger_(logger) {
     // 使用默认日志器
@@ -64,6 +457,27 @@ PortScanner::PortScanner(const Config &config, Logger logger) :
     }
     // 参数校验
     config_.validate();
+    for (const auto &range : config_.ranges) {
+        for (uint32_t port = range.begin; port <= range.end; ++port) {
+            port_mask_.set(port);
+        }
+    }
+
+    // 上次退出前的快照, 版本号延续, 首次扫描以其为基准计算增量
+    if (auto persisted = load_persisted()) {
+        snapshot_ = persisted;
+    }
+
+    if (!config_.shm_name.empty()) {
+        auto writer = std::make_unique<shm::Writer>();
+        if (writer->open(config_.shm_name)) {
+            writer->publish(snapshot_->version, snapshot_->ports);
+            shm_writer_ = std::move(writer);
+            logger_->info(std::format("服务快照写入共享内存 {}", config_.shm_name));
+        } else {
+            logger_->error(std::format("创建共享内存 {} 失败, 不发布共享内存快照", config_.shm_name));
+        }
+    }
 }
 
 PortScanner::~PortScanner() {
@@ -72,118 +486,594 @@ PortScanner::~PortScanner() {
 
 void PortScanner::run() {
     running_.store(true);
-    worker_ = std::thread([this]() {
-        while (running_.load()) {
-            std::unique_lock<std::mutex> timer_lock(timer_mtx_);
-            auto next_run = std::chrono::steady_clock::now() + std::chrono::seconds(config_.scan_interval);
 
-            // do work
-            work();
+    if (!config_.snapshot_path.empty()) {
+        persister_ = std::thread([this]() {
+            std::unique_lock<std::mutex> lock(persist_mtx_);
+            while (true) {
+                persist_cv_.wait(lock, [this]() {
+                    return persist_pending_ != nullptr || persist_stop_;
+                });
+                // 停止前写完最后一版
+                if (auto snapshot = std::exchange(persist_pending_, nullptr)) {
+                    lock.unlock();
+                    persist(*snapshot);
+                    lock.lock();
+                    continue;
+                }
+                break;
+            }
+        });
+    }
+
+    // 首次扫描在调用线程中完成, run 返回时快照已反映当前端口, 调用方随后再开始接受请求
+    auto first_run = std::chrono::steady_clock::now();
+    bool first_changed = scan_once();
 
-            auto is_stop = timer_cv_.wait_until(timer_lock, next_run, [this]() {
-                return !running_.load();
-            });
+    worker_ = std::thread([this, first_run, first_changed]() {
+        const auto min_interval = std::chrono::milliseconds(config_.min_scan_interval_ms);
+        const auto max_interval = std::chrono::milliseconds(config_.max_scan_interval_ms);
+        auto interval = min_interval;
+        auto last_run = first_run;
+        bool changed = first_changed;
 
-            if (is_stop) {
-                break;
+        while (running_.load()) {
+            // 变化后可能还有服务陆续启停, 保持最短周期; 稳定时指数退避
+            interval = changed ? min_interval : std::min(interval * 2, max_interval);
+
+            {
+                std::unique_lock<std::mutex> timer_lock(timer_mtx_);
+                // 注册表的变化随到随合并, 不打断扫描周期
+                bool is_woken = false;
+                while (true) {
+                    is_woken = timer_cv_.wait_until(timer_lock, last_run + interval, [this]() {
+                        return !running_.load() || accelerated_.load() || pending_registered_.has_value();
+                    });
+                    if (!pending_registered_) break;
+                    apply_registered(timer_lock);
+                }
+                if (is_woken) {
+                    if (!running_.load()) {
+                        break;
+                    }
+
+                    // 加速请求: 两次扫描之间至少间隔最短周期, 期间报告的转发失败立即剔除
+                    accelerated_.store(false);
+                    interval = min_interval;
+                    while (true) {
+                        if (!failed_ports_.empty()) {
+                            auto failed = std::exchange(failed_ports_, {});
+                            timer_lock.unlock();
+                            evict_failed(failed);
+                            timer_lock.lock();
+                        }
+                        apply_registered(timer_lock);
+                        timer_cv_.wait_until(timer_lock, last_run + min_interval, [this]() {
+                            return !running_.load() || !failed_ports_.empty() || pending_registered_.has_value();
+                        });
+                        if (!running_.load() || (failed_ports_.empty() && !pending_registered_)) break;
+                    }
+                    if (!running_.load()) {
+                        break;
+                    }
+                }
             }
+
+            last_run = std::chrono::steady_clock::now();
+            changed = scan_once();
         }
     });
 }
 
+bool PortScanner::scan_once() {
+    bool changed = work();
+    if (shm_writer_) {
+        shm_writer_->touch();
+    }
+    return changed;
+}
+
 void PortScanner::stop() {
-    running_.store(false);
+    {
+        std::lock_guard<std::mutex> timer_lock(timer_mtx_);
+        running_.store(false);
+    }
     timer_cv_.notify_one();
     if (worker_.joinable())
         worker_.join();
+
+    {
+        std::lock_guard<std::mutex> persist_lock(persist_mtx_);
+        persist_stop_ = true;
+    }
+    persist_cv_.notify_one();
+    if (persister_.joinable())
+        persister_.join();
 }
 
 std::set<uint16_t> xiunneg::PortScanner::get_occupied_ports() {
-    return occupied_ports;
+    return get_snapshot()->ports;
+}
+
+PortScanner::SnapshotPtr PortScanner::get_snapshot() {
+    std::shared_lock read_lock(data_mtx_);
+    return snapshot_;
+}
+
+void PortScanner::subscribe(Subscriber subscriber) {
+    std::unique_lock lck(subscriber_mtx_);
+    subscriber(get_snapshot());
+    subscribers_.push_back(std::move(subscriber));
+}
+
+void PortScanner::publish(const SnapshotPtr &snapshot) {
+    if (shm_writer_) {
+        shm_writer_->publish(snapshot->version, snapshot->ports);
+    }
+    // 写文件交给后台线程, 不在持有 publish_mtx_ 的发布路径上做磁盘 I/O
+    if (!config_.snapshot_path.empty()) {
+        {
+            std::lock_guard<std::mutex> persist_lock(persist_mtx_);
+            persist_pending_ = snapshot;
+        }
+        persist_cv_.notify_one();
+    }
+    std::unique_lock lck(subscriber_mtx_);
+    for (const auto &subscriber : subscribers_) {
+        subscriber(snapshot);
+    }
+}
+
+// 每行一项: version <n> | port <p> | ipv6 <p> | unix <p> <path> | remote <key> <host> <port> | owner <p> <pid> <start_time> <name>
+// 经 gossip 获知的服务不保存, 重启后由其他网关重新同步
+void PortScanner::persist(const Snapshot &snapshot) {
+    std::ostringstream out;
+    out << "# gateway discovery snapshot\n";
+    out << "version " << snapshot.version << "\n";
+    for (auto port : snapshot.ports) {
+        if (snapshot.peers.contains(port)) continue;
+        out << "port " << port << "\n";
+    }
+    for (auto port : snapshot.ipv6_only) {
+        out << "ipv6 " << port << "\n";
+    }
+    for (const auto &[port, path] : snapshot.unix_paths) {
+        out << "unix " << port << " " << path << "\n";
+    }
+    for (const auto &[key, endpoint] : snapshot.remotes) {
+        if (snapshot.peers.contains(key)) continue;
+        out << "remote " << key << " " << endpoint.host << " " << endpoint.port << "\n";
+    }
+    // 进程归属一并保存, 网关停止期间服务重启时首次扫描即可判定为 rebound
+    for (const auto &[port, owner] : snapshot.owners) {
+        out << "owner " << port << " " << owner.pid << " " << owner.start_time << " " << owner.name << "\n";
+    }
+
+    // 先写临时文件再替换, 中途退出不会留下半个快照
+    auto tmp_path = config_.snapshot_path + ".tmp";
+    {
+        std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+        file << out.str();
+        if (!file.good()) {
+            logger_->error(std::format("写入快照文件 {} 失败", tmp_path));
+            return;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp_path, config_.snapshot_path, ec);
+    if (ec) {
+        logger_->error(std::format("替换快照文件 {} 失败 {}", config_.snapshot_path, ec.message()));
+    }
+}
+
+PortScanner::SnapshotPtr PortScanner::load_persisted() {
+    if (config_.snapshot_path.empty()) return nullptr;
+    std::ifstream file(config_.snapshot_path, std::ios::binary);
+    if (!file.is_open()) return nullptr;
+
+    auto snapshot = std::make_shared<Snapshot>();
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream in(line);
+        std::string kind;
+        in >> kind;
+        uint32_t port = 0;
+        if (kind == "version") {
+            in >> snapshot->version;
+        } else if (kind == "port" && in >> port && port <= 65535) {
+            snapshot->ports.insert(static_cast<uint16_t>(port));
+        } else if (kind == "ipv6" && in >> port && port <= 65535) {
+            snapshot->ipv6_only.insert(static_cast<uint16_t>(port));
+        } else if (kind == "unix" && in >> port && port <= 65535) {
+            std::string path;
+            std::getline(in >> std::ws, path);
+            snapshot->unix_paths.emplace(static_cast<uint16_t>(port), path);
+        } else if (kind == "remote" && in >> port && port <= 65535) {
+            RemoteEndpoint endpoint{};
+            uint32_t remote_port = 0;
+            if (in >> endpoint.host >> remote_port && remote_port <= 65535) {
+                endpoint.port = static_cast<uint16_t>(remote_port);
+                snapshot->remotes.emplace(static_cast<uint16_t>(port), endpoint);
+            }
+        } else if (kind == "owner" && in >> port && port <= 65535) {
+            ProcessInfo owner;
+            if (in >> owner.pid >> owner.start_time) {
+                std::getline(in >> std::ws, owner.name);
+                snapshot->owners.emplace(static_cast<uint16_t>(port), owner);
+            }
+        }
+    }
+    logger_->info(std::format("载入快照文件 {}: 版本 {}, 服务 {}, 首次扫描完成前作为临时状态", config_.snapshot_path, snapshot->version, print_set(snapshot->ports)));
+    return snapshot;
 }
 
-void PortScanner::work() {
+void PortScanner::accelerate() {
+    // 已有未处理的请求时不再加锁唤醒, 失败风暴下只是一次原子操作
+    if (accelerated_.exchange(true)) return;
+    {
+        std::lock_guard<std::mutex> timer_lock(timer_mtx_);
+    }
+    timer_cv_.notify_one();
+}
+
+void PortScanner::report_failure(uint16_t port) {
+    // 已被剔除, 后续请求在路由阶段即被拒绝
+    if (!get_snapshot()->ports.contains(port)) return;
+
+    // 只登记并唤醒扫描线程, 快照由扫描线程生成并发布, 不占用请求线程与事件循环
+    {
+        std::lock_guard<std::mutex> timer_lock(timer_mtx_);
+        failed_ports_.insert(port);
+        accelerated_.store(true);
+    }
+    timer_cv_.notify_one();
+}
+
+void PortScanner::evict_failed(const std::set<uint16_t> &ports) {
+    std::lock_guard<std::mutex> publish_lock(publish_mtx_);
+    auto previous = get_snapshot();
+    bool evicted = false;
+    for (auto port : ports) {
+        if (!previous->ports.contains(port) || suspects_.contains(port)) continue;
+        suspects_[port] = ++suspect_seq_;
+        evicted = true;
+        logger_->warn(std::format("服务 {} 连接失败, 暂停路由等待扫描确认", port));
+    }
+    // 未经扫描确认的重建会剔除全部待确认端口
+    if (evicted) {
+        rebuild_locked(std::nullopt);
+    }
+}
+
+bool PortScanner::work() {
     try {
-        scan_port();
+        return scan_port();
     } catch (const std::runtime_error &e) {
         logger_->error(std::string("PortScanner::work ").append(e.what()));
     } catch (...) {
         logger_->error("PortScanner::work 未知异常");
     }
+    return false;
 }
 
-void PortScanner::scan_port() {
+bool PortScanner::scan_port() {
     std::set<uint16_t> current_occupied_ports;
 
-    ULONG ul_size = sizeof(MIB_TCPTABLE2);
-    PMIB_TCPTABLE2 p_tcp_table = (PMIB_TCPTABLE2)malloc(ul_size);
+    // 扫描开始后才被剔除的端口, 本轮结果不足以确认
+    uint64_t scan_seq = 0;
+    {
+        std::lock_guard<std::mutex> publish_lock(publish_mtx_);
+        scan_seq = suspect_seq_;
+    }
 
-    if (p_tcp_table == nullptr)
-        throw std::runtime_error("PortScanner::scan_port 内存不足,申请失败!");
+    auto tcp_ports = list_tcp_ports(port_mask_, inode_owners_);
+    current_occupied_ports = std::move(tcp_ports.ipv4);
+    const auto &ipv6_ports = tcp_ports.ipv6;
+    const auto &owner_pids = tcp_ports.owner_pids;
 
-    // 调用时若内存不足，则释放，再次申请
-    if (GetTcpTable2(p_tcp_table, &ul_size, TRUE) == ERROR_INSUFFICIENT_BUFFER) {
-        free(p_tcp_table);
-        p_tcp_table = (PMIB_TCPTABLE2)malloc(ul_size);
-        if (p_tcp_table == nullptr)
-            throw std::runtime_error("PortScanner::scan_port 内存不足,申请失败!");
+    // 同一进程通常占用多个端口, 每个 pid 只查询一次
+    std::map<uint16_t, ProcessInfo> current_owners;
+    std::map<uint32_t, ProcessInfo> processes;
+    for (const auto &[port, pid] : owner_pids) {
+        auto it = processes.find(pid);
+        if (it == processes.end()) {
+            it = processes.emplace(pid, query_process(pid)).first;
+        }
+        current_owners.emplace(port, it->second);
     }
 
-    if (GetTcpTable2(p_tcp_table, &ul_size, TRUE) == NO_ERROR) {
-        // 遍历端口
-        for (DWORD i = 0; i < p_tcp_table->dwNumEntries; ++i) {
-            auto local_port = ntohs((u_short)p_tcp_table->table[i].dwLocalPort);
-            // 在区间内
-            if (config_.begin <= local_port
-                && local_port <= config_.end
-                && (p_tcp_table->table[i].dwState == MIB_TCP_STATE_LISTEN
-                    || p_tcp_table->table[i].dwState == MIB_TCP_STATE_ESTAB) // 处于监听状态或连接状态
-            ) {
-                current_occupied_ports.insert(local_port);
+    // 同时在 IPv4 上监听的服务优先走 127.0.0.1
+    std::set<uint16_t> current_ipv6_only;
+    std::set_difference(
+        ipv6_ports.begin(), ipv6_ports.end(),
+        current_occupied_ports.begin(), current_occupied_ports.end(),
+        std::inserter(current_ipv6_only, current_ipv6_only.begin()));
+    current_occupied_ports.insert(ipv6_ports.begin(), ipv6_ports.end());
+
+    // Unix 域套接字服务同样视为在线
+    auto current_unix_paths = scan_unix_sockets();
+    for (const auto &[port, path] : current_unix_paths) {
+        current_occupied_ports.insert(port);
+        current_ipv6_only.erase(port);
+        current_owners.erase(port);
+    }
+
+    auto current_remotes = scan_remotes();
+    for (const auto &[key, endpoint] : current_remotes) {
+        current_occupied_ports.insert(key);
+    }
+
+    std::lock_guard<std::mutex> publish_lock(publish_mtx_);
+    scanned_.ports = std::move(current_occupied_ports);
+    scanned_.unix_paths = std::move(current_unix_paths);
+    scanned_.ipv6_only = std::move(current_ipv6_only);
+    scanned_.remotes = std::move(current_remotes);
+    scanned_.owners = std::move(current_owners);
+    return rebuild_locked(scan_seq);
+}
+
+void PortScanner::update_registered(std::map<uint16_t, ServiceInfo> services) {
+    // 与 report_failure 相同, 只交给扫描线程合并发布; 积压时只保留最新一版
+    {
+        std::lock_guard<std::mutex> timer_lock(timer_mtx_);
+        pending_registered_ = std::move(services);
+    }
+    timer_cv_.notify_one();
+}
+
+void PortScanner::apply_registered(std::unique_lock<std::mutex> &timer_lock) {
+    if (!pending_registered_) return;
+    auto services = std::move(*pending_registered_);
+    pending_registered_.reset();
+    timer_lock.unlock();
+    {
+        std::lock_guard<std::mutex> publish_lock(publish_mtx_);
+        registered_ = std::move(services);
+        rebuild_locked(std::nullopt);
+    }
+    timer_lock.lock();
+}
+
+bool PortScanner::claimed_by_scan(uint16_t key, const RemoteEndpoint &endpoint) {
+    // 已登记的编号由注册表自己判断冲突, 其他网关的服务优先级最低
+    auto snapshot = get_snapshot();
+    if (!snapshot->ports.contains(key) || snapshot->services.contains(key) || snapshot->peers.contains(key)) {
+        return false;
+    }
+    return !same_as_scanned(*snapshot, key, endpoint);
+}
+
+void PortScanner::update_peers(std::map<uint16_t, RemoteEndpoint> peers) {
+    std::lock_guard<std::mutex> publish_lock(publish_mtx_);
+    peers_ = std::move(peers);
+    rebuild_locked(std::nullopt);
+}
+
+bool PortScanner::rebuild_locked(std::optional<uint64_t> scan_seq) {
+    // 扫描到的服务优先: 注册只补充扫描结果中没有的编号, 不能改写已在线服务的地址;
+    // 指向同一服务的注册只附带名称、权重与元数据
+    auto current = std::make_shared<Snapshot>(scanned_);
+    for (const auto &[key, info] : registered_) {
+        if (scanned_.ports.contains(key)) {
+            if (same_as_scanned(scanned_, key, info.endpoint)) {
+                current->services.emplace(key, info);
             }
+            continue;
         }
+        current->ports.insert(key);
+        current->remotes[key] = info.endpoint;
+        current->services.emplace(key, info);
     }
 
-    // 手动管理
-    free(p_tcp_table);
+    // 其他网关的服务只在本机没有同编号服务时生效
+    for (const auto &[key, endpoint] : peers_) {
+        if (current->ports.contains(key)) continue;
+        current->ports.insert(key);
+        current->remotes.emplace(key, endpoint);
+        current->peers.emplace(key, endpoint);
+    }
+
+    // 扫描开始后才被剔除的端口本轮不足以确认, 非扫描触发的重建不做确认
+    for (auto it = suspects_.begin(); it != suspects_.end();) {
+        auto [port, seq] = *it;
+        if (!scan_seq || seq > *scan_seq) {
+            current->ports.erase(port);
+            current->unix_paths.erase(port);
+            current->ipv6_only.erase(port);
+            current->remotes.erase(port);
+            current->services.erase(port);
+            current->owners.erase(port);
+            current->peers.erase(port);
+            ++it;
+            continue;
+        }
+        if (current->ports.contains(port)) {
+            logger_->info(std::format("服务 {} 仍在监听, 恢复路由", port));
+        } else {
+            logger_->info(std::format("服务 {} 确认下线", port));
+        }
+        it = suspects_.erase(it);
+    }
 
     // 计算新增和关闭
-    {
-        std::shared_lock read_lock(data_mtx_);
-
-        // 有端口更新
-        if (current_occupied_ports != occupied_ports) {
-            // 新增
-            std::set<uint16_t> add_ports;
-            std::set_difference(
-                current_occupied_ports.begin(), current_occupied_ports.end(),
-                occupied_ports.begin(), occupied_ports.end(),
-                std::inserter(add_ports, add_ports.begin()));
-
-            logger_->info(std::format("监测到服务新增: {}", print_set(add_ports)));
-
-            // 关闭
-            if (current_occupied_ports != occupied_ports) {
-                std::set<uint16_t> closed_ports;
-                std::set_difference(
-                    occupied_ports.begin(), occupied_ports.end(),
-                    current_occupied_ports.begin(), current_occupied_ports.end(),
-                    std::inserter(closed_ports, closed_ports.begin()));
-
-                logger_->info(std::format("监测到服务关闭: {}", print_set(closed_ports)));
-            }
+    auto previous = get_snapshot();
+    if (current->ports == previous->ports
+        && current->unix_paths == previous->unix_paths
+        && current->ipv6_only == previous->ipv6_only
+        && current->remotes == previous->remotes
+        && current->services == previous->services
+        && current->owners == previous->owners
+        && current->peers == previous->peers) {
+        return false;
+    }
+
+    // 前后两版都在线但进程不同: 服务已重启或端口被其他进程占用
+    for (const auto &[port, owner] : current->owners) {
+        auto it = previous->owners.find(port);
+        if (it == previous->owners.end()) continue;
+        if (it->second.pid != owner.pid || it->second.start_time != owner.start_time) {
+            current->rebound.insert(port);
+            logger_->warn(std::format("服务 {} 的进程由 {}({}) 变为 {}({})", port, it->second.name, it->second.pid, owner.name, owner.pid));
         }
     }
 
+    // 新增
+    std::set_difference(
+        current->ports.begin(), current->ports.end(),
+        previous->ports.begin(), previous->ports.end(),
+        std::inserter(current->added, current->added.begin()));
+
+    logger_->info(std::format("监测到服务新增: {}", print_set(current->added)));
+
+    // 关闭
+    std::set_difference(
+        previous->ports.begin(), previous->ports.end(),
+        current->ports.begin(), current->ports.end(),
+        std::inserter(current->removed, current->removed.begin()));
+
+    logger_->info(std::format("监测到服务关闭: {}", print_set(current->removed)));
+    logger_->info(std::format("监测到服务集合: {}", print_set(current->ports)));
+    // Unix 域套接字与远程服务只输出相对上一版本的变化, 服务多时不随每次发布全量输出
+    for (const auto &[port, path] : current->unix_paths) {
+        auto it = previous->unix_paths.find(port);
+        if (it != previous->unix_paths.end() && it->second == path) continue;
+        logger_->info(std::format("Unix 域套接字服务: {} -> {}", port, path));
+    }
+    for (const auto &[port, path] : previous->unix_paths) {
+        if (current->unix_paths.contains(port)) continue;
+        logger_->info(std::format("Unix 域套接字服务移除: {} -> {}", port, path));
+    }
+    for (const auto &[key, endpoint] : current->remotes) {
+        auto it = previous->remotes.find(key);
+        if (it != previous->remotes.end() && it->second == endpoint) continue;
+        logger_->info(std::format("远程服务: {} -> {}:{}", key, endpoint.host, endpoint.port));
+    }
+    for (const auto &[key, endpoint] : previous->remotes) {
+        if (current->remotes.contains(key)) continue;
+        logger_->info(std::format("远程服务移除: {} -> {}:{}", key, endpoint.host, endpoint.port));
+    }
+    if (!current->ipv6_only.empty()) {
+        logger_->info(std::format("仅 IPv6 服务: {}", print_set(current->ipv6_only)));
+    }
+
     // 刷新
+    current->version = previous->version + 1;
+    SnapshotPtr snapshot = current;
     {
         std::unique_lock write_lock(data_mtx_);
+        snapshot_ = snapshot;
+    }
+
+    publish(snapshot);
+    return true;
+}
+
+std::map<uint16_t, std::string> PortScanner::scan_unix_sockets() {
+    namespace fs = std::filesystem;
+    std::map<uint16_t, std::string> unix_paths;
+
+    if (!config_.unix_socket_dir.empty()) {
+        std::error_code ec;
+        for (const auto &entry : fs::directory_iterator(config_.unix_socket_dir, ec)) {
+            if (entry.path().extension() != ".sock") continue;
+
+            auto stem = entry.path().stem().string();
+            uint16_t port{};
+            auto [end, parse_ec] = std::from_chars(stem.data(), stem.data() + stem.size(), port);
+            if (parse_ec != std::errc{} || end != stem.data() + stem.size()) continue;
+            if (!port_mask_.test(port)) continue;
 
-        if (current_occupied_ports != occupied_ports) {
-            logger_->info(std::format("监测到服务集合: {}", print_set(current_occupied_ports)));
-            occupied_ports = current_occupied_ports;
+            auto path = entry.path().string();
+            if (probe_unix_socket(path)) {
+                unix_paths.emplace(port, std::move(path));
+            }
+        }
+        if (ec) {
+            logger_->warn(std::format("无法遍历套接字目录 {}: {}", config_.unix_socket_dir, ec.message()));
+        }
+    }
+
+    // 配置中的映射优先于目录扫描
+    for (const auto &[port, path] : config_.unix_sockets) {
+        if (probe_unix_socket(path)) {
+            unix_paths[port] = path;
+        }
+    }
+    return unix_paths;
+}
+
+std::map<uint16_t, PortScanner::RemoteEndpoint> PortScanner::scan_remotes() {
+    std::map<uint16_t, RemoteEndpoint> remotes;
+    const auto &targets = config_.remote_targets;
+
+    std::vector<PollFd> fds;
+    std::vector<const RemoteTarget *> pending; // 与 fds 一一对应
+    fds.reserve(std::min<std::size_t>(targets.size(), config_.remote_max_in_flight));
+    pending.reserve(fds.capacity());
+
+    for (std::size_t next = 0; next < targets.size();) {
+        // 发起一批非阻塞连接
+        fds.clear();
+        pending.clear();
+        for (; next < targets.size() && fds.size() < config_.remote_max_in_flight; ++next) {
+            const auto &target = targets[next];
+            sockaddr_storage addr{};
+            int addr_len = make_sockaddr(target.endpoint, addr);
+
+            Socket sock = socket(addr.ss_family, SOCK_STREAM, IPPROTO_TCP);
+            if (sock == kInvalidSocket) {
+                // 句柄耗尽时先等本批完成, 其余留给下一批
+                if (fds.empty()) {
+                    logger_->warn("远程探测无法创建套接字, 本轮结果不完整");
+                    return remotes;
+                }
+                break;
+            }
+            set_non_blocking(sock);
+
+            if (connect(sock, reinterpret_cast<sockaddr *>(&addr), addr_len) == 0) {
+                remotes.emplace(target.key, target.endpoint);
+                close_socket(sock);
+                continue;
+            }
+            if (!connect_in_progress()) {
+                close_socket(sock);
+                continue;
+            }
+            fds.push_back(PollFd{.fd = sock, .events = POLLOUT, .revents = 0});
+            pending.push_back(&target);
+        }
+
+        // 等待本批连接完成, 超时未完成的视为离线
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(config_.remote_timeout_ms);
+        while (!fds.empty()) {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+            if (remaining <= 0 || poll_sockets(fds.data(), fds.size(), static_cast<int>(remaining)) <= 0) {
+                break;
+            }
+            for (std::size_t i = 0; i < fds.size();) {
+                if (fds[i].revents == 0) {
+                    ++i;
+                    continue;
+                }
+                int error = 0;
+                socklen_t len = sizeof(error);
+                getsockopt(fds[i].fd, SOL_SOCKET, SO_ERROR, reinterpret_cast<char *>(&error), &len);
+                if (error == 0 && (fds[i].revents & POLLOUT)) {
+                    remotes.emplace(pending[i]->key, pending[i]->endpoint);
+                }
+                close_socket(fds[i].fd);
+                fds[i] = fds.back();
+                fds.pop_back();
+                pending[i] = pending.back();
+                pending.pop_back();
+            }
+        }
+        for (const auto &fd : fds) {
+            close_socket(fd.fd);
         }
     }
+    return remotes;
 }
 
 std::string PortScanner::print_set(const std::set<uint16_t> &set) {
@@ -6,16 +6,26 @@
  *
  * @file port_scanner.h
  * @author xiunneg
- * @brief  仅支持 Windows 平台,基于 Windows API 的指定端口区间扫描器
+ * @brief  支持 Windows 与 Linux 平台的多端口区间扫描器, 覆盖 IPv4 与 IPv6,
+ *         Windows 读取 TCP 连接表, Linux 读取 /proc/net/tcp 与 /proc/net/tcp6,
+ *         另可以非阻塞 connect 批量探测远程主机
  * ************************************************************************
  * @copyright Copyright (c) 2025 xiunneg
  * ************************************************************************
  */
 
+#include "shm_snapshot.h"
 #include "simple_log/simple_log.h"
 
 #include <stdint.h>
+#include <bitset>
+#include <map>
+#include <optional>
 #include <set>
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
 #include <thread>
 #include <atomic>
 #include <shared_mutex>
@@ -37,27 +47,124 @@ class PortScanner {
     using Logger = std::shared_ptr<module::SimpleLoggerInterface>;
 
 public:
-    struct Config {
-        // port 0 ~ 65535
+    // 闭区间 [begin, end], port 0 ~ 65535
+    struct PortRange {
         uint16_t begin;
         uint16_t end;
+    };
+
+    // 远程服务地址, host 为 IPv4/IPv6 字面量
+    struct RemoteEndpoint {
+        std::string host;
+        uint16_t port;
+
+        bool operator==(const RemoteEndpoint &) const = default;
+    };
+
+    // 远程探测目标: 连接成功时以 key 计入快照, key 与本机端口共用同一编号空间
+    struct RemoteTarget {
+        uint16_t key;
+        RemoteEndpoint endpoint;
+    };
+
+    // 经注册表登记的服务, 不经扫描发现
+    struct ServiceInfo {
+        std::string name;
+        RemoteEndpoint endpoint;
+        uint32_t weight = 1;
+        std::map<std::string, std::string> metadata;
+
+        bool operator==(const ServiceInfo &) const = default;
+    };
+
+    // 占用端口的进程, pid 与启动时间共同标识一个进程实例(pid 可被复用)
+    struct ProcessInfo {
+        uint32_t pid = 0;
+        std::string name;        // 可执行文件名, 无权限查询时为空
+        uint64_t start_time = 0; // 进程启动时间, Unix 毫秒, 无权限查询时为 0
 
-        uint16_t scan_interval = 5; // 扫描周期,秒
+        bool operator==(const ProcessInfo &) const = default;
+    };
+
+    struct Config {
+        // 扫描的本机端口区间, 可不连续, 允许重叠
+        std::vector<PortRange> ranges;
+
+        // 远程探测: 每轮对全部目标发起非阻塞 connect, 超时未连上视为离线
+        std::vector<RemoteTarget> remote_targets;
+        uint32_t remote_timeout_ms = 200;     // 单轮探测超时
+        uint32_t remote_max_in_flight = 4096; // 同时进行中的连接数上限
+
+        // 扫描周期,毫秒: 变化或转发失败后按最短周期扫描, 稳定时逐轮翻倍直到最长周期
+        uint32_t min_scan_interval_ms = 100;
+        uint32_t max_scan_interval_ms = 5000;
+
+        // Unix 域套接字服务: 目录下名为 <port>.sock 的套接字, 端口须在区间内
+        std::string unix_socket_dir;
+        // Unix 域套接字服务: 端口 -> 套接字路径, 不受区间限制
+        std::map<uint16_t, std::string> unix_sockets;
+
+        // 共享内存快照名称, 非空时每次发布快照同时写入, 同机进程以 shm_snapshot.h 读取
+        std::string shm_name;
+
+        // 快照文件, 非空时每次发布快照后写入, 启动时读取作为首次扫描完成前的临时状态
+        std::string snapshot_path;
 
         void validate();
     };
 
+    // 一次扫描结果的不可变快照,发布后只读,可在线程间无锁共享
+    struct Snapshot {
+        uint64_t version = 0;     // 每次端口集合变化递增
+        std::set<uint16_t> ports; // 正在被占用的端口集合, 含 Unix 域套接字服务
+        std::set<uint16_t> ipv6_only; // 只在 IPv6 上监听的端口, 经 ::1 访问
+        std::map<uint16_t, std::string> unix_paths; // 经 Unix 域套接字访问的服务: 端口 -> 路径
+        std::map<uint16_t, RemoteEndpoint> remotes; // 远程服务: key -> 地址, 含注册的服务
+        std::map<uint16_t, ServiceInfo> services;   // 注册的服务: key -> 名称/权重/元数据
+        std::map<uint16_t, ProcessInfo> owners;     // 本机 TCP 服务: 端口 -> 监听进程
+        std::map<uint16_t, RemoteEndpoint> peers;   // 经 gossip 从其他网关获知的服务, 同时计入 remotes
+        std::set<uint16_t> added;                   // 相对上一版本新增的端口
+        std::set<uint16_t> removed;                 // 相对上一版本关闭的端口
+        std::set<uint16_t> rebound;                 // 相对上一版本仍在线但已换了进程的端口, 其连接与状态应丢弃
+    };
+    using SnapshotPtr = std::shared_ptr<const Snapshot>;
+    using Subscriber = std::function<void(const SnapshotPtr &)>;
+
 private:
     Config config_;
+    std::bitset<65536> port_mask_; // 由 ranges 展开, 扫描时逐行 O(1) 判断
+    std::map<uint64_t, uint32_t> inode_owners_; // Linux: 上轮监听套接字 inode -> pid, 仅扫描线程访问
 
-    std::set<uint16_t> occupied_ports; // 正在被占用的端口集合
+    SnapshotPtr snapshot_; // 当前快照
+
+    std::mutex subscriber_mtx_;
+    std::vector<Subscriber> subscribers_;
 
     std::thread worker_;
     std::atomic<bool> running_;
+    std::atomic<bool> accelerated_{false}; // 已请求尽快重扫, 由扫描线程清除
     std::mutex timer_mtx_;
     std::condition_variable timer_cv_;
+    std::set<uint16_t> failed_ports_; // 转发失败待剔除的端口, 由扫描线程取出, 受 timer_mtx_ 保护
+    std::optional<std::map<uint16_t, ServiceInfo>> pending_registered_; // 待合并的注册表全量服务, 由扫描线程取出, 受 timer_mtx_ 保护
     std::shared_mutex data_mtx_;
 
+    // 生成并发布快照的互斥, 扫描线程与注册表、gossip 的更新共用, 保证版本按序发布
+    std::mutex publish_mtx_;
+    std::map<uint16_t, uint64_t> suspects_; // 转发失败而被剔除的端口 -> 剔除序号, 待扫描确认
+    uint64_t suspect_seq_ = 0;
+    Snapshot scanned_;                               // 最近一次扫描的结果, 不含注册的服务
+    std::map<uint16_t, ServiceInfo> registered_;     // 注册表中的服务
+    std::map<uint16_t, RemoteEndpoint> peers_;       // 其他网关发现的服务, 优先级最低
+    std::unique_ptr<shm::Writer> shm_writer_;        // 未配置 shm_name 或创建失败时为空, 发布时持有 publish_mtx_
+
+    // 快照文件由后台线程写入, 发布时只替换待写的快照, 积压时只写最新一版
+    std::thread persister_;
+    std::mutex persist_mtx_;
+    std::condition_variable persist_cv_;
+    SnapshotPtr persist_pending_;
+    bool persist_stop_ = false;
+
     Logger logger_;
 
 public:
@@ -68,10 +175,63 @@ public:
     void stop();
 
     std::set<uint16_t> get_occupied_ports();
+    SnapshotPtr get_snapshot();
+
+    /**
+     * ************************************************************************
+     * @brief 订阅端口集合变化,订阅时立即投递一次当前快照,
+     *        快照中的 added/removed 为相对上一版本的增量
+     *
+     * @param[in] subscriber  回调,在扫描线程中执行,不应阻塞
+     * ************************************************************************
+     */
+    void subscribe(Subscriber subscriber);
+
+    /**
+     * ************************************************************************
+     * @brief 回到最短扫描周期并尽快重扫, 如转发失败时调用;
+     *        距上次扫描不足最短周期时等到满足为止, 可在任意线程频繁调用
+     * ************************************************************************
+     */
+    void accelerate();
+
+    /**
+     * ************************************************************************
+     * @brief 连接上游失败时调用: 唤醒扫描线程发布不含该端口的快照使其退出路由,
+     *        并加速重扫确认; 确认时端口仍在监听则恢复. 只登记端口, 可在任意线程调用
+     *
+     * @param[in] port  连接失败的服务端口
+     * ************************************************************************
+     */
+    void report_failure(uint16_t port);
+
+    // 以注册表的全量服务替换已登记的服务; 只登记并唤醒扫描线程, 由其合并发布, 可在任意线程调用
+    void update_registered(std::map<uint16_t, ServiceInfo> services);
+
+    // key 是否已被扫描到的本机、Unix 域套接字或远程服务占用且地址不是 endpoint, 此时注册不会生效
+    bool claimed_by_scan(uint16_t key, const RemoteEndpoint &endpoint);
+
+    // 以 gossip 获知的全量服务替换, 仅补充本机扫描与注册表中没有的编号
+    void update_peers(std::map<uint16_t, RemoteEndpoint> peers);
+
+    // host 是否为 IPv4/IPv6 字面量, 远程目标与注册的服务只接受 IP 字面量
+    static bool is_ip_literal(const std::string &host);
 
 private:
-    void work();
-    void scan_port();
+    bool work();
+    bool scan_once();
+    bool scan_port();
+    // 合并扫描结果与注册的服务, 有变化时发布新快照; 须持有 publish_mtx_
+    bool rebuild_locked(std::optional<uint64_t> scan_seq);
+    // 扫描线程中剔除转发失败的端口
+    void evict_failed(const std::set<uint16_t> &ports);
+    // 扫描线程中合并待处理的注册表服务, 调用时持有 timer_lock, 发布期间释放
+    void apply_registered(std::unique_lock<std::mutex> &timer_lock);
+    std::map<uint16_t, std::string> scan_unix_sockets();
+    std::map<uint16_t, RemoteEndpoint> scan_remotes();
+    void publish(const SnapshotPtr &snapshot);
+    void persist(const Snapshot &snapshot);
+    SnapshotPtr load_persisted();
     std::string print_set(const std::set<uint16_t> &set);
 };
 } // namespace xiunneg
@@ -0,0 +1,267 @@
+// shm_snapshot.h
+#pragma once
+
+/**
+ * ************************************************************************
+ *
+ * @file shm_snapshot.h
+ * @author xiunneg
+ * @brief  共享内存中的服务发现快照, 仅含头文件, 同机进程直接包含即可读取;
+ *         端口扫描器为唯一写者, 以 seqlock 保护, 读者无锁、无系统调用;
+ *         Windows 使用命名文件映射, 其他平台使用 POSIX 共享内存
+ * ************************************************************************
+ * @copyright Copyright (c) 2025 xiunneg
+ * ************************************************************************
+ */
+
+#include <stdint.h>
+#include <atomic>
+#include <bit>
+#include <bitset>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+// 避免先于 winsock2.h 引入旧的 winsock.h
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace xiunneg::shm {
+
+inline constexpr uint32_t kMagic = 0x53445747; // "GWDS"
+inline constexpr uint32_t kLayoutVersion = 1;
+inline constexpr std::size_t kBitmapWords = 65536 / 64;
+
+/**
+ * ************************************************************************
+ * @brief 共享内存布局, 所有字段均为无锁原子量, 跨进程访问不构成数据竞争;
+ *        seq 为奇数时写者正在更新, 读者读到前后相同的偶数 seq 才算一致
+ * ************************************************************************
+ */
+struct Layout {
+    uint32_t magic;
+    uint32_t layout_version;
+    std::atomic<uint64_t> seq;
+    std::atomic<uint64_t> version;      // 快照版本, 与 /machine-list 的 version 相同
+    std::atomic<uint64_t> published_ms; // 快照发布时间, Unix 毫秒
+    std::atomic<uint32_t> count;        // 在线端口数
+    std::atomic<uint64_t> bitmap[kBitmapWords];
+    std::atomic<uint64_t> scanned_ms; // 最近一次扫描完成时间, 不受 seqlock 保护, 用于判断写者是否存活
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+              "共享内存中的原子量须为无锁实现");
+
+// 读者得到的一致副本
+struct Snapshot {
+    uint64_t version = 0;
+    uint64_t published_ms = 0;
+    uint32_t count = 0;
+    std::bitset<65536> ports;
+};
+
+// 命名共享内存段的映射, 仅负责生命周期
+class Segment {
+private:
+    void *addr_ = nullptr;
+    std::string name_;
+    bool owner_ = false;
+#ifdef _WIN32
+    HANDLE mapping_ = nullptr;
+#endif
+
+public:
+    Segment() = default;
+    Segment(const Segment &) = delete;
+    Segment &operator=(const Segment &) = delete;
+
+    ~Segment() {
+#ifdef _WIN32
+        if (addr_) UnmapViewOfFile(addr_);
+        if (mapping_) CloseHandle(mapping_);
+#else
+        if (addr_) munmap(addr_, sizeof(Layout));
+        if (owner_) shm_unlink(name_.c_str());
+#endif
+    }
+
+    /**
+     * ************************************************************************
+     * @brief 打开或创建共享内存段
+     *
+     * @param[in] name  名称, POSIX 下须以 / 开头, Windows 下如 Local\gateway_discovery
+     * @param[in] writable  写者创建并以读写方式映射, 读者只读映射已存在的段
+     *
+     * @return 是否成功
+     * ************************************************************************
+     */
+    bool open(const std::string &name, bool writable) {
+        name_ = name;
+#ifdef _WIN32
+        if (writable) {
+            mapping_ = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof(Layout), name.c_str());
+        } else {
+            mapping_ = OpenFileMappingA(FILE_MAP_READ, FALSE, name.c_str());
+        }
+        if (mapping_ == nullptr) return false;
+        addr_ = MapViewOfFile(mapping_, writable ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ, 0, 0, sizeof(Layout));
+        return addr_ != nullptr;
+#else
+        int fd = writable ? shm_open(name.c_str(), O_CREAT | O_RDWR, 0644) : shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0) return false;
+        owner_ = writable;
+        if (writable && ftruncate(fd, sizeof(Layout)) != 0) {
+            close(fd);
+            return false;
+        }
+        void *addr = mmap(nullptr, sizeof(Layout), writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (addr == MAP_FAILED) return false;
+        addr_ = addr;
+        return true;
+#endif
+    }
+
+    Layout *layout() const {
+        return static_cast<Layout *>(addr_);
+    }
+};
+
+// 写者, 由端口扫描器在发布快照时调用, 只允许一个写者
+class Writer {
+private:
+    Segment segment_;
+    Layout *layout_ = nullptr;
+
+public:
+    bool open(const std::string &name) {
+        if (!segment_.open(name, true)) return false;
+        layout_ = segment_.layout();
+        // 复用上个写者留下的段时, 其若在更新中途崩溃, seq 停在奇数, 内容也不完整:
+        // 清空内容后把 seq 进到偶数, 否则读者一直重试, 之后的 publish 也会让 seq 奇偶颠倒
+        auto seq = layout_->seq.load(std::memory_order_relaxed);
+        if (seq & 1) {
+            for (auto &word : layout_->bitmap) {
+                word.store(0, std::memory_order_relaxed);
+            }
+            layout_->version.store(0, std::memory_order_relaxed);
+            layout_->published_ms.store(0, std::memory_order_relaxed);
+            layout_->count.store(0, std::memory_order_relaxed);
+            layout_->seq.store(seq + 1, std::memory_order_release);
+        }
+        // 新建的段全为 0, 先写入内容再写 magic, 读者据 magic 判断段已就绪
+        layout_->layout_version = kLayoutVersion;
+        std::atomic_ref<uint32_t>(layout_->magic).store(kMagic, std::memory_order_release);
+        return true;
+    }
+
+    template <typename Ports>
+    void publish(uint64_t version, const Ports &ports) {
+        auto seq = layout_->seq.load(std::memory_order_relaxed);
+        layout_->seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        uint64_t words[kBitmapWords]{};
+        for (auto port : ports) {
+            words[port >> 6] |= uint64_t{1} << (port & 63);
+        }
+        for (std::size_t i = 0; i < kBitmapWords; ++i) {
+            layout_->bitmap[i].store(words[i], std::memory_order_relaxed);
+        }
+        layout_->version.store(version, std::memory_order_relaxed);
+        layout_->published_ms.store(now_ms(), std::memory_order_relaxed);
+        layout_->count.store(static_cast<uint32_t>(ports.size()), std::memory_order_relaxed);
+
+        layout_->seq.store(seq + 2, std::memory_order_release);
+    }
+
+    // 每轮扫描后调用, 服务集合不变时同样更新
+    void touch() {
+        layout_->scanned_ms.store(now_ms(), std::memory_order_relaxed);
+    }
+
+    static uint64_t now_ms() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+};
+
+// 读者, 仅包含本头文件即可使用
+class Reader {
+private:
+    Segment segment_;
+    const Layout *layout_ = nullptr;
+
+public:
+    // 段不存在(扫描器未启动或未开启共享内存)或布局版本不符时返回 false
+    bool open(const std::string &name) {
+        if (!segment_.open(name, false)) return false;
+        auto *layout = segment_.layout();
+        if (std::atomic_ref<uint32_t>(layout->magic).load(std::memory_order_acquire) != kMagic || layout->layout_version != kLayoutVersion) {
+            return false;
+        }
+        layout_ = layout;
+        return true;
+    }
+
+    // 当前版本, 可用于廉价地判断是否需要 read
+    uint64_t version() const {
+        return layout_->version.load(std::memory_order_acquire);
+    }
+
+    // 最近一次扫描时间, 长时间不变说明扫描器已退出; 扫描器重启后会新建段, 读者应重新 open
+    uint64_t scanned_ms() const {
+        return layout_->scanned_ms.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * ************************************************************************
+     * @brief 读取一致的快照, 写者正在更新时重试
+     *
+     * @param[out] out  快照副本
+     * @param[in] max_retries  最大重试次数, 写者每次更新只需数微秒
+     *
+     * @return 是否读到一致的快照
+     * ************************************************************************
+     */
+    bool read(Snapshot &out, int max_retries = 1000) const {
+        for (int i = 0; i < max_retries; ++i) {
+            auto begin = layout_->seq.load(std::memory_order_acquire);
+            if (begin & 1) {
+                std::this_thread::yield();
+                continue;
+            }
+            out.ports.reset();
+            out.version = layout_->version.load(std::memory_order_relaxed);
+            out.published_ms = layout_->published_ms.load(std::memory_order_relaxed);
+            out.count = layout_->count.load(std::memory_order_relaxed);
+            for (std::size_t w = 0; w < kBitmapWords; ++w) {
+                auto word = layout_->bitmap[w].load(std::memory_order_relaxed);
+                for (; word; word &= word - 1) {
+                    out.ports.set(w * 64 + std::countr_zero(word));
+                }
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (layout_->seq.load(std::memory_order_relaxed) == begin) return true;
+        }
+        return false;
+    }
+
+    // 单个端口是否在线, 不做一致性检查
+    bool contains(uint16_t port) const {
+        return (layout_->bitmap[port >> 6].load(std::memory_order_relaxed) >> (port & 63)) & 1;
+    }
+};
+} // namespace xiunneg::shm
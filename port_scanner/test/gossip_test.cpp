@@ -0,0 +1,155 @@
+// port_scanner gossip_test.cpp
+// 在回环地址上启动 3 个节点, 验证服务条目的扩散、下线判定与节点失效
+#include "../gossip.h"
+
+#include <iostream>
+
+#ifdef WIN32
+#include <Windows.h>
+class CHCP {
+public:
+    CHCP() {
+        SetConsoleOutputCP(65001);
+    }
+} chcp;
+#endif // WIN32
+
+using xiunneg::GossipNode;
+using Endpoint = xiunneg::PortScanner::RemoteEndpoint;
+using View = std::map<uint16_t, Endpoint>;
+
+struct Observed {
+    std::mutex mtx;
+    View view;
+    std::vector<std::pair<uint16_t, bool>> verdicts;
+};
+
+// 在 timeout 内等待条件成立
+template <typename Pred>
+bool wait_for(Pred pred, std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (pred()) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return pred();
+}
+
+int main() {
+    xiunneg::WSADATARAII wsa_data_raii;
+
+    auto make_config = [](uint16_t port, std::string secret = "cluster-secret") {
+        return GossipNode::Config{
+            .bind_host = "127.0.0.1",
+            .port = port,
+            .advertise_host = "127.0.0.1",
+            .seeds = {"127.0.0.1:17946"},
+            .secret = std::move(secret),
+            .period_ms = 50,
+            .ping_timeout_ms = 20,
+            .suspect_timeout_ms = 500,
+            .sync_periods = 5,
+        };
+    };
+
+    std::vector<std::unique_ptr<GossipNode>> nodes;
+    std::vector<std::unique_ptr<Observed>> observed;
+    for (uint16_t port : {17946, 17947, 17948}) {
+        auto &node = nodes.emplace_back(std::make_unique<GossipNode>(make_config(port)));
+        auto *state = observed.emplace_back(std::make_unique<Observed>()).get();
+        node->set_view_listener([state](const View &view) {
+            std::lock_guard<std::mutex> lock(state->mtx);
+            state->view = view;
+        });
+        node->set_verdict_listener([state](uint16_t key, const Endpoint &, bool alive) {
+            std::lock_guard<std::mutex> lock(state->mtx);
+            state->verdicts.emplace_back(key, alive);
+        });
+        if (!node->start()) {
+            std::cerr << "节点启动失败 " << port << std::endl;
+            return -1;
+        }
+    }
+
+    auto view_of = [&observed](std::size_t i) {
+        std::lock_guard<std::mutex> lock(observed[i]->mtx);
+        return observed[i]->view;
+    };
+
+    int failures = 0;
+    auto check = [&failures](bool ok, const char *name) {
+        std::cout << (ok ? "[ OK ] " : "[FAIL] ") << name << std::endl;
+        if (!ok) ++failures;
+    };
+
+    // 成员全部互相发现
+    check(wait_for([&nodes]() {
+        for (auto &node : nodes) {
+            auto members = node->members();
+            if (members.size() != 3) return false;
+            for (const auto &member : members) {
+                if (member.state != GossipNode::State::ALIVE) return false;
+            }
+        }
+        return true;
+    }, std::chrono::seconds(3)), "成员互相发现");
+
+    // 节点 0 发现的服务扩散到其余节点
+    nodes[0]->publish_local({{5601, {"127.0.0.1", 5601}}, {5602, {"127.0.0.1", 5602}}});
+    nodes[1]->publish_local({{5611, {"127.0.0.1", 5611}}});
+    View expected0{{5611, {"127.0.0.1", 5611}}};
+    View expected{{5601, {"127.0.0.1", 5601}}, {5602, {"127.0.0.1", 5602}}};
+    check(wait_for([&]() {
+        auto view2 = view_of(2);
+        return view_of(1) == expected && view2.size() == 3 && view2.contains(5611) && view_of(0) == expected0;
+    }, std::chrono::seconds(2)), "服务条目扩散");
+
+    // 下线判定扩散, 并以判定回调通知
+    nodes[0]->publish_local({{5601, {"127.0.0.1", 5601}}});
+    check(wait_for([&]() {
+        if (view_of(2).contains(5602)) return false;
+        std::lock_guard<std::mutex> lock(observed[2]->mtx);
+        return std::find(observed[2]->verdicts.begin(), observed[2]->verdicts.end(), std::pair<uint16_t, bool>{5602, false}) != observed[2]->verdicts.end();
+    }, std::chrono::seconds(2)), "下线判定扩散");
+
+    // 节点 1 停止后被判定失效, 其服务从其他节点的视图中移除
+    nodes[1]->stop();
+    check(wait_for([&]() {
+        for (std::size_t i : {0, 2}) {
+            for (const auto &member : nodes[i]->members()) {
+                if (member.id == nodes[1]->id() && member.state != GossipNode::State::DEAD) return false;
+            }
+            if (view_of(i).contains(5611)) return false;
+        }
+        return true;
+    }, std::chrono::seconds(3)), "节点失效");
+
+    // 节点 1 以新的 incarnation 重启后重新加入并恢复其服务
+    nodes[1] = std::make_unique<GossipNode>(make_config(17947));
+    nodes[1]->publish_local({{5611, {"127.0.0.1", 5611}}});
+    nodes[1]->start();
+    check(wait_for([&]() {
+        return view_of(0).contains(5611) && view_of(2).contains(5611);
+    }, std::chrono::seconds(3)), "节点重新加入");
+
+    // 密钥不同的节点发出的报文被丢弃, 无法加入集群
+    GossipNode intruder(make_config(17949, "wrong-secret"));
+    intruder.start();
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    check([&]() {
+        if (intruder.members().size() != 1) return false;
+        for (std::size_t i : {0, 1, 2}) {
+            for (const auto &member : nodes[i]->members()) {
+                if (member.id == intruder.id()) return false;
+            }
+        }
+        return true;
+    }(), "拒绝密钥不同的节点");
+    intruder.stop();
+
+    for (auto &node : nodes) {
+        node->stop();
+    }
+    std::cout << (failures == 0 ? "全部通过" : "存在失败") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -17,16 +17,40 @@ int main() {
     xiunneg::WSADATARAII wsa_data_raii;
 
     xiunneg::PortScanner::Config config{
-        .begin = 5600,
-        .end = 5620,
-        .scan_interval = 5, // 5s
+        .ranges = {{5600, 5620}},
+        .remote_targets = {},
+        .min_scan_interval_ms = 100,  // 100ms
+        .max_scan_interval_ms = 5000, // 5s
+        .unix_socket_dir = {},
+        .unix_sockets = {},
+#ifdef WIN32
+        .shm_name = "Local\\gateway_discovery_test",
+#else
+        .shm_name = "/gateway_discovery_test",
+#endif
+        .snapshot_path = {},
     };
 
     xiunneg::PortScanner port_scanner(config);
 
     port_scanner.run();
 
-    std::this_thread::sleep_for(std::chrono::seconds(60));
+    // 以共享内存读者观察快照, 与扫描器日志对照
+    xiunneg::shm::Reader reader;
+    if (!reader.open(config.shm_name)) {
+        std::cerr << "打开共享内存失败" << std::endl;
+        return -1;
+    }
+    xiunneg::shm::Snapshot snapshot;
+    for (int i = 0; i < 60; ++i) {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        if (!reader.read(snapshot)) continue;
+        std::cout << "shm version " << snapshot.version << " count " << snapshot.count << " ports";
+        for (uint32_t port = 5600; port <= 5620; ++port) {
+            if (snapshot.ports.test(port)) std::cout << " " << port;
+        }
+        std::cout << std::endl;
+    }
 
     port_scanner.stop();
 
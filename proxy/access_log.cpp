@@ -0,0 +1,303 @@
+// access_log.cpp
+#include "access_log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <format>
+#include <iterator>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+using namespace xiunneg;
+
+namespace {
+std::atomic<uint64_t> g_next_instance{1};
+
+// 每秒只格式化一次日期部分, 同一秒内的记录只追加毫秒
+struct TimeCache {
+    std::time_t second = -1;
+    std::string iso;      // 2025-01-02T03:04:05
+    std::string combined; // 02/Jan/2025:03:04:05 +0000
+};
+thread_local TimeCache t_time_cache;
+
+const TimeCache &cached_time(std::chrono::system_clock::time_point now) {
+    auto second = std::chrono::system_clock::to_time_t(now);
+    auto &cache = t_time_cache;
+    if (cache.second != second) {
+        std::tm tm_snapshot;
+#if defined(_MSC_VER)
+        gmtime_s(&tm_snapshot, &second);
+#else
+        gmtime_r(&second, &tm_snapshot);
+#endif
+        char buffer[64];
+        std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", &tm_snapshot);
+        cache.iso = buffer;
+        std::strftime(buffer, sizeof(buffer), "%d/%b/%Y:%H:%M:%S +0000", &tm_snapshot);
+        cache.combined = buffer;
+        cache.second = second;
+    }
+    return cache;
+}
+
+// JSON 字符串转义, 目标路径与请求头来自客户端
+void append_json_string(std::string &out, std::string_view text) {
+    out += '"';
+    for (unsigned char c : text) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (c < 0x20) {
+                std::format_to(std::back_inserter(out), "\\u{:04x}", c);
+            } else {
+                out += static_cast<char>(c);
+            }
+        }
+    }
+    out += '"';
+}
+
+// combined 格式中的引号字段, 空值写为 -
+void append_quoted(std::string &out, std::string_view text) {
+    out += '"';
+    if (text.empty()) {
+        out += '-';
+    } else {
+        for (unsigned char c : text) {
+            if (c == '"' || c == '\\') out += '\\';
+            out += c < 0x20 ? '?' : static_cast<char>(c);
+        }
+    }
+    out += '"';
+}
+} // namespace
+
+bool AccessLog::parse_format(std::string_view name, Format &format) {
+    if (name == "json") {
+        format = Format::JSON;
+        return true;
+    }
+    if (name == "combined") {
+        format = Format::COMBINED;
+        return true;
+    }
+    return false;
+}
+
+AccessLog::AccessLog(const Config &config) :
+    config_(config),
+    instance_(g_next_instance.fetch_add(1, std::memory_order_relaxed)) {
+    config_.buffer_bytes = std::max<std::size_t>(config_.buffer_bytes, 4096);
+    config_.flush_interval_ms = std::max<uint32_t>(config_.flush_interval_ms, 10);
+}
+
+AccessLog::~AccessLog() {
+    close();
+}
+
+bool AccessLog::open() {
+#ifdef _WIN32
+    fd_ = _open(config_.path.c_str(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+    fd_ = ::open(config_.path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+#endif
+    if (fd_ < 0) return false;
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    running_ = true;
+    flusher_ = std::thread([this]() {
+        run();
+    });
+    return true;
+}
+
+void AccessLog::close() {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (!running_) return;
+        running_ = false;
+    }
+    cv_.notify_one();
+    if (flusher_.joinable())
+        flusher_.join();
+#ifdef _WIN32
+    _close(fd_);
+#else
+    ::close(fd_);
+#endif
+    fd_ = -1;
+}
+
+AccessLog::Buffer &AccessLog::local_buffer() {
+    // 线程通常只写同一个访问日志, 缓存最近一次使用的缓冲区
+    struct Cached {
+        uint64_t instance = 0;
+        std::shared_ptr<Buffer> buffer;
+    };
+    thread_local Cached cached;
+    if (cached.instance != instance_) {
+        auto buffer = std::make_shared<Buffer>();
+        buffer->data.reserve(config_.buffer_bytes);
+        {
+            std::lock_guard<std::mutex> lock(mtx_);
+            buffers_.push_back(buffer);
+        }
+        cached = Cached{instance_, std::move(buffer)};
+    }
+    return *cached.buffer;
+}
+
+void AccessLog::record(const Entry &entry) {
+    auto &buffer = local_buffer();
+    std::string full;
+    {
+        std::lock_guard<std::mutex> lock(buffer.mtx);
+        if (config_.format == Format::JSON) {
+            format_json(entry, buffer.data);
+        } else {
+            format_combined(entry, buffer.data);
+        }
+        if (buffer.data.size() < config_.buffer_bytes) return;
+        full.reserve(config_.buffer_bytes);
+        full.swap(buffer.data);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        ready_.push_back(std::move(full));
+    }
+    cv_.notify_one();
+}
+
+void AccessLog::format_json(const Entry &entry, std::string &out) const {
+    auto now = std::chrono::system_clock::now();
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count() % 1000;
+    auto &time = cached_time(now);
+
+    auto it = std::back_inserter(out);
+    std::format_to(it, R"({{"time":"{}.{:03}Z","remote":"{}:{}","method":)", time.iso, ms, entry.remote_addr, entry.remote_port);
+    append_json_string(out, entry.method);
+    out += R"(,"target":)";
+    append_json_string(out, entry.target);
+    std::format_to(it, R"(,"machine_no":{},"upstream_port":{},"status":{},"upstream_status":{},"bytes_in":{},"bytes_out":{},)",
+                   entry.machine_no, entry.upstream_port, entry.status, entry.upstream_status, entry.bytes_in, entry.bytes_out);
+    std::format_to(it, R"("queue_us":{},"connect_us":{},"ttfb_us":{},"total_us":{})",
+                   entry.queue_us, entry.connect_us, entry.ttfb_us, entry.total_us);
+    if (!entry.error.empty()) {
+        out += R"(,"error":)";
+        append_json_string(out, entry.error);
+    }
+    out += "}\n";
+}
+
+void AccessLog::format_combined(const Entry &entry, std::string &out) const {
+    auto &time = cached_time(std::chrono::system_clock::now());
+
+    auto it = std::back_inserter(out);
+    std::format_to(it, "{} - - [{}] \"", entry.remote_addr, time.combined);
+    for (auto part : {entry.method, std::string_view(" "), entry.target, std::string_view(" "), entry.version}) {
+        for (unsigned char c : part) {
+            if (c == '"' || c == '\\') out += '\\';
+            out += c < 0x20 ? '?' : static_cast<char>(c);
+        }
+    }
+    std::format_to(it, "\" {} {} ", entry.status, entry.bytes_out);
+    append_quoted(out, entry.referer);
+    out += ' ';
+    append_quoted(out, entry.user_agent);
+    std::format_to(it, " machine_no={} upstream_port={} upstream_status={} bytes_in={} queue_us={} connect_us={} ttfb_us={} total_us={}\n",
+                   entry.machine_no, entry.upstream_port, entry.upstream_status, entry.bytes_in,
+                   entry.queue_us, entry.connect_us, entry.ttfb_us, entry.total_us);
+}
+
+void AccessLog::run() {
+    const auto interval = std::chrono::milliseconds(config_.flush_interval_ms);
+    auto next_sweep = std::chrono::steady_clock::now() + interval;
+    std::unique_lock<std::mutex> lock(mtx_);
+    for (;;) {
+        cv_.wait_until(lock, next_sweep, [this]() {
+            return !running_ || !ready_.empty();
+        });
+        bool stopping = !running_;
+        auto chunks = std::move(ready_);
+        ready_.clear();
+
+        // 到期或退出时连同未写满的线程缓冲区一起写出, 请求稀少的线程也不会滞留超过 flush_interval_ms
+        auto now = std::chrono::steady_clock::now();
+        if (now >= next_sweep || stopping) {
+            next_sweep = now + interval;
+            for (const auto &buffer : buffers_) {
+                std::lock_guard<std::mutex> buffer_lock(buffer->mtx);
+                if (buffer->data.empty()) continue;
+                chunks.push_back(std::move(buffer->data));
+                buffer->data = std::string();
+                buffer->data.reserve(config_.buffer_bytes);
+            }
+        }
+
+        lock.unlock();
+        write_batch(chunks);
+        lock.lock();
+        if (stopping && ready_.empty()) return;
+    }
+}
+
+void AccessLog::write_batch(std::vector<std::string> &chunks) {
+#ifdef _WIN32
+    // Windows 没有 writev, 合并后一次写出
+    std::string merged;
+    for (const auto &chunk : chunks) {
+        merged += chunk;
+    }
+    std::size_t written = 0;
+    while (written < merged.size()) {
+        int n = _write(fd_, merged.data() + written, static_cast<unsigned int>(merged.size() - written));
+        if (n <= 0) {
+            dropped_.fetch_add(merged.size() - written, std::memory_order_relaxed);
+            return;
+        }
+        written += static_cast<std::size_t>(n);
+    }
+#else
+    std::vector<iovec> iov;
+    for (auto &chunk : chunks) {
+        if (!chunk.empty()) iov.push_back(iovec{chunk.data(), chunk.size()});
+    }
+    // 一次最多 IOV_MAX 段, 部分写入时从断点继续
+    std::size_t first = 0;
+    while (first < iov.size()) {
+        auto count = std::min<std::size_t>(iov.size() - first, IOV_MAX);
+        auto n = ::writev(fd_, iov.data() + first, static_cast<int>(count));
+        if (n < 0) {
+            for (auto i = first; i < iov.size(); ++i) {
+                dropped_.fetch_add(iov[i].iov_len, std::memory_order_relaxed);
+            }
+            return;
+        }
+        auto remaining = static_cast<std::size_t>(n);
+        while (first < iov.size() && remaining >= iov[first].iov_len) {
+            remaining -= iov[first].iov_len;
+            ++first;
+        }
+        if (remaining > 0) {
+            iov[first].iov_base = static_cast<char *>(iov[first].iov_base) + remaining;
+            iov[first].iov_len -= remaining;
+        }
+    }
+#endif
+}
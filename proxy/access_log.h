@@ -0,0 +1,117 @@
+// access_log.h
+#pragma once
+
+/**
+ * ************************************************************************
+ *
+ * @file access_log.h
+ * @author xiunneg
+ * @brief  访问日志,每个转发请求一行,记录状态、字节数与各阶段耗时;
+ *         调用线程只格式化到本线程的缓冲区, 由后台线程批量以 writev 写出,
+ *         请求路径上没有系统调用与跨线程竞争
+ * ************************************************************************
+ * @copyright Copyright (c) 2025 xiunneg
+ * ************************************************************************
+ */
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace xiunneg {
+
+class AccessLog {
+public:
+    enum class Format {
+        JSON,    // 每行一个 JSON 对象
+        COMBINED // Apache/Nginx combined 格式, 末尾追加 key=value 扩展字段
+    };
+
+    struct Config {
+        std::string path = "access.log";
+        Format format = Format::JSON;
+        std::size_t buffer_bytes = 64 * 1024; // 线程缓冲区达到该大小即交给后台线程
+        uint32_t flush_interval_ms = 1000;    // 未写满的缓冲区最长滞留时间
+    };
+
+    // 一条访问记录, 字符串只在 record 期间引用
+    struct Entry {
+        std::string_view remote_addr;
+        int remote_port = 0;
+        std::string_view method;
+        std::string_view target;
+        std::string_view version;
+        std::string_view referer;
+        std::string_view user_agent;
+        int machine_no = -1;        // 请求未带有效 machine_no 时为 -1
+        uint16_t upstream_port = 0; // 未转发时为 0
+        int status = 0;             // 返回给客户端的状态码
+        int upstream_status = 0;    // 上游响应状态码, 未收到响应时为 0
+        uint64_t bytes_in = 0;      // 客户端请求字节数, 含请求行与请求头
+        uint64_t bytes_out = 0;     // 返回给客户端的响应体字节数
+        int64_t queue_us = -1;      // 各阶段耗时, 微秒, -1 为无法测量
+        int64_t connect_us = -1;
+        int64_t ttfb_us = -1;
+        int64_t total_us = -1;
+        std::string_view error;     // 转发失败原因
+    };
+
+private:
+    // 线程缓冲区, 所属线程追加、后台线程取走, 锁几乎不发生竞争
+    struct Buffer {
+        std::mutex mtx;
+        std::string data;
+    };
+
+    Config config_;
+    uint64_t instance_; // 区分先后创建的实例, 线程局部缓存以此判断缓冲区归属
+
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::vector<std::shared_ptr<Buffer>> buffers_; // 全部线程缓冲区
+    std::vector<std::string> ready_;               // 已写满、待写出的缓冲区
+    bool running_ = false;
+    std::thread flusher_;
+
+    int fd_ = -1;
+    std::atomic<uint64_t> dropped_{0}; // 写文件失败丢弃的字节数
+
+public:
+    explicit AccessLog(const Config &config);
+    ~AccessLog();
+
+    AccessLog(const AccessLog &) = delete;
+    AccessLog &operator=(const AccessLog &) = delete;
+
+    // 打开日志文件并启动后台写线程, 失败返回 false
+    bool open();
+    // 写出全部缓冲区并停止后台线程
+    void close();
+
+    // 格式化到当前线程的缓冲区, 写满时交给后台线程
+    void record(const Entry &entry);
+
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    static bool parse_format(std::string_view name, Format &format);
+
+private:
+    Buffer &local_buffer();
+    void format_json(const Entry &entry, std::string &out) const;
+    void format_combined(const Entry &entry, std::string &out) const;
+
+    void run();
+    void write_batch(std::vector<std::string> &chunks);
+};
+
+// 供 module::from_json 把配置中的 json/combined 反序列化为 AccessLog::Format
+inline bool parse_enum(std::string_view name, AccessLog::Format &format) {
+    return AccessLog::parse_format(name, format);
+}
+} // namespace xiunneg
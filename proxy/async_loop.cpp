@@ -0,0 +1,438 @@
+// async_loop.cpp
+#include "async_loop.h"
+#include "http_codec.h"
+
+#include <optional>
+
+#ifdef __linux__
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#endif
+
+using namespace xiunneg;
+
+namespace {
+// 与 httplib 路径相同的限制, Keep-Alive 响应头按此声明, 见 http::serialize_response
+constexpr std::chrono::seconds kKeepAliveTimeout{CPPHTTPLIB_KEEPALIVE_TIMEOUT_SECOND};
+constexpr std::size_t kKeepAliveMaxCount = CPPHTTPLIB_KEEPALIVE_MAX_COUNT;
+constexpr std::chrono::seconds kReadTimeout{CPPHTTPLIB_SERVER_READ_TIMEOUT_SECOND};
+constexpr std::chrono::seconds kWriteTimeout{CPPHTTPLIB_SERVER_WRITE_TIMEOUT_SECOND};
+constexpr std::chrono::seconds kUpstreamConnectTimeout{CPPHTTPLIB_CONNECTION_TIMEOUT_SECOND};
+constexpr std::chrono::seconds kUpstreamReadTimeout{CPPHTTPLIB_CLIENT_READ_TIMEOUT_SECOND};
+constexpr std::chrono::seconds kUpstreamWriteTimeout{CPPHTTPLIB_CLIENT_WRITE_TIMEOUT_SECOND};
+} // namespace
+
+struct AsyncLoop::Connection {
+    EventLoop *loop;
+    int fd;
+    std::string remote_addr;
+    int remote_port = 0;
+    std::string local_addr;
+    int local_port = 0;
+
+    std::string inbox; // 已收到未处理的数据
+    httplib::Request req;
+    httplib::Response res;
+    bool keep_alive = true;
+    const AsyncLoop::AsyncHandler *async_handler = nullptr; // 命中的协程路由
+    std::chrono::steady_clock::time_point received;          // 当前请求解析完成的时间
+    std::size_t requests = 0;                                // 已处理的请求数, 达到上限后关闭连接
+    EventLoop::Deadline deadline;                            // 读取请求与写出响应的截止时间
+
+    Connection(EventLoop *owner, int client_fd) :
+        loop(owner),
+        fd(client_fd),
+        deadline(owner, client_fd) {
+    }
+
+    ~Connection() {
+        deadline.cancel();
+        loop->close_fd(fd);
+    }
+};
+
+AsyncContext::AsyncContext(EventLoop &loop, int fd, EventLoop::Deadline &deadline, const httplib::Request &request, httplib::Response &response) :
+    loop_(loop),
+    fd_(fd),
+    deadline_(deadline),
+    req(request),
+    res(response) {
+}
+
+EventLoop::NotifyAwaitable AsyncContext::wait(std::chrono::milliseconds timeout) {
+    return loop_.wait_notify(timeout);
+}
+
+coro::Task<bool> AsyncContext::begin_stream() {
+    streaming_ = true;
+    co_return co_await write(http::serialize_stream_head(res));
+}
+
+coro::Task<bool> AsyncContext::write(std::string data) {
+    // 只在写出期间计时, 两次推送之间的等待不受限
+    bool ok = co_await loop_.send_all(fd_, data, -1, &deadline_, kWriteTimeout);
+    deadline_.cancel();
+    co_return ok;
+}
+
+bool AsyncContext::streaming() const {
+    return streaming_;
+}
+
+AsyncLoop::AsyncLoop(const IoEngine::Config &config) :
+    loop_(config) {
+}
+
+AsyncLoop::~AsyncLoop() {
+    loop_.stop();
+    // 销毁挂起中的协程帧, 连接随之关闭
+    loop_.clear_sessions();
+    for (auto &[port, idle] : idle_upstreams_) {
+        for (const auto &upstream : idle) loop_.close_fd(upstream.fd);
+    }
+    idle_upstreams_.clear();
+    if (listen_fd_ >= 0) loop_.close_fd(listen_fd_);
+}
+
+IoEngine::Kind AsyncLoop::engine_kind() const {
+    return loop_.engine().kind();
+}
+
+bool AsyncLoop::buffers_registered() const {
+    return loop_.engine().buffers().registered();
+}
+
+AsyncLoop &AsyncLoop::Get(const std::string &pattern, Handler handler) {
+    handlers_.emplace_back(std::regex(pattern), std::move(handler));
+    return *this;
+}
+
+AsyncLoop &AsyncLoop::GetAsync(const std::string &pattern, AsyncHandler handler) {
+    async_handlers_.emplace_back(std::regex(pattern), std::move(handler));
+    return *this;
+}
+
+AsyncLoop &AsyncLoop::Post(const std::string &pattern, Handler handler) {
+    post_handlers_.emplace_back(std::regex(pattern), std::move(handler));
+    return *this;
+}
+
+AsyncLoop &AsyncLoop::set_forward_hooks(ForwardHooks hooks) {
+    forward_ = std::move(hooks);
+    return *this;
+}
+
+void AsyncLoop::retain_upstreams(const std::set<uint16_t> &ports) {
+    std::erase_if(idle_upstreams_, [this, &ports](auto &item) {
+        if (ports.contains(item.first)) return false;
+        for (const auto &upstream : item.second) loop_.close_fd(upstream.fd);
+        return true;
+    });
+}
+
+bool AsyncLoop::bind(const std::string &host, uint16_t port) {
+    listen_fd_ = loop_.listen(host, port);
+    return listen_fd_ >= 0;
+}
+
+void AsyncLoop::notify() {
+    loop_.notify_all();
+}
+
+void AsyncLoop::post(std::function<void()> task) {
+    loop_.post(std::move(task));
+}
+
+void AsyncLoop::run() {
+    loop_.spawn(accept_loop());
+    loop_.run();
+}
+
+void AsyncLoop::stop() {
+    loop_.stop();
+}
+
+coro::Task<> AsyncLoop::accept_loop() {
+    // 随事件循环停止而销毁
+    for (;;) {
+        int fd = co_await coro::async_accept(loop_.engine(), listen_fd_);
+        if (fd < 0) continue;
+
+#ifdef __linux__
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+#endif
+        loop_.spawn(serve(fd));
+    }
+}
+
+coro::Task<> AsyncLoop::serve(int fd) {
+    Connection conn(&loop_, fd);
+    httplib::detail::get_remote_ip_and_port(fd, conn.remote_addr, conn.remote_port);
+    httplib::detail::get_local_ip_and_port(fd, conn.local_addr, conn.local_port);
+
+    // 不保持连接或出错时退出, 连接随协程帧关闭
+    while (co_await read_request(conn)) {
+        auto route = conn.res.status == -1 ? dispatch(conn) : Route{};
+        if (conn.async_handler) {
+            if (!co_await run_async(conn, *conn.async_handler)) co_return;
+        } else if (route.ok) {
+            auto queue_us = elapsed_us(conn.received, std::chrono::steady_clock::now());
+            auto result = co_await forward(conn.req, route);
+            result.received = conn.received;
+            result.queue_us = queue_us;
+            if (forward_.complete) {
+                forward_.complete(conn.req, conn.res, std::move(result));
+            }
+        }
+
+        if (++conn.requests >= kKeepAliveMaxCount) {
+            conn.keep_alive = false;
+        }
+        auto data = http::serialize_response(conn.req, conn.res, conn.keep_alive);
+        if (!co_await loop_.send_all(conn.fd, data, -1, &conn.deadline, kWriteTimeout) || !conn.keep_alive) {
+            co_return;
+        }
+    }
+}
+
+coro::Task<bool> AsyncLoop::read_request(Connection &conn) {
+    // 空闲连接按 keep-alive 超时等待下一个请求; 收到首个字节后整个请求须在读超时内收完,
+    // 慢速逐字节发送不会续期
+    bool started = !conn.inbox.empty();
+    conn.deadline.arm(started ? kReadTimeout : kKeepAliveTimeout);
+    for (;;) {
+        conn.req = httplib::Request{};
+        conn.res = httplib::Response{};
+        conn.async_handler = nullptr;
+
+        if (!conn.inbox.empty()) {
+            std::size_t consumed{};
+            auto status = http::parse_request_head(conn.inbox, conn.req, consumed);
+            if (status == http::ParseStatus::ERROR || conn.req.has_header("Transfer-Encoding")) {
+                conn.deadline.cancel();
+                conn.res.status = httplib::StatusCode::BadRequest_400;
+                conn.keep_alive = false;
+                co_return true;
+            }
+
+            auto length = conn.req.get_header_value_u64("Content-Length");
+            if (status == http::ParseStatus::COMPLETE && conn.inbox.size() >= consumed + length) {
+                conn.deadline.cancel();
+                conn.req.body = conn.inbox.substr(consumed, length);
+                conn.inbox.erase(0, consumed + length);
+                conn.received = std::chrono::steady_clock::now();
+                co_return true;
+            }
+        }
+
+        // 数据不足, 继续接收后重新解析; 超时时套接字已被关闭读写, 接收以 EOF 结束
+        auto &engine = loop_.engine();
+        auto buffer = engine.buffers().acquire();
+        int n = co_await coro::async_recv(engine, conn.fd, buffer);
+        if (n > 0) conn.inbox.append(buffer.data, static_cast<std::size_t>(n));
+        engine.buffers().release(buffer);
+        if (n <= 0) co_return false;
+        if (!started) {
+            started = true;
+            conn.deadline.arm(kReadTimeout);
+        }
+    }
+}
+
+Route AsyncLoop::dispatch(Connection &conn) {
+    auto &req = conn.req;
+    auto &res = conn.res;
+    req.remote_addr = conn.remote_addr;
+    req.remote_port = conn.remote_port;
+    req.set_header("REMOTE_ADDR", req.remote_addr);
+    req.set_header("REMOTE_PORT", std::to_string(req.remote_port));
+    req.local_addr = conn.local_addr;
+    req.local_port = conn.local_port;
+    req.set_header("LOCAL_ADDR", req.local_addr);
+    req.set_header("LOCAL_PORT", std::to_string(req.local_port));
+    conn.keep_alive = http::keep_alive_requested(req);
+
+    bool is_post = req.method == "POST";
+    if (!is_post && req.method != "GET" && req.method != "HEAD") {
+        res.status = httplib::StatusCode::NotFound_404;
+        return {};
+    }
+
+    try {
+        for (const auto &[pattern, handler] : async_handlers_) {
+            if (!is_post && std::regex_match(req.path, req.matches, pattern)) {
+                conn.async_handler = &handler;
+                return {};
+            }
+        }
+        for (const auto &[pattern, handler] : is_post ? post_handlers_ : handlers_) {
+            if (std::regex_match(req.path, req.matches, pattern)) {
+                handler(req, res);
+                return {};
+            }
+        }
+        // 仅 GET 转发
+        if (is_post) {
+            res.status = httplib::StatusCode::NotFound_404;
+            return {};
+        }
+        return forward_.resolve ? forward_.resolve(req, res) : Route{};
+    } catch (const std::exception &e) {
+        res = httplib::Response{};
+        res.status = httplib::StatusCode::InternalServerError_500;
+        res.set_header("EXCEPTION_WHAT", e.what());
+        return {};
+    }
+}
+
+coro::Task<bool> AsyncLoop::run_async(Connection &conn, const AsyncHandler &handler) {
+    AsyncContext ctx(loop_, conn.fd, conn.deadline, conn.req, conn.res);
+    std::string error;
+    try {
+        co_await handler(ctx);
+    } catch (const std::exception &e) {
+        error = e.what();
+    }
+
+    if (ctx.streaming()) co_return false;
+    if (!error.empty()) {
+        conn.res = httplib::Response{};
+        conn.res.status = httplib::StatusCode::InternalServerError_500;
+        conn.res.set_header("EXCEPTION_WHAT", error);
+    }
+    co_return true;
+}
+
+coro::Task<ForwardResult> AsyncLoop::forward(const httplib::Request &req, const Route &route) {
+    ForwardResult result;
+    auto request = http::build_upstream_request(req, true);
+    auto port = route.port;
+    auto host = route.upstream_host();
+    auto upstream_port = route.upstream_port();
+    result.port = port;
+
+    for (;;) {
+        int fd = -1;
+        bool reused = false;
+        auto &idle = idle_upstreams_[port];
+        while (fd < 0 && !idle.empty()) {
+            auto upstream = std::move(idle.back());
+            idle.pop_back();
+            // 服务地址变化(TCP/IPv6/Unix 域套接字/远程)后, 旧连接直接关闭
+            if (upstream.host != host || upstream.port != upstream_port) {
+                loop_.close_fd(upstream.fd);
+                continue;
+            }
+            fd = upstream.fd;
+            reused = true;
+        }
+        auto connect_begin = std::chrono::steady_clock::now();
+        if (fd < 0) {
+            if (route.unix_path.empty()) {
+                fd = co_await loop_.connect_tcp(host, upstream_port, result.error_msg, kUpstreamConnectTimeout);
+            } else {
+                fd = co_await loop_.connect_unix(route.unix_path, result.error_msg);
+            }
+            if (fd < 0) {
+                result.connect_error = -fd;
+                co_return result;
+            }
+        }
+        auto request_begin = std::chrono::steady_clock::now();
+        result.connect_us = reused ? 0 : elapsed_us(connect_begin, request_begin);
+
+        bool keep_alive = false;
+        std::chrono::steady_clock::time_point first_byte{};
+        auto status = co_await exchange(fd, request, result.body, keep_alive, result.error_msg, first_byte, result.upstream_status);
+        if (first_byte != std::chrono::steady_clock::time_point{}) {
+            result.ttfb_us = elapsed_us(request_begin, first_byte);
+        }
+        if (status == UpstreamStatus::OK && keep_alive) {
+            idle_upstreams_[port].push_back({fd, host, upstream_port});
+        } else {
+            loop_.close_fd(fd);
+        }
+
+        // 空闲连接失效时换一条连接重试, 新建的连接不重试
+        if (status == UpstreamStatus::STALE && reused) {
+            continue;
+        }
+        if (status == UpstreamStatus::STALE) {
+            result.error_msg = "上游连接中断";
+        }
+        if (status != UpstreamStatus::OK) {
+            result.body.clear();
+        }
+        result.body_bytes = result.body.size();
+        co_return result;
+    }
+}
+
+coro::Task<AsyncLoop::UpstreamStatus> AsyncLoop::exchange(int fd, const std::string &request, std::string &body, bool &keep_alive, std::string &error_msg,
+                                                          std::chrono::steady_clock::time_point &head_received, int &upstream_status) {
+    // 与 httplib 客户端相同, 每次读写各自计时; 超时的连接不重试
+    EventLoop::Deadline deadline(&loop_, fd);
+    if (!co_await loop_.send_all(fd, request, -1, &deadline, kUpstreamWriteTimeout)) {
+        if (deadline.expired()) {
+            error_msg = "上游读写超时";
+            co_return UpstreamStatus::FAILED;
+        }
+        co_return UpstreamStatus::STALE;
+    }
+
+    auto &engine = loop_.engine();
+    std::string inbox;
+    http::ResponseHead head;
+    std::optional<http::ResponseBodyReader> reader;
+
+    for (;;) {
+        auto buffer = engine.buffers().acquire();
+        deadline.arm(kUpstreamReadTimeout);
+        int n = co_await coro::async_recv(engine, fd, buffer);
+        std::string_view data(buffer.data, n > 0 ? static_cast<std::size_t>(n) : 0);
+
+        auto status = http::ParseStatus::INCOMPLETE;
+        if (n <= 0) {
+            engine.buffers().release(buffer);
+            if (deadline.expired()) {
+                error_msg = "上游读写超时";
+                co_return UpstreamStatus::FAILED;
+            }
+            if (!reader && inbox.empty()) {
+                co_return UpstreamStatus::STALE;
+            }
+            if (reader && reader->finish_on_eof() == http::ParseStatus::COMPLETE) {
+                keep_alive = false;
+                co_return UpstreamStatus::OK;
+            }
+            error_msg = "上游连接中断";
+            co_return UpstreamStatus::FAILED;
+        }
+
+        if (!reader) {
+            inbox.append(data);
+            std::size_t consumed{};
+            status = http::parse_response_head(inbox, head, consumed);
+            if (status == http::ParseStatus::COMPLETE) {
+                head_received = std::chrono::steady_clock::now();
+                upstream_status = head.status;
+                reader.emplace(head);
+                status = reader->feed(std::string_view(inbox).substr(consumed), body);
+            }
+        } else {
+            status = reader->feed(data, body);
+        }
+        engine.buffers().release(buffer);
+
+        if (status == http::ParseStatus::ERROR) {
+            error_msg = "解析上游响应失败";
+            co_return UpstreamStatus::FAILED;
+        }
+        if (status == http::ParseStatus::COMPLETE) {
+            keep_alive = head.keep_alive;
+            co_return UpstreamStatus::OK;
+        }
+    }
+}
@@ -0,0 +1,148 @@
+// async_loop.h
+#pragma once
+
+/**
+ * ************************************************************************
+ *
+ * @file async_loop.h
+ * @author xiunneg
+ * @brief  仅支持 Linux 平台,基于 IoEngine 的单线程事件循环,作为分片的另一种 I/O 路径:
+ *         每个客户端连接由一个协程按 接收 -> 解析 -> 路由 -> 连接上游 -> 转发 的顺序处理,
+ *         等待 I/O 时挂起而不阻塞线程,单个线程即可承载大量慢上游请求;
+ *         客户端与上游的读写超时、keep-alive 空闲超时与请求数上限与 httplib 路径相同;
+ *         本地路由(如 /machine-list)直接复用 httplib 处理函数,
+ *         需要等待的路由(长轮询、SSE)以协程处理函数注册
+ * ************************************************************************
+ * @copyright Copyright (c) 2025 xiunneg
+ * ************************************************************************
+ */
+
+#include "coro.h"
+#include "event_loop.h"
+#include "httplib.h"
+#include "io_engine.h"
+#include "route.h"
+
+#include <stdint.h>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <regex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace xiunneg {
+
+// 协程路由的处理上下文, 仅在处理协程执行期间有效
+class AsyncContext {
+private:
+    EventLoop &loop_;
+    int fd_;
+    EventLoop::Deadline &deadline_; // 连接的截止时间, 写出期间计时
+    bool streaming_ = false;
+
+public:
+    const httplib::Request &req;
+    httplib::Response &res;
+
+    AsyncContext(EventLoop &loop, int fd, EventLoop::Deadline &deadline, const httplib::Request &request, httplib::Response &response);
+
+    // 挂起直到 AsyncLoop::notify 或超时, 被唤醒返回 true
+    EventLoop::NotifyAwaitable wait(std::chrono::milliseconds timeout);
+
+    // 按 res 的状态码与头部写出流式响应头, 处理结束后连接关闭
+    coro::Task<bool> begin_stream();
+    // 写出一段流式响应数据, 对端关闭时返回 false
+    coro::Task<bool> write(std::string data);
+
+    bool streaming() const;
+};
+
+class AsyncLoop {
+public:
+    using Handler = httplib::Server::Handler;
+    // 协程处理函数, 不调用 begin_stream 时按 res 返回普通响应
+    using AsyncHandler = std::function<coro::Task<>(AsyncContext &)>;
+
+    // 转发钩子, 与 httplib 路径共用同一套路由与结果处理
+    struct ForwardHooks {
+        // 解析转发目标, 失败时填充错误响应并返回 ok 为 false 的路由
+        std::function<Route(const httplib::Request &, httplib::Response &)> resolve;
+        // 上游请求结束后填充最终响应
+        std::function<void(const httplib::Request &, httplib::Response &, ForwardResult &&)> complete;
+    };
+
+private:
+    struct Connection;
+
+    enum class UpstreamStatus {
+        OK = 1, // 响应接收完整
+        STALE,  // 空闲连接已被上游关闭, 可换新连接重试
+        FAILED  // 失败
+    };
+
+    EventLoop loop_;
+    int listen_fd_ = -1;
+
+    std::vector<std::pair<std::regex, Handler>> handlers_;
+    std::vector<std::pair<std::regex, Handler>> post_handlers_;
+    std::vector<std::pair<std::regex, AsyncHandler>> async_handlers_;
+    ForwardHooks forward_;
+
+    struct IdleUpstream {
+        int fd;
+        std::string host; // 上游地址或 Unix 域套接字路径, 见 Route::upstream_host
+        uint16_t port;
+    };
+
+    // 上游空闲连接, 仅事件循环线程访问
+    std::unordered_map<uint16_t, std::vector<IdleUpstream>> idle_upstreams_;
+
+public:
+    explicit AsyncLoop(const IoEngine::Config &config);
+    ~AsyncLoop();
+
+    AsyncLoop(const AsyncLoop &) = delete;
+    AsyncLoop &operator=(const AsyncLoop &) = delete;
+
+    IoEngine::Kind engine_kind() const;
+    bool buffers_registered() const;
+
+    // 注册本地 GET 路由, 处理函数在事件循环线程中执行, 不应阻塞
+    AsyncLoop &Get(const std::string &pattern, Handler handler);
+    // 注册需要等待的 GET 路由(长轮询、SSE), 先于普通路由匹配
+    AsyncLoop &GetAsync(const std::string &pattern, AsyncHandler handler);
+    // 注册本地 POST 路由, 请求体须带 Content-Length
+    AsyncLoop &Post(const std::string &pattern, Handler handler);
+    AsyncLoop &set_forward_hooks(ForwardHooks hooks);
+
+    // 清理不在端口集合中的空闲上游连接, 须在事件循环线程中调用
+    void retain_upstreams(const std::set<uint16_t> &ports);
+
+    // 唤醒 AsyncContext::wait 中的处理函数, 须在事件循环线程中调用
+    void notify();
+
+    // 线程安全, 投递任务到事件循环线程执行
+    void post(std::function<void()> task);
+
+    bool bind(const std::string &host, uint16_t port);
+    void run();
+    void stop();
+
+private:
+    coro::Task<> accept_loop();
+    coro::Task<> serve(int fd);
+    // 读取一个完整请求, 连接关闭时返回 false
+    coro::Task<bool> read_request(Connection &conn);
+    // 执行本地路由或解析转发目标, 路由 ok 为 false 表示响应已就绪或需交给协程路由
+    Route dispatch(Connection &conn);
+    // 执行协程路由, 返回 false 表示响应已以流的形式写出
+    coro::Task<bool> run_async(Connection &conn, const AsyncHandler &handler);
+    coro::Task<ForwardResult> forward(const httplib::Request &req, const Route &route);
+    // head_received 与 upstream_status 在收到完整响应头时写入
+    coro::Task<UpstreamStatus> exchange(int fd, const std::string &request, std::string &body, bool &keep_alive, std::string &error_msg,
+                                        std::chrono::steady_clock::time_point &head_received, int &upstream_status);
+};
+} // namespace xiunneg
@@ -0,0 +1,241 @@
+// proxy bench.cpp
+// 相同路由逻辑下对比 httplib 线程池与 IoEngine(epoll / io_uring) 的转发吞吐与延迟,
+// 以及上游改走 Unix 域套接字后的差异, 最后一轮让 Unix 上游的监听队列溢出, 验证新建连接不会失败
+#include "../async_loop.h"
+#include "../route.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <format>
+#include <iostream>
+#include <thread>
+
+#ifdef __linux__
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+namespace {
+constexpr uint16_t kBasePort = 5600;
+constexpr uint16_t kUpstreamPort = 5601; // machine_no=1
+constexpr const char *kUpstreamUnixPath = "/tmp/gateway_bench_5601.sock";
+constexpr const char *kBacklogUnixPath = "/tmp/gateway_bench_backlog.sock";
+constexpr uint16_t kGatewayPort = 11090;
+constexpr int kClients = 8;
+constexpr int kRequestsPerClient = 5000;
+
+xiunneg::PortScanner::Snapshot g_snapshot = []() {
+    xiunneg::PortScanner::Snapshot snapshot;
+    snapshot.version = 1;
+    snapshot.ports = {kUpstreamPort};
+    return snapshot;
+}();
+
+xiunneg::Route resolve(const httplib::Request &req, httplib::Response &res) {
+    auto route = xiunneg::resolve_route(req, kBasePort, g_snapshot);
+    if (!route.ok) {
+        res.status = httplib::StatusCode::BadRequest_400;
+        res.set_content(route.error_msg, "text/plain");
+    }
+    return route;
+}
+
+void complete(httplib::Response &res, xiunneg::ForwardResult &&result) {
+    if (!result.error_msg.empty()) {
+        res.status = httplib::StatusCode::BadGateway_502;
+        res.set_content(result.error_msg, "text/plain");
+        return;
+    }
+    res.set_content(std::move(result.body), "application/json");
+}
+
+// 多个保持连接的客户端并发请求, 输出吞吐与延迟分位
+void run_clients(std::string_view name, int requests_per_client = kRequestsPerClient) {
+    std::vector<std::vector<double>> latencies(kClients);
+    std::atomic<int> failures{0};
+
+    auto begin = std::chrono::steady_clock::now();
+    std::vector<std::thread> clients;
+    for (int i = 0; i < kClients; ++i) {
+        clients.emplace_back([i, requests_per_client, &latencies, &failures]() {
+            httplib::Client client("127.0.0.1", kGatewayPort);
+            client.set_keep_alive(true);
+            client.set_tcp_nodelay(true);
+            latencies[i].reserve(requests_per_client);
+            for (int n = 0; n < requests_per_client; ++n) {
+                auto start = std::chrono::steady_clock::now();
+                auto res = client.Get("/status?machine_no=1");
+                auto end = std::chrono::steady_clock::now();
+                if (!res || res->status != 200) failures.fetch_add(1);
+                latencies[i].push_back(std::chrono::duration<double, std::micro>(end - start).count());
+            }
+        });
+    }
+    for (auto &t : clients) t.join();
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    std::vector<double> all;
+    for (auto &item : latencies) all.insert(all.end(), item.begin(), item.end());
+    std::sort(all.begin(), all.end());
+    auto percentile = [&all](double p) { return all[static_cast<std::size_t>(p * (all.size() - 1))]; };
+
+    std::cout << std::format("{:<10} {:>10.0f} req/s  p50 {:>8.1f}us  p99 {:>8.1f}us  失败 {}\n",
+                             name, all.size() / elapsed, percentile(0.5), percentile(0.99), failures.load());
+}
+
+void bench_httplib() {
+    httplib::Server server;
+    server.set_tcp_nodelay(true);
+    server.Get("/.*", [](const httplib::Request &req, httplib::Response &res) {
+        auto route = resolve(req, res);
+        if (!route.ok) return;
+
+        thread_local std::unique_ptr<httplib::Client> client;
+        if (!client) {
+            client = std::make_unique<httplib::Client>("127.0.0.1", route.port);
+            client->set_keep_alive(true);
+            client->set_tcp_nodelay(true);
+        }
+        xiunneg::ForwardResult result;
+        auto client_resp = client->Get(req.target, req.headers);
+        if (client_resp) {
+            result.body = std::move(client_resp->body);
+        } else {
+            result.error_msg = httplib::to_string(client_resp.error());
+        }
+        complete(res, std::move(result));
+    });
+    server.bind_to_port("127.0.0.1", kGatewayPort);
+    std::thread listener([&server]() { server.listen_after_bind(); });
+    server.wait_until_ready();
+
+    run_clients("httplib");
+    server.stop();
+    listener.join();
+}
+
+void bench_engine(xiunneg::IoEngine::Kind kind, std::string_view name, int requests_per_client = kRequestsPerClient) {
+    xiunneg::AsyncLoop loop({.kind = kind});
+    if (loop.engine_kind() != kind) {
+        std::cout << std::format("{:<10} 不支持, 跳过\n", xiunneg::IoEngine::kind_name(kind));
+        return;
+    }
+    loop.set_forward_hooks({
+        .resolve = resolve,
+        .complete = [](const httplib::Request &, httplib::Response &res, xiunneg::ForwardResult &&result) {
+            complete(res, std::move(result));
+        },
+    });
+    loop.bind("127.0.0.1", kGatewayPort);
+    std::thread listener([&loop]() { loop.run(); });
+
+    run_clients(name, requests_per_client);
+    loop.stop();
+    listener.join();
+}
+
+#ifdef __linux__
+// 监听队列只有 1 个位置、串行应答并关闭连接的 Unix 域上游, 网关每个请求都新建连接,
+// 并发连接数超过队列长度时非阻塞 connect 返回 EAGAIN
+void serve_backlog_upstream(int listen_fd, const std::atomic<bool> &running, const std::string &body) {
+    auto response = std::format("HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: {}\r\n"
+                                "Connection: close\r\n\r\n{}",
+                                body.size(), body);
+    while (running.load()) {
+        pollfd pfd{listen_fd, POLLIN, 0};
+        if (::poll(&pfd, 1, 100) <= 0) continue;
+        int fd = ::accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) continue;
+
+        std::string request;
+        char buffer[4096];
+        while (request.find("\r\n\r\n") == std::string::npos) {
+            auto n = ::read(fd, buffer, sizeof(buffer));
+            if (n <= 0) break;
+            request.append(buffer, static_cast<std::size_t>(n));
+        }
+        std::string_view data = response;
+        while (!data.empty()) {
+            auto n = ::write(fd, data.data(), data.size());
+            if (n <= 0) break;
+            data.remove_prefix(static_cast<std::size_t>(n));
+        }
+        ::close(fd);
+    }
+}
+
+void bench_backlog(const std::string &body) {
+    std::remove(kBacklogUnixPath);
+    int listen_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", kBacklogUnixPath);
+    if (listen_fd < 0 || ::bind(listen_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 || ::listen(listen_fd, 1) != 0) {
+        std::cout << std::format("{:<10} 创建上游失败, 跳过\n", "backlog");
+        if (listen_fd >= 0) ::close(listen_fd);
+        return;
+    }
+    std::atomic<bool> running{true};
+    std::thread upstream([listen_fd, &running, &body]() { serve_backlog_upstream(listen_fd, running, body); });
+
+    g_snapshot.unix_paths[kUpstreamPort] = kBacklogUnixPath;
+    bench_engine(xiunneg::IoEngine::Kind::EPOLL, "epoll+full", kRequestsPerClient / 10);
+    bench_engine(xiunneg::IoEngine::Kind::IO_URING, "uring+full", kRequestsPerClient / 10);
+
+    running.store(false);
+    upstream.join();
+    ::close(listen_fd);
+    std::remove(kBacklogUnixPath);
+}
+#endif
+} // namespace
+
+int main() {
+    // 上游与网关都关闭 Nagle, 避免延迟确认掩盖 I/O 路径本身的差异
+    httplib::Server upstream;
+    upstream.set_tcp_nodelay(true);
+    std::string body(1024, 'x');
+    upstream.Get("/status", [&body](const httplib::Request &, httplib::Response &res) {
+        res.set_content(body, "application/json");
+    });
+    upstream.bind_to_port("127.0.0.1", kUpstreamPort);
+    std::thread upstream_listener([&upstream]() { upstream.listen_after_bind(); });
+    upstream.wait_until_ready();
+
+    std::cout << std::format("{} 个客户端, 每个 {} 次请求, 响应体 {} 字节\n", kClients, kRequestsPerClient, body.size());
+    bench_httplib();
+    if (xiunneg::IoEngine::supported()) {
+        bench_engine(xiunneg::IoEngine::Kind::EPOLL, "epoll");
+        bench_engine(xiunneg::IoEngine::Kind::IO_URING, "io_uring");
+
+        // 同一服务改为监听 Unix 域套接字
+        std::remove(kUpstreamUnixPath);
+        httplib::Server unix_upstream;
+        unix_upstream.set_address_family(AF_UNIX);
+        unix_upstream.Get("/status", [&body](const httplib::Request &, httplib::Response &res) {
+            res.set_content(body, "application/json");
+        });
+        unix_upstream.bind_to_port(kUpstreamUnixPath, 80);
+        std::thread unix_listener([&unix_upstream]() { unix_upstream.listen_after_bind(); });
+        unix_upstream.wait_until_ready();
+
+        g_snapshot.unix_paths[kUpstreamPort] = kUpstreamUnixPath;
+        bench_engine(xiunneg::IoEngine::Kind::EPOLL, "epoll+unix");
+        bench_engine(xiunneg::IoEngine::Kind::IO_URING, "uring+unix");
+
+        unix_upstream.stop();
+        unix_listener.join();
+        std::remove(kUpstreamUnixPath);
+
+#ifdef __linux__
+        bench_backlog(body);
+#endif
+    }
+
+    upstream.stop();
+    upstream_listener.join();
+    return 0;
+}
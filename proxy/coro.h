@@ -0,0 +1,230 @@
+// coro.h
+#pragma once
+
+/**
+ * ************************************************************************
+ *
+ * @file coro.h
+ * @author xiunneg
+ * @brief  C++20 协程基础设施: 惰性启动的 Task<T> 与挂在 IoEngine 上的 I/O 等待体,
+ *         I/O 完成回调在 IoEngine::poll 中恢复协程, 等待期间不占用线程
+ * ************************************************************************
+ * @copyright Copyright (c) 2025 xiunneg
+ * ************************************************************************
+ */
+
+#include "io_engine.h"
+
+#include <stdint.h>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <utility>
+
+namespace xiunneg::coro {
+
+template <typename T = void>
+class Task;
+
+namespace detail {
+struct PromiseBase {
+    std::coroutine_handle<> continuation; // 等待本协程的上层协程
+    std::function<void()> on_done;        // 顶层协程结束回调
+    std::exception_ptr exception;
+
+    struct FinalAwaiter {
+        bool await_ready() noexcept {
+            return false;
+        }
+
+        // 有上层协程时直接切换过去, 否则停在结束点由持有者销毁
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            auto &promise = handle.promise();
+            if (promise.continuation) return promise.continuation;
+            if (promise.on_done) promise.on_done();
+            return std::noop_coroutine();
+        }
+
+        void await_resume() noexcept {
+        }
+    };
+
+    std::suspend_always initial_suspend() noexcept {
+        return {};
+    }
+
+    FinalAwaiter final_suspend() noexcept {
+        return {};
+    }
+
+    void unhandled_exception() {
+        exception = std::current_exception();
+    }
+
+    void rethrow_if_failed() {
+        if (exception) std::rethrow_exception(exception);
+    }
+};
+
+template <typename T>
+struct TaskPromise : PromiseBase {
+    std::optional<T> value;
+
+    Task<T> get_return_object();
+
+    void return_value(T v) {
+        value.emplace(std::move(v));
+    }
+
+    T result() {
+        rethrow_if_failed();
+        return std::move(*value);
+    }
+};
+
+template <>
+struct TaskPromise<void> : PromiseBase {
+    Task<void> get_return_object();
+
+    void return_void() {
+    }
+
+    void result() {
+        rethrow_if_failed();
+    }
+};
+} // namespace detail
+
+// 惰性启动, 被 co_await 或 start 时才开始执行
+template <typename T>
+class Task {
+public:
+    using promise_type = detail::TaskPromise<T>;
+    using Handle = std::coroutine_handle<promise_type>;
+
+private:
+    Handle handle_;
+
+public:
+    Task() = default;
+
+    explicit Task(Handle handle) :
+        handle_(handle) {
+    }
+
+    Task(Task &&other) noexcept :
+        handle_(std::exchange(other.handle_, nullptr)) {
+    }
+
+    Task &operator=(Task &&other) noexcept {
+        if (this != &other) {
+            if (handle_) handle_.destroy();
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+
+    // 销毁协程帧, 帧内等待中的子任务随之销毁
+    ~Task() {
+        if (handle_) handle_.destroy();
+    }
+
+    bool done() const {
+        return !handle_ || handle_.done();
+    }
+
+    /**
+     * ************************************************************************
+     * @brief 作为顶层协程启动, 结束时调用 on_done, 协程帧仍由 Task 持有
+     *
+     * @param[in] on_done  结束回调, 不能在其中销毁本 Task
+     * ************************************************************************
+     */
+    void start(std::function<void()> on_done) {
+        handle_.promise().on_done = std::move(on_done);
+        handle_.resume();
+    }
+
+    bool await_ready() const noexcept {
+        return done();
+    }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle_.promise().continuation = awaiting;
+        return handle_;
+    }
+
+    T await_resume() {
+        return handle_.promise().result();
+    }
+};
+
+template <typename T>
+Task<T> detail::TaskPromise<T>::get_return_object() {
+    return Task<T>(std::coroutine_handle<TaskPromise>::from_promise(*this));
+}
+
+inline Task<void> detail::TaskPromise<void>::get_return_object() {
+    return Task<void>(std::coroutine_handle<TaskPromise>::from_promise(*this));
+}
+
+// 提交一次 IoEngine 操作并挂起, 完成后返回操作结果(>= 0 成功, < 0 为 -errno)
+template <typename Submit>
+class IoAwaitable {
+private:
+    Submit submit_;
+    int result_ = 0;
+
+public:
+    explicit IoAwaitable(Submit submit) :
+        submit_(std::move(submit)) {
+    }
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    // 引擎只在 poll 中分发完成回调, 不会在提交时同步恢复
+    void await_suspend(std::coroutine_handle<> handle) {
+        submit_([this, handle](int result) {
+            result_ = result;
+            handle.resume();
+        });
+    }
+
+    int await_resume() const noexcept {
+        return result_;
+    }
+};
+
+inline auto async_accept(IoEngine &engine, int listen_fd) {
+    return IoAwaitable([&engine, listen_fd](IoEngine::Callback cb) {
+        engine.accept(listen_fd, std::move(cb));
+    });
+}
+
+// addr 须在 co_await 结束前有效
+inline auto async_connect(IoEngine &engine, int fd, const sockaddr_storage &addr, uint32_t addr_len) {
+    return IoAwaitable([&engine, fd, &addr, addr_len](IoEngine::Callback cb) {
+        engine.connect(fd, addr, addr_len, std::move(cb));
+    });
+}
+
+inline auto async_recv(IoEngine &engine, int fd, BufferPool::Buffer buffer) {
+    return IoAwaitable([&engine, fd, buffer](IoEngine::Callback cb) {
+        engine.recv(fd, buffer, std::move(cb));
+    });
+}
+
+// data 位于注册缓冲区 buffer_index 内时可走 WRITE_FIXED
+inline auto async_send(IoEngine &engine, int fd, const char *data, std::size_t size, int buffer_index = -1) {
+    return IoAwaitable([&engine, fd, data, size, buffer_index](IoEngine::Callback cb) {
+        engine.send(fd, data, size, buffer_index, std::move(cb));
+    });
+}
+} // namespace xiunneg::coro
@@ -0,0 +1,115 @@
+// discovery_feed.cpp
+#include "discovery_feed.h"
+
+#include <algorithm>
+#include <map>
+
+using namespace xiunneg;
+
+DiscoveryFeed::DiscoveryFeed(std::size_t max_events) :
+    snapshot_(std::make_shared<PortScanner::Snapshot>()),
+    max_events_(max_events) {
+}
+
+void DiscoveryFeed::publish(const PortScanner::SnapshotPtr &snapshot) {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (snapshot->version < snapshot_->version) return;
+        // 扫描器已运行一段时间后才订阅, 更早的变化不可知
+        if (snapshot_->version == 0 && events_.empty()) oldest_ = snapshot->version;
+
+        // 仅 Unix 域套接字路径变化的版本没有增量, 不记为事件
+        if (!snapshot->added.empty() || !snapshot->removed.empty() || !snapshot->rebound.empty()) {
+            events_.push_back(Event{
+                .version = snapshot->version,
+                .added = snapshot->added,
+                .removed = snapshot->removed,
+                .rebound = snapshot->rebound,
+            });
+            while (events_.size() > max_events_) {
+                oldest_ = events_.front().version;
+                events_.pop_front();
+            }
+        }
+        snapshot_ = snapshot;
+    }
+    cv_.notify_all();
+}
+
+void DiscoveryFeed::close() {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        closed_ = true;
+    }
+    cv_.notify_all();
+}
+
+bool DiscoveryFeed::closed() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return closed_;
+}
+
+PortScanner::SnapshotPtr DiscoveryFeed::current() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return snapshot_;
+}
+
+PortScanner::SnapshotPtr DiscoveryFeed::wait_change(uint64_t version, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mtx_);
+    cv_.wait_for(lock, timeout, [this, version]() {
+        return closed_ || snapshot_->version != version;
+    });
+    return snapshot_;
+}
+
+std::optional<std::vector<DiscoveryFeed::Event>> DiscoveryFeed::events_since(uint64_t version) const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    // 未来的版本来自重启前的网关, 过早的版本对应的变化已被丢弃
+    if (version > snapshot_->version || version < oldest_) return std::nullopt;
+
+    auto it = std::find_if(events_.begin(), events_.end(), [version](const Event &event) {
+        return event.version > version;
+    });
+    return std::vector<Event>(it, events_.end());
+}
+
+std::optional<DiscoveryFeed::Event> DiscoveryFeed::delta_since(uint64_t version, PortScanner::SnapshotPtr &snapshot) const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    snapshot = snapshot_;
+    if (version > snapshot_->version || version < oldest_) return std::nullopt;
+
+    // 端口 -> (version 时是否在线, 当前是否在线), 由每个端口第一次与最后一次变化推出
+    struct Presence {
+        bool before;
+        bool after;
+    };
+    std::map<uint16_t, Presence> presence;
+    auto it = std::find_if(events_.begin(), events_.end(), [version](const Event &event) {
+        return event.version > version;
+    });
+    for (; it != events_.end(); ++it) {
+        for (auto port : it->added) {
+            presence.try_emplace(port, Presence{false, true}).first->second.after = true;
+        }
+        for (auto port : it->removed) {
+            presence.try_emplace(port, Presence{true, false}).first->second.after = false;
+        }
+        for (auto port : it->rebound) {
+            presence.try_emplace(port, Presence{true, true});
+        }
+    }
+
+    Event delta;
+    delta.version = snapshot_->version;
+    for (const auto &[port, state] : presence) {
+        if (!state.before && state.after) {
+            delta.added.insert(port);
+        } else if (state.before && !state.after) {
+            delta.removed.insert(port);
+        } else if (state.before && state.after) {
+            // 期间下线又上线, 进程很可能已经不同
+            delta.rebound.insert(port);
+        }
+    }
+    return delta;
+}
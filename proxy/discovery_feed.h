@@ -0,0 +1,96 @@
+// discovery_feed.h
+#pragma once
+
+/**
+ * ************************************************************************
+ *
+ * @file discovery_feed.h
+ * @author xiunneg
+ * @brief  服务发现变更流,按版本保存扫描器快照的增量,
+ *         供 /machine-list?wait=<version> 长轮询、?since=<version> 增量同步与 /machine-events (SSE) 使用
+ * ************************************************************************
+ * @copyright Copyright (c) 2025 xiunneg
+ * ************************************************************************
+ */
+
+#include "port_scanner/port_scanner.h"
+
+#include <stdint.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <vector>
+
+namespace xiunneg {
+
+class DiscoveryFeed {
+public:
+    // 一次版本变化
+    struct Event {
+        uint64_t version = 0;
+        std::set<uint16_t> added;   // 新增的端口
+        std::set<uint16_t> removed; // 关闭的端口
+        std::set<uint16_t> rebound; // 换了进程的端口
+    };
+
+private:
+    mutable std::mutex mtx_;
+    std::condition_variable cv_;
+
+    PortScanner::SnapshotPtr snapshot_;
+    std::deque<Event> events_; // 最近的变化, 按版本递增
+    uint64_t oldest_ = 0;      // 自该版本起 events_ 完整, 更早的版本须全量同步
+    std::size_t max_events_;
+    bool closed_ = false;
+
+public:
+    explicit DiscoveryFeed(std::size_t max_events = 256);
+
+    // 记录新快照并唤醒等待者, 作为扫描器订阅回调的一部分调用
+    void publish(const PortScanner::SnapshotPtr &snapshot);
+    // 唤醒所有等待者并不再阻塞, 退出时调用
+    void close();
+    bool closed() const;
+
+    PortScanner::SnapshotPtr current() const;
+
+    /**
+     * ************************************************************************
+     * @brief 阻塞等待版本与 version 不同
+     *
+     * @param[in] version  调用方已知的版本
+     * @param[in] timeout  最长等待时间
+     *
+     * @return 返回时的最新快照, 超时或关闭时版本可能仍为 version
+     * ************************************************************************
+     */
+    PortScanner::SnapshotPtr wait_change(uint64_t version, std::chrono::milliseconds timeout);
+
+    /**
+     * ************************************************************************
+     * @brief 取 version 之后的全部变化
+     *
+     * @param[in] version  调用方已知的版本
+     *
+     * @return 按版本递增的变化, version 早于保留范围时返回空, 调用方应改为全量同步
+     * ************************************************************************
+     */
+    std::optional<std::vector<Event>> events_since(uint64_t version) const;
+
+    /**
+     * ************************************************************************
+     * @brief 将 version 之后的变化合并为一次净变化: 先关闭后恢复的端口计入 rebound,
+     *        先新增后关闭的端口不出现
+     *
+     * @param[in] version  调用方已知的版本
+     * @param[out] snapshot  与返回的变化一致的最新快照
+     *
+     * @return 净变化, 其 version 为 snapshot 的版本; version 不在保留范围时返回空
+     * ************************************************************************
+     */
+    std::optional<Event> delta_since(uint64_t version, PortScanner::SnapshotPtr &snapshot) const;
+};
+} // namespace xiunneg
@@ -0,0 +1,345 @@
+// event_loop.cpp
+#include "event_loop.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <netdb.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+using namespace xiunneg;
+
+namespace {
+// 监听队列满时 Unix 域套接字连接的重试上限与退避间隔
+constexpr std::chrono::milliseconds kUnixConnectTimeout{1000};
+constexpr std::chrono::milliseconds kUnixConnectMaxBackoff{32};
+} // namespace
+
+EventLoop::EventLoop(const IoEngine::Config &config) :
+    engine_(IoEngine::create(config)),
+    running_(false),
+    deadline_wheel_(kDeadlineTick) {
+    if (engine_ == nullptr) {
+        throw std::runtime_error("当前平台不支持异步 I/O 引擎");
+    }
+}
+
+EventLoop::~EventLoop() {
+    stop();
+    clear_sessions();
+    // 销毁引擎时丢弃未分发的完成回调
+    engine_.reset();
+}
+
+IoEngine &EventLoop::engine() {
+    return *engine_;
+}
+
+const IoEngine &EventLoop::engine() const {
+    return *engine_;
+}
+
+void EventLoop::spawn(coro::Task<> task) {
+    auto id = next_session_++;
+    auto &session = sessions_.emplace(id, std::move(task)).first->second;
+    session.start([this, id]() {
+        finished_.push_back(id);
+    });
+}
+
+void EventLoop::clear_sessions() {
+    sessions_.clear();
+    finished_.clear();
+}
+
+void EventLoop::reap() {
+    for (auto id : finished_) {
+        sessions_.erase(id);
+    }
+    finished_.clear();
+}
+
+void EventLoop::post(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(posted_mtx_);
+        posted_.push_back(std::move(task));
+    }
+    engine_->wake();
+}
+
+void EventLoop::run_posted() {
+    std::vector<std::function<void()>> tasks;
+    {
+        std::lock_guard<std::mutex> lock(posted_mtx_);
+        tasks.swap(posted_);
+    }
+    for (auto &task : tasks) task();
+}
+
+void EventLoop::run() {
+    running_.store(true);
+    while (running_.load()) {
+        run_posted();
+        engine_->poll(next_timeout_ms());
+        expire_waiters();
+        expire_deadlines();
+        reap();
+    }
+}
+
+void EventLoop::stop() {
+    running_.store(false);
+    if (engine_) engine_->wake();
+}
+
+void EventLoop::close_fd(int fd) {
+    if (engine_) {
+        engine_->close(fd);
+    } else {
+#ifdef __linux__
+        ::close(fd);
+#endif
+    }
+}
+
+int EventLoop::listen(const std::string &host, uint16_t port) {
+    int listen_fd = -1;
+#ifdef __linux__
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    addrinfo *result = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) != 0) {
+        return -1;
+    }
+
+    for (auto *ai = result; ai != nullptr; ai = ai->ai_next) {
+        int fd = socket(ai->ai_family, ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0) continue;
+
+        int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on));
+        if (::bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && ::listen(fd, SOMAXCONN) == 0) {
+            listen_fd = fd;
+            break;
+        }
+        ::close(fd);
+    }
+    freeaddrinfo(result);
+#endif
+    return listen_fd;
+}
+
+EventLoop::NotifyAwaitable::NotifyAwaitable(EventLoop *loop, std::chrono::milliseconds timeout) :
+    loop_(loop),
+    deadline_(Clock::now() + timeout) {
+}
+
+EventLoop::NotifyAwaitable::~NotifyAwaitable() {
+    if (waiting_) loop_->waiters_.erase(it_);
+}
+
+void EventLoop::NotifyAwaitable::await_suspend(std::coroutine_handle<> handle) {
+    handle_ = handle;
+    it_ = loop_->waiters_.emplace(deadline_, this);
+    waiting_ = true;
+}
+
+EventLoop::NotifyAwaitable EventLoop::wait_notify(std::chrono::milliseconds timeout) {
+    return NotifyAwaitable(this, timeout);
+}
+
+void EventLoop::notify_all() {
+    // 先整体摘下, 恢复后再次等待的协程进入下一轮
+    auto waiters = std::move(waiters_);
+    waiters_.clear();
+
+    std::vector<std::coroutine_handle<>> handles;
+    handles.reserve(waiters.size());
+    for (auto &[deadline, waiter] : waiters) {
+        waiter->waiting_ = false;
+        waiter->notified_ = true;
+        handles.push_back(waiter->handle_);
+    }
+    for (auto handle : handles) handle.resume();
+}
+
+int EventLoop::next_timeout_ms() const {
+    // 有截止时间时至少每个 tick 醒来推进一次时间轮
+    int timeout = deadlines_.empty() ? -1 : static_cast<int>(kDeadlineTick.count());
+    if (waiters_.empty()) return timeout;
+    auto remain = std::chrono::ceil<std::chrono::milliseconds>(waiters_.begin()->first - Clock::now());
+    auto waiter_timeout = static_cast<int>(std::max<std::chrono::milliseconds::rep>(0, remain.count()));
+    return timeout < 0 ? waiter_timeout : std::min(timeout, waiter_timeout);
+}
+
+void EventLoop::expire_waiters() {
+    auto now = Clock::now();
+    std::vector<std::coroutine_handle<>> handles;
+    while (!waiters_.empty() && waiters_.begin()->first <= now) {
+        auto *waiter = waiters_.begin()->second;
+        waiters_.erase(waiters_.begin());
+        waiter->waiting_ = false;
+        handles.push_back(waiter->handle_);
+    }
+    for (auto handle : handles) handle.resume();
+}
+
+void EventLoop::expire_deadlines() {
+    for (auto id : deadline_wheel_.advance(Clock::now())) {
+        auto it = deadlines_.find(id);
+        if (it == deadlines_.end()) continue;
+        auto *deadline = it->second;
+        deadlines_.erase(it);
+        deadline->id_ = 0;
+        deadline->expired_ = true;
+#ifdef __linux__
+        // 连接中的套接字同样被中止, 挂起的操作在下一轮 poll 中完成
+        ::shutdown(deadline->fd_, SHUT_RDWR);
+        if (deadline->peer_fd_ >= 0) ::shutdown(deadline->peer_fd_, SHUT_RDWR);
+#endif
+    }
+}
+
+EventLoop::Deadline::Deadline(EventLoop *loop, int fd, int peer_fd) :
+    loop_(loop),
+    fd_(fd),
+    peer_fd_(peer_fd) {
+}
+
+EventLoop::Deadline::~Deadline() {
+    cancel();
+}
+
+void EventLoop::Deadline::arm(std::chrono::milliseconds timeout) {
+    if (expired_) return;
+    // 时间轮只在有截止时间时推进, 先追上当前时间再按相对时长调度
+    loop_->expire_deadlines();
+    if (id_ == 0) {
+        id_ = loop_->next_deadline_++;
+        loop_->deadlines_.emplace(id_, this);
+    }
+    loop_->deadline_wheel_.schedule(id_, timeout);
+}
+
+void EventLoop::Deadline::cancel() {
+    if (id_ == 0) return;
+    loop_->deadline_wheel_.cancel(id_);
+    loop_->deadlines_.erase(id_);
+    id_ = 0;
+}
+
+coro::Task<int> EventLoop::connect_tcp(std::string host, uint16_t port, std::string &error_msg, std::chrono::milliseconds timeout) {
+#ifdef __linux__
+    sockaddr_storage addr{};
+    socklen_t addr_len = 0;
+    auto *addr4 = reinterpret_cast<sockaddr_in *>(&addr);
+    auto *addr6 = reinterpret_cast<sockaddr_in6 *>(&addr);
+    if (inet_pton(AF_INET, host.c_str(), &addr4->sin_addr) == 1) {
+        addr4->sin_family = AF_INET;
+        addr4->sin_port = htons(port);
+        addr_len = sizeof(sockaddr_in);
+    } else if (inet_pton(AF_INET6, host.c_str(), &addr6->sin6_addr) == 1) {
+        addr6->sin6_family = AF_INET6;
+        addr6->sin6_port = htons(port);
+        addr_len = sizeof(sockaddr_in6);
+    } else {
+        error_msg = std::format("上游地址无效: {}", host);
+        co_return -EINVAL;
+    }
+
+    int fd = socket(addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        int error = errno;
+        error_msg = std::format("创建上游套接字失败: {}", std::strerror(error));
+        co_return -error;
+    }
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+    int result = 0;
+    bool timed_out = false;
+    {
+        Deadline deadline(this, fd);
+        if (timeout.count() > 0) deadline.arm(timeout);
+        result = co_await coro::async_connect(*engine_, fd, addr, addr_len);
+        timed_out = deadline.expired();
+    }
+    if (timed_out) {
+        close_fd(fd);
+        error_msg = std::format("连接上游超时: {}ms", timeout.count());
+        co_return -ETIMEDOUT;
+    }
+    if (result < 0) {
+        close_fd(fd);
+        error_msg = std::format("连接上游失败: {}", std::strerror(-result));
+        co_return result;
+    }
+    co_return fd;
+#else
+    error_msg = "当前平台不支持";
+    co_return -ENOTSUP;
+#endif
+}
+
+coro::Task<int> EventLoop::connect_unix(std::string path, std::string &error_msg) {
+#ifdef __linux__
+    sockaddr_storage addr{};
+    auto *addr_un = reinterpret_cast<sockaddr_un *>(&addr);
+    if (path.size() >= sizeof(addr_un->sun_path)) {
+        error_msg = std::format("套接字路径过长: {}", path);
+        co_return -ENAMETOOLONG;
+    }
+    addr_un->sun_family = AF_UNIX;
+    std::copy(path.begin(), path.end(), addr_un->sun_path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        int error = errno;
+        error_msg = std::format("创建上游套接字失败: {}", std::strerror(error));
+        co_return -error;
+    }
+
+    // 对端监听队列满时非阻塞 connect 立即返回 EAGAIN, 而未连接的 Unix 套接字始终可写,
+    // 队列腾出空位也不会有事件通知, 因此按退避间隔在同一套接字上重试, 直到超时
+    auto deadline = Clock::now() + kUnixConnectTimeout;
+    auto backoff = std::chrono::milliseconds(1);
+    int result = co_await coro::async_connect(*engine_, fd, addr, sizeof(sockaddr_un));
+    while (result == -EAGAIN && Clock::now() < deadline) {
+        co_await wait_notify(backoff);
+        backoff = std::min(backoff * 2, kUnixConnectMaxBackoff);
+        result = co_await coro::async_connect(*engine_, fd, addr, sizeof(sockaddr_un));
+    }
+    if (result < 0) {
+        close_fd(fd);
+        error_msg = std::format("连接上游 {} 失败: {}", path, std::strerror(-result));
+        co_return result;
+    }
+    co_return fd;
+#else
+    error_msg = "当前平台不支持";
+    co_return -ENOTSUP;
+#endif
+}
+
+coro::Task<bool> EventLoop::send_all(int fd, std::string_view data, int buffer_index, Deadline *deadline, std::chrono::milliseconds timeout) {
+    while (!data.empty()) {
+        if (deadline) deadline->arm(timeout);
+        int n = co_await coro::async_send(*engine_, fd, data.data(), data.size(), buffer_index);
+        if (n <= 0) co_return false;
+        data.remove_prefix(static_cast<std::size_t>(n));
+    }
+    co_return true;
+}
@@ -0,0 +1,189 @@
+// event_loop.h
+#pragma once
+
+/**
+ * ************************************************************************
+ *
+ * @file event_loop.h
+ * @author xiunneg
+ * @brief  仅支持 Linux 平台,单线程协程事件循环:持有 IoEngine 与顶层协程,
+ *         提供跨线程投递任务、带超时的广播等待、套接字截止时间以及监听、连接上游、完整发送等公共协程操作,
+ *         供 HTTP 事件循环(AsyncLoop)与四层转发(L4Relay)共用
+ * ************************************************************************
+ * @copyright Copyright (c) 2025 xiunneg
+ * ************************************************************************
+ */
+
+#include "coro.h"
+#include "io_engine.h"
+#include "timing_wheel.h"
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace xiunneg {
+
+class EventLoop {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // 挂起直到 notify_all 或超时, 被唤醒返回 true; 协程帧销毁时自动取消等待
+    class NotifyAwaitable {
+        friend class EventLoop;
+
+    private:
+        EventLoop *loop_;
+        Clock::time_point deadline_;
+        std::coroutine_handle<> handle_;
+        std::multimap<Clock::time_point, NotifyAwaitable *>::iterator it_;
+        bool waiting_ = false;
+        bool notified_ = false;
+
+    public:
+        NotifyAwaitable(EventLoop *loop, std::chrono::milliseconds timeout);
+        ~NotifyAwaitable();
+
+        NotifyAwaitable(const NotifyAwaitable &) = delete;
+        NotifyAwaitable &operator=(const NotifyAwaitable &) = delete;
+
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> handle);
+
+        bool await_resume() const noexcept {
+            return notified_;
+        }
+    };
+
+    /**
+     * ************************************************************************
+     * @brief 套接字截止时间: 到期时 shutdown 套接字, 挂起中的收发与连接随即以 EOF 或错误完成,
+     *        由持有方以 expired() 区分超时与对端关闭; 析构时取消, 须先于套接字关闭析构.
+     *        只在事件循环线程中使用, 精度为 kDeadlineTick
+     * ************************************************************************
+     */
+    class Deadline {
+        friend class EventLoop;
+
+    private:
+        EventLoop *loop_;
+        int fd_;
+        int peer_fd_;
+        TimingWheel::Id id_ = 0; // 0 为未设置
+        bool expired_ = false;
+
+    public:
+        // peer_fd 非负时到期一并 shutdown, 用于双向转发的两端
+        Deadline(EventLoop *loop, int fd, int peer_fd = -1);
+        ~Deadline();
+
+        Deadline(const Deadline &) = delete;
+        Deadline &operator=(const Deadline &) = delete;
+
+        // 从现在起 timeout 后到期, 已设置时改为新的到期时间
+        void arm(std::chrono::milliseconds timeout);
+        void cancel();
+
+        bool expired() const {
+            return expired_;
+        }
+    };
+
+    static constexpr std::chrono::milliseconds kDeadlineTick{100};
+
+private:
+    std::unique_ptr<IoEngine> engine_;
+    std::atomic<bool> running_;
+
+    // 其他线程投递到事件循环执行的任务
+    std::mutex posted_mtx_;
+    std::vector<std::function<void()>> posted_;
+
+    // 顶层协程, 结束后在下一轮循环中回收
+    std::unordered_map<uint64_t, coro::Task<>> sessions_;
+    std::vector<uint64_t> finished_;
+    uint64_t next_session_ = 0;
+
+    // 等待广播的协程, 按超时时间排序
+    std::multimap<Clock::time_point, NotifyAwaitable *> waiters_;
+
+    // 已设置的截止时间, 到期 O(1) 取出
+    TimingWheel deadline_wheel_;
+    std::unordered_map<TimingWheel::Id, Deadline *> deadlines_;
+    TimingWheel::Id next_deadline_ = 1;
+
+public:
+    // 当前平台不支持时抛出 std::runtime_error
+    explicit EventLoop(const IoEngine::Config &config);
+    ~EventLoop();
+
+    EventLoop(const EventLoop &) = delete;
+    EventLoop &operator=(const EventLoop &) = delete;
+
+    IoEngine &engine();
+    const IoEngine &engine() const;
+
+    // 启动顶层协程, 须在事件循环线程中调用(run 之前亦可)
+    void spawn(coro::Task<> task);
+    // 销毁所有挂起中的顶层协程, 协程帧内的资源随之释放
+    void clear_sessions();
+
+    // 线程安全, 投递任务到事件循环线程执行
+    void post(std::function<void()> task);
+
+    void run();
+    void stop();
+
+    void close_fd(int fd);
+
+    // 挂起当前协程直到 notify_all 或超时, 须在事件循环线程中 co_await
+    NotifyAwaitable wait_notify(std::chrono::milliseconds timeout);
+    // 唤醒所有 wait_notify 中的协程, 须在事件循环线程中调用
+    void notify_all();
+
+    // 创建非阻塞监听套接字(SO_REUSEADDR/SO_REUSEPORT), 失败返回 -1
+    int listen(const std::string &host, uint16_t port);
+
+    /**
+     * ************************************************************************
+     * @brief 异步连接 host:port, host 为 IPv4/IPv6 字面量, 按值保存在协程帧中
+     *
+     * @param[in] host  目标地址, 如 127.0.0.1、::1 或远程主机
+     * @param[in] port  目标端口
+     * @param[out] error_msg  失败原因
+     * @param[in] timeout  连接超时, 0 为不限
+     *
+     * @return 已连接的非阻塞套接字, 失败返回负的 errno
+     * ************************************************************************
+     */
+    coro::Task<int> connect_tcp(std::string host, uint16_t port, std::string &error_msg, std::chrono::milliseconds timeout = {});
+
+    // 异步连接 Unix 域套接字, 失败返回负的 errno 并填充 error_msg; path 按值保存在协程帧中
+    coro::Task<int> connect_unix(std::string path, std::string &error_msg);
+
+    // 发送全部数据, 失败返回 false; data 位于注册缓冲区内时传入其下标;
+    // 传入 deadline 时每次发送前重新计时 timeout, 对端长时间不读取时以失败结束
+    coro::Task<bool> send_all(int fd, std::string_view data, int buffer_index = -1,
+                              Deadline *deadline = nullptr, std::chrono::milliseconds timeout = {});
+
+private:
+    void run_posted();
+    void reap();
+    // 距最近一个等待超时的毫秒数, 无等待时为 -1
+    int next_timeout_ms() const;
+    void expire_waiters();
+    void expire_deadlines();
+};
+} // namespace xiunneg
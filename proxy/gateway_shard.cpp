@@ -0,0 +1,316 @@
+// gateway_shard.cpp
+#include "gateway_shard.h"
+
+#include <format>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace xiunneg;
+
+namespace {
+void pin_current_thread(int core) {
+    if (core < 0) return;
+#ifdef _WIN32
+    SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << core);
+#elif defined(__linux__)
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(core, &cpu_set);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+#endif
+}
+
+// 与 httplib::ThreadPool 相同的任务队列,工作线程启动时绑定到分片所在的核
+class PinnedTaskQueue final : public httplib::TaskQueue {
+private:
+    std::vector<std::thread> threads_;
+    std::list<std::function<void()>> jobs_;
+
+    bool shutdown_;
+
+    std::condition_variable cond_;
+    std::mutex mutex_;
+
+public:
+    PinnedTaskQueue(std::size_t n, int core) :
+        shutdown_(false) {
+        while (n--) {
+            threads_.emplace_back([this, core]() {
+                pin_current_thread(core);
+                work();
+            });
+        }
+    }
+
+    bool enqueue(std::function<void()> fn) override {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            jobs_.push_back(std::move(fn));
+        }
+        cond_.notify_one();
+        return true;
+    }
+
+    void shutdown() override {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            shutdown_ = true;
+        }
+        cond_.notify_all();
+        for (auto &t : threads_) {
+            t.join();
+        }
+    }
+
+private:
+    void work() {
+        for (;;) {
+            std::function<void()> fn;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cond_.wait(lock, [this] { return !jobs_.empty() || shutdown_; });
+                if (shutdown_ && jobs_.empty()) break;
+                fn = std::move(jobs_.front());
+                jobs_.pop_front();
+            }
+            fn();
+        }
+    }
+};
+
+// 包装任务队列, 记录连接从入队到被工作线程取出的等待时间
+class TimedTaskQueue final : public httplib::TaskQueue {
+private:
+    std::unique_ptr<httplib::TaskQueue> inner_;
+
+public:
+    explicit TimedTaskQueue(httplib::TaskQueue *inner) :
+        inner_(inner) {
+    }
+
+    bool enqueue(std::function<void()> fn) override {
+        return inner_->enqueue([fn = std::move(fn), queued = std::chrono::steady_clock::now()]() {
+            GatewayServer::set_queue_wait(elapsed_us(queued, std::chrono::steady_clock::now()));
+            fn();
+        });
+    }
+
+    void shutdown() override {
+        inner_->shutdown();
+    }
+
+    void on_idle() override {
+        inner_->on_idle();
+    }
+};
+} // namespace
+
+GatewayServer::GatewayServer() {
+    set_pre_routing_handler([](const httplib::Request &, httplib::Response &) {
+        received_ = std::chrono::steady_clock::now();
+        return HandlerResponse::Unhandled;
+    });
+}
+
+socket_t GatewayServer::current_socket() {
+    return current_socket_;
+}
+
+std::chrono::steady_clock::time_point GatewayServer::request_received() {
+    return received_;
+}
+
+int64_t GatewayServer::request_queue_us() {
+    return queue_wait_us_;
+}
+
+void GatewayServer::set_queue_wait(int64_t us) {
+    queue_wait_us_ = us;
+}
+
+// 与 httplib::Server::process_and_close_socket 相同,同一连接上的请求都在本线程中处理
+bool GatewayServer::process_and_close_socket(socket_t sock) {
+    std::string remote_addr;
+    int remote_port = 0;
+    httplib::detail::get_remote_ip_and_port(sock, remote_addr, remote_port);
+
+    std::string local_addr;
+    int local_port = 0;
+    httplib::detail::get_local_ip_and_port(sock, local_addr, local_port);
+
+    current_socket_ = sock;
+    auto ret = httplib::detail::process_server_socket(
+        svr_sock_, sock, keep_alive_max_count_, keep_alive_timeout_sec_,
+        read_timeout_sec_, read_timeout_usec_, write_timeout_sec_,
+        write_timeout_usec_,
+        [&](httplib::Stream &strm, bool close_connection, bool &connection_closed) {
+            auto ret = process_request(strm, remote_addr, remote_port, local_addr,
+                                       local_port, close_connection, connection_closed,
+                                       nullptr);
+            // 排队只计入连接上的第一个请求
+            queue_wait_us_ = 0;
+            return ret;
+        });
+    current_socket_ = INVALID_SOCKET;
+
+    httplib::detail::shutdown_socket(sock);
+    httplib::detail::close_socket(sock);
+    return ret;
+}
+
+bool xiunneg::shard_reuseport_supported() {
+#ifdef SO_REUSEPORT
+    return true;
+#else
+    return false;
+#endif
+}
+
+GatewayShard::GatewayShard(const Config &config, Logger logger) :
+    config_(config),
+    logger_(logger),
+    limiter_(config.log_limit, logger),
+    snapshot_(std::make_shared<PortScanner::Snapshot>()),
+    feed_(std::max<std::size_t>(config.journal_size, 1)) {
+    auto threads = config_.worker_threads > 0 ? config_.worker_threads : CPPHTTPLIB_THREAD_POOL_COUNT;
+    max_streams_ = config_.max_streams > 0 ? config_.max_streams : std::max<std::size_t>(threads / 2, 1);
+    if (config_.worker_threads > 0 || config_.core >= 0) {
+        auto core = config_.core;
+        server_.new_task_queue = [threads, core]() -> httplib::TaskQueue * {
+            return new PinnedTaskQueue(threads, core);
+        };
+    }
+    server_.new_task_queue = [inner = server_.new_task_queue]() -> httplib::TaskQueue * {
+        return new TimedTaskQueue(inner());
+    };
+
+    if (config_.async_io) {
+        if (!IoEngine::supported()) {
+            logger_->warn(std::format("分片[{}] 当前平台不支持异步 I/O 引擎, 使用 httplib 线程池", config_.id));
+            return;
+        }
+        async_loop_ = std::make_unique<AsyncLoop>(config_.engine);
+        auto kind = async_loop_->engine_kind();
+        if (kind != config_.engine.kind) {
+            logger_->warn(std::format("分片[{}] 不支持 {}, 退化为 {}", config_.id, IoEngine::kind_name(config_.engine.kind), IoEngine::kind_name(kind)));
+        }
+        logger_->info(std::format("分片[{}] I/O 引擎: {}, 注册缓冲区: {}", config_.id, IoEngine::kind_name(kind), async_loop_->buffers_registered()));
+    }
+}
+
+GatewayShard::~GatewayShard() {
+    stop();
+    join();
+}
+
+std::size_t GatewayShard::id() const {
+    return config_.id;
+}
+
+httplib::Server &GatewayShard::server() {
+    return server_;
+}
+
+AsyncLoop *GatewayShard::async_loop() {
+    return async_loop_.get();
+}
+
+UpstreamPool &GatewayShard::pool() {
+    return pool_;
+}
+
+module::SimpleLoggerInterface &GatewayShard::logger() {
+    return *logger_;
+}
+
+module::LogLimiter &GatewayShard::limiter() {
+    return limiter_;
+}
+
+ShardMetrics &GatewayShard::metrics() {
+    return metrics_;
+}
+
+const ShardMetrics &GatewayShard::metrics() const {
+    return metrics_;
+}
+
+PortScanner::SnapshotPtr GatewayShard::snapshot() const {
+    return snapshot_.load(std::memory_order_acquire);
+}
+
+DiscoveryFeed &GatewayShard::feed() {
+    return feed_;
+}
+
+bool GatewayShard::try_acquire_stream() {
+    auto current = streams_.load(std::memory_order_relaxed);
+    do {
+        if (current >= max_streams_) return false;
+    } while (!streams_.compare_exchange_weak(current, current + 1, std::memory_order_relaxed));
+    return true;
+}
+
+void GatewayShard::release_stream() {
+    streams_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void GatewayShard::on_snapshot(const PortScanner::SnapshotPtr &snapshot) {
+    snapshot_.store(snapshot, std::memory_order_release);
+    // 换了进程的端口上的空闲连接指向旧进程, 与下线端口一并丢弃
+    auto live = std::make_shared<std::set<uint16_t>>(snapshot->ports);
+    for (auto port : snapshot->rebound) {
+        live->erase(port);
+    }
+    pool_.retain(*live);
+    feed_.publish(snapshot);
+    if (async_loop_) {
+        // 事件循环的空闲连接与等待中的协程只在循环线程中访问
+        async_loop_->post([loop = async_loop_.get(), live]() {
+            loop->retain_upstreams(*live);
+            loop->notify();
+        });
+    }
+}
+
+bool GatewayShard::bind(const std::string &host, uint16_t port) {
+    auto ok = async_loop_ ? async_loop_->bind(host, port) : server_.bind_to_port(host, port);
+    if (!ok) {
+        logger_->error(std::format("分片[{}] 绑定 {}:{} 失败", config_.id, host, port));
+        return false;
+    }
+    return true;
+}
+
+void GatewayShard::start() {
+    listener_ = std::thread([this]() {
+        pin_current_thread(config_.core);
+        logger_->info(std::format("分片[{}] 开始监听, 绑定核 {}", config_.id, config_.core));
+        if (async_loop_) {
+            async_loop_->run();
+        } else {
+            server_.listen_after_bind();
+        }
+    });
+}
+
+void GatewayShard::stop() {
+    // 唤醒阻塞在长轮询与 SSE 中的工作线程
+    feed_.close();
+    if (async_loop_) {
+        async_loop_->stop();
+    }
+    if (server_.is_running()) {
+        server_.stop();
+    }
+}
+
+void GatewayShard::join() {
+    if (listener_.joinable())
+        listener_.join();
+}
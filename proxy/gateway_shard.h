@@ -0,0 +1,153 @@
+// gateway_shard.h
+#pragma once
+
+/**
+ * ************************************************************************
+ *
+ * @file gateway_shard.h
+ * @author xiunneg
+ * @brief  网关分片,每个分片独占监听线程、工作线程、上游连接池与日志器,
+ *         通过 SO_REUSEPORT 共享同一监听端口,由内核在分片间分发连接
+ * ************************************************************************
+ * @copyright Copyright (c) 2025 xiunneg
+ * ************************************************************************
+ */
+
+#include "async_loop.h"
+#include "discovery_feed.h"
+#include "httplib.h"
+#include "io_engine.h"
+#include "port_scanner/port_scanner.h"
+#include "simple_log/log_limiter.h"
+#include "simple_log/simple_log.h"
+#include "upstream_pool.h"
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace xiunneg {
+
+// 分片计数器,独占缓存行,仅在聚合指标时被其他线程读取
+struct alignas(64) ShardMetrics {
+    std::atomic<uint64_t> requests{0};        // 收到的请求
+    std::atomic<uint64_t> forwarded{0};       // 成功转发
+    std::atomic<uint64_t> rejected{0};        // 参数错误或服务不存在
+    std::atomic<uint64_t> upstream_errors{0}; // 上游请求失败
+    std::atomic<uint64_t> bytes_out{0};       // 转发给客户端的响应体字节数
+};
+
+// 记录当前线程正在处理的客户端套接字,供绕过 httplib 写出响应体的转发路径使用
+class GatewayServer : public httplib::Server {
+private:
+    static inline thread_local socket_t current_socket_ = INVALID_SOCKET;
+    static inline thread_local std::chrono::steady_clock::time_point received_{};
+    static inline thread_local int64_t queue_wait_us_ = 0;
+
+public:
+    // 以 pre-routing handler 记录请求解析完成的时间, 调用方不应再替换 pre-routing handler
+    GatewayServer();
+
+    static socket_t current_socket();
+
+    // 当前线程正在处理的请求解析完成的时间
+    static std::chrono::steady_clock::time_point request_received();
+    // 当前请求所在连接在任务队列中等待工作线程的时间, 微秒, 同一连接的后续请求为 0
+    static int64_t request_queue_us();
+    // 由任务队列在工作线程取出连接时调用
+    static void set_queue_wait(int64_t us);
+
+protected:
+    bool process_and_close_socket(socket_t sock) override;
+};
+
+class GatewayShard {
+    using Logger = std::shared_ptr<module::SimpleLoggerInterface>;
+
+public:
+    struct Config {
+        std::size_t id = 0;
+        int core = -1;                  // 绑定的 CPU 核, -1 不绑定
+        std::size_t worker_threads = 0; // 工作线程数, 0 使用 httplib 默认线程池
+        bool async_io = false;          // 使用 IoEngine 事件循环代替 httplib 线程池, 仅 Linux
+        IoEngine::Config engine;        // async_io 为 true 时的引擎配置
+        std::size_t journal_size = 256; // 保留的服务变化版本数, 早于此范围的增量同步退化为全量
+        std::size_t max_streams = 0;    // httplib 线程池上同时挂起的长轮询与 SSE 上限, 0 为工作线程数的一半
+        module::LogLimiter::Config log_limit; // 逐请求日志的限流与采样
+    };
+
+private:
+    Config config_;
+
+    GatewayServer server_;
+    std::unique_ptr<AsyncLoop> async_loop_; // 未启用 async_io 或平台不支持时为空
+    UpstreamPool pool_;
+    Logger logger_;
+    module::LogLimiter limiter_; // 逐请求的错误日志按消息限流, info 日志按比例采样
+    ShardMetrics metrics_;
+
+    // 扫描线程投递的最新快照,分片内只读
+    std::atomic<PortScanner::SnapshotPtr> snapshot_;
+    // 按版本记录的服务变化, 供长轮询、增量同步与 SSE 使用
+    DiscoveryFeed feed_;
+
+    // httplib 线程池上挂起中的长轮询与 SSE, 每个占用一个工作线程
+    std::size_t max_streams_;
+    std::atomic<std::size_t> streams_{0};
+
+    std::thread listener_;
+
+public:
+    GatewayShard(const Config &config, Logger logger);
+    ~GatewayShard();
+
+    GatewayShard(const GatewayShard &) = delete;
+    GatewayShard &operator=(const GatewayShard &) = delete;
+
+    std::size_t id() const;
+    httplib::Server &server();
+    AsyncLoop *async_loop();
+    UpstreamPool &pool();
+    module::SimpleLoggerInterface &logger();
+    module::LogLimiter &limiter();
+    ShardMetrics &metrics();
+    const ShardMetrics &metrics() const;
+
+    PortScanner::SnapshotPtr snapshot() const;
+    DiscoveryFeed &feed();
+
+    /**
+     * ************************************************************************
+     * @brief 为 httplib 线程池上的长轮询或 SSE 占用一个名额, 避免挂起的连接占满工作线程后转发无线程可用
+     *
+     * @return 已达 max_streams 时返回 false; 返回 true 时须在连接结束后调用 release_stream
+     * ************************************************************************
+     */
+    bool try_acquire_stream();
+    void release_stream();
+
+    /**
+     * ************************************************************************
+     * @brief 接收扫描器发布的快照,作为 PortScanner 的订阅回调使用
+     *
+     * @param[in] snapshot  不可变快照
+     * ************************************************************************
+     */
+    void on_snapshot(const PortScanner::SnapshotPtr &snapshot);
+
+    bool bind(const std::string &host, uint16_t port);
+    void start();
+    void stop();
+    void join();
+};
+
+/**
+ * ************************************************************************
+ * @brief 当前平台能否让多个分片绑定同一端口并由内核分发连接
+ * ************************************************************************
+ */
+bool shard_reuseport_supported();
+} // namespace xiunneg
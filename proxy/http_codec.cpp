@@ -0,0 +1,242 @@
+// http_codec.cpp
+#include "http_codec.h"
+
+#include <algorithm>
+#include <cctype>
+#include <format>
+
+using namespace xiunneg;
+
+namespace {
+constexpr std::size_t kHeadLimit = 64 * 1024;
+
+std::string_view trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r' || s.back() == '\n')) s.remove_suffix(1);
+    return s;
+}
+
+// 定位头部结尾, 返回头部长度(含空行), 未找到返回 0
+std::size_t find_head_end(std::string_view data) {
+    auto pos = data.find("\r\n\r\n");
+    return pos == std::string_view::npos ? 0 : pos + 4;
+}
+
+// 逐行解析头部字段, 返回首行
+std::string_view parse_fields(std::string_view head, httplib::Headers &headers) {
+    auto line_end = head.find("\r\n");
+    auto first_line = head.substr(0, line_end);
+
+    while (line_end != std::string_view::npos) {
+        head.remove_prefix(line_end + 2);
+        line_end = head.find("\r\n");
+        auto line = head.substr(0, line_end);
+        auto colon = line.find(':');
+        if (colon == std::string_view::npos) continue;
+        headers.emplace(std::string(trim(line.substr(0, colon))), std::string(trim(line.substr(colon + 1))));
+    }
+    return first_line;
+}
+
+std::size_t parse_size(std::string_view s, int base) {
+    return std::strtoull(std::string(trim(s)).c_str(), nullptr, base);
+}
+} // namespace
+
+bool http::iequals(std::string_view a, std::string_view b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+               return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+           });
+}
+
+http::ParseStatus http::parse_request_head(std::string_view data, httplib::Request &req, std::size_t &consumed) {
+    auto head_end = find_head_end(data);
+    if (head_end == 0) {
+        return data.size() > kHeadLimit ? ParseStatus::ERROR : ParseStatus::INCOMPLETE;
+    }
+
+    auto request_line = parse_fields(data.substr(0, head_end - 2), req.headers);
+
+    auto first = request_line.find(' ');
+    auto last = request_line.rfind(' ');
+    if (first == std::string_view::npos || first == last) return ParseStatus::ERROR;
+    req.method = std::string(request_line.substr(0, first));
+    req.target = std::string(request_line.substr(first + 1, last - first - 1));
+    req.version = std::string(request_line.substr(last + 1));
+    if (req.version != "HTTP/1.1" && req.version != "HTTP/1.0") return ParseStatus::ERROR;
+
+    // 与 httplib 相同, 去掉片段后拆分路径与查询参数
+    auto fragment = req.target.find('#');
+    if (fragment != std::string::npos) req.target.erase(fragment);
+    auto query = req.target.find('?');
+    req.path = httplib::decode_path_component(req.target.substr(0, query));
+    if (query != std::string::npos) {
+        httplib::detail::parse_query_text(req.target.substr(query + 1), req.params);
+    }
+
+    consumed = head_end;
+    return ParseStatus::COMPLETE;
+}
+
+http::ParseStatus http::parse_response_head(std::string_view data, ResponseHead &head, std::size_t &consumed) {
+    auto head_end = find_head_end(data);
+    if (head_end == 0) {
+        return data.size() > kHeadLimit ? ParseStatus::ERROR : ParseStatus::INCOMPLETE;
+    }
+
+    auto status_line = parse_fields(data.substr(0, head_end - 2), head.headers);
+    auto space = status_line.find(' ');
+    if (space == std::string_view::npos) return ParseStatus::ERROR;
+    head.status = static_cast<int>(parse_size(status_line.substr(space + 1, 3), 10));
+    head.keep_alive = status_line.substr(0, space) == "HTTP/1.1";
+
+    for (const auto &[key, value] : head.headers) {
+        if (iequals(key, "Content-Length")) {
+            head.has_length = true;
+            head.content_length = parse_size(value, 10);
+        } else if (iequals(key, "Transfer-Encoding")) {
+            head.chunked = value.find("chunked") != std::string::npos;
+        } else if (iequals(key, "Connection")) {
+            head.keep_alive = !iequals(value, "close");
+        }
+    }
+    // 1xx/204/304 没有响应体, 其余无长度的非分块响应以连接关闭界定
+    if (head.status < 200 || head.status == 204 || head.status == 304) {
+        head.chunked = false;
+        head.has_length = true;
+        head.content_length = 0;
+    } else if (!head.chunked && !head.has_length) {
+        head.keep_alive = false;
+    }
+
+    consumed = head_end;
+    return ParseStatus::COMPLETE;
+}
+
+http::ParseStatus http::ChunkedDecoder::feed(std::string_view in, std::string &out, std::size_t &consumed) {
+    auto total = in.size();
+    while (!in.empty() && state_ != State::DONE) {
+        switch (state_) {
+        case State::SIZE:
+        case State::TRAILER: {
+            auto line_end = in.find('\n');
+            if (line_end == std::string_view::npos) {
+                line_.append(in);
+                in = {};
+                if (line_.size() > kHeadLimit) return ParseStatus::ERROR;
+                break;
+            }
+            line_.append(in.substr(0, line_end + 1));
+            in.remove_prefix(line_end + 1);
+
+            auto line = trim(std::string_view(line_));
+            if (state_ == State::SIZE) {
+                remaining_ = parse_size(line.substr(0, line.find(';')), 16);
+                state_ = remaining_ == 0 ? State::TRAILER : State::DATA;
+            } else if (line.empty()) {
+                state_ = State::DONE;
+            }
+            line_.clear();
+            break;
+        }
+        case State::DATA: {
+            auto n = std::min(remaining_, in.size());
+            out.append(in.substr(0, n));
+            in.remove_prefix(n);
+            remaining_ -= n;
+            if (remaining_ == 0) {
+                state_ = State::DATA_CRLF;
+                remaining_ = 2;
+            }
+            break;
+        }
+        case State::DATA_CRLF: {
+            auto n = std::min(remaining_, in.size());
+            in.remove_prefix(n);
+            remaining_ -= n;
+            if (remaining_ == 0) state_ = State::SIZE;
+            break;
+        }
+        default: break;
+        }
+    }
+
+    consumed = total - in.size();
+    return state_ == State::DONE ? ParseStatus::COMPLETE : ParseStatus::INCOMPLETE;
+}
+
+http::ResponseBodyReader::ResponseBodyReader(const ResponseHead &head) :
+    head_(head) {
+}
+
+http::ParseStatus http::ResponseBodyReader::feed(std::string_view in, std::string &body) {
+    if (head_.chunked) {
+        std::size_t consumed{};
+        return chunked_.feed(in, body, consumed);
+    }
+    if (head_.has_length) {
+        body.append(in.substr(0, head_.content_length - std::min(body.size(), head_.content_length)));
+        return body.size() >= head_.content_length ? ParseStatus::COMPLETE : ParseStatus::INCOMPLETE;
+    }
+    body.append(in);
+    return ParseStatus::INCOMPLETE;
+}
+
+http::ParseStatus http::ResponseBodyReader::finish_on_eof() const {
+    return !head_.chunked && !head_.has_length ? ParseStatus::COMPLETE : ParseStatus::ERROR;
+}
+
+bool http::keep_alive_requested(const httplib::Request &req) {
+    auto connection = req.get_header_value("Connection");
+    if (req.version == "HTTP/1.0") {
+        return iequals(connection, "keep-alive");
+    }
+    return !iequals(connection, "close");
+}
+
+std::string http::build_upstream_request(const httplib::Request &req, bool keep_alive) {
+    std::string out = std::format("GET {} HTTP/1.1\r\n", req.target);
+    for (const auto &[key, value] : req.headers) {
+        if (iequals(key, "Connection") || iequals(key, "Keep-Alive")
+            || iequals(key, "Content-Length") || iequals(key, "Transfer-Encoding")) {
+            continue;
+        }
+        out.append(key).append(": ").append(value).append("\r\n");
+    }
+    out.append(keep_alive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n");
+    return out;
+}
+
+std::string http::serialize_response(const httplib::Request &req, const httplib::Response &res, bool keep_alive) {
+    auto status = res.status == -1 ? httplib::StatusCode::OK_200 : res.status;
+    std::string out = std::format("HTTP/1.1 {} {}\r\n", status, httplib::status_message(status));
+
+    for (const auto &[key, value] : res.headers) {
+        if (iequals(key, "Content-Length") || iequals(key, "Connection")) continue;
+        out.append(key).append(": ").append(value).append("\r\n");
+    }
+    if (!res.body.empty() && !res.has_header("Content-Type")) {
+        out.append("Content-Type: text/plain\r\n");
+    }
+    // 与 AsyncLoop 实际执行的限制一致
+    out.append(keep_alive ? std::format("Keep-Alive: timeout={}, max={}\r\n", CPPHTTPLIB_KEEPALIVE_TIMEOUT_SECOND, CPPHTTPLIB_KEEPALIVE_MAX_COUNT)
+                          : "Connection: close\r\n");
+    out.append(std::format("Content-Length: {}\r\n\r\n", res.body.size()));
+
+    if (req.method != "HEAD") {
+        out.append(res.body);
+    }
+    return out;
+}
+
+std::string http::serialize_stream_head(const httplib::Response &res) {
+    auto status = res.status == -1 ? httplib::StatusCode::OK_200 : res.status;
+    std::string out = std::format("HTTP/1.1 {} {}\r\n", status, httplib::status_message(status));
+
+    for (const auto &[key, value] : res.headers) {
+        if (iequals(key, "Content-Length") || iequals(key, "Connection")) continue;
+        out.append(key).append(": ").append(value).append("\r\n");
+    }
+    out.append("Connection: close\r\n\r\n");
+    return out;
+}
@@ -0,0 +1,111 @@
+// http_codec.h
+#pragma once
+
+/**
+ * ************************************************************************
+ *
+ * @file http_codec.h
+ * @author xiunneg
+ * @brief  绕过 httplib 收发时使用的 HTTP/1.1 编解码,
+ *         请求与响应仍以 httplib::Request/httplib::Response 表示,以便复用同一套路由处理函数
+ * ************************************************************************
+ * @copyright Copyright (c) 2025 xiunneg
+ * ************************************************************************
+ */
+
+#include "httplib.h"
+
+#include <string>
+#include <string_view>
+
+namespace xiunneg::http {
+
+enum class ParseStatus {
+    INCOMPLETE = 1, // 需要更多数据
+    COMPLETE,       // 解析完成
+    ERROR           // 格式错误
+};
+
+/**
+ * ************************************************************************
+ * @brief 解析请求行与请求头,填充 method/target/path/params/version/headers
+ *
+ * @param[in] data  已收到的数据
+ * @param[out] req  请求
+ * @param[out] consumed  请求头长度(含结尾空行), 仅在 COMPLETE 时有效
+ *
+ * @return 解析状态
+ * ************************************************************************
+ */
+ParseStatus parse_request_head(std::string_view data, httplib::Request &req, std::size_t &consumed);
+
+// 上游响应头
+struct ResponseHead {
+    int status = 0;
+    bool chunked = false;
+    bool has_length = false;
+    std::size_t content_length = 0;
+    bool keep_alive = true; // 上游是否允许复用连接
+    httplib::Headers headers;
+};
+
+ParseStatus parse_response_head(std::string_view data, ResponseHead &head, std::size_t &consumed);
+
+// 增量解码分块编码的响应体
+class ChunkedDecoder {
+private:
+    enum class State {
+        SIZE,
+        DATA,
+        DATA_CRLF,
+        TRAILER,
+        DONE
+    };
+
+    State state_ = State::SIZE;
+    std::size_t remaining_ = 0;
+    std::string line_;
+
+public:
+    /**
+     * ************************************************************************
+     * @brief 追加输入,解码后的数据追加到 out
+     *
+     * @param[in] in  输入
+     * @param[out] out  解码结果
+     * @param[out] consumed  本次消费的字节数, 结束后剩余的数据不属于本响应
+     *
+     * @return 解析状态
+     * ************************************************************************
+     */
+    ParseStatus feed(std::string_view in, std::string &out, std::size_t &consumed);
+};
+
+// 按 Content-Length / 分块编码 / 连接关闭 三种方式收取响应体
+class ResponseBodyReader {
+private:
+    ResponseHead head_;
+    ChunkedDecoder chunked_;
+
+public:
+    explicit ResponseBodyReader(const ResponseHead &head);
+
+    ParseStatus feed(std::string_view in, std::string &body);
+    // 上游关闭连接, 仅以连接关闭界定的响应体视为完整
+    ParseStatus finish_on_eof() const;
+};
+
+bool iequals(std::string_view a, std::string_view b);
+
+// 客户端是否要求保持连接
+bool keep_alive_requested(const httplib::Request &req);
+
+// 构造转发给上游的 GET 请求, 逐跳头部由本连接重新声明
+std::string build_upstream_request(const httplib::Request &req, bool keep_alive);
+
+// 序列化响应, 与 httplib::Server 的默认头部保持一致
+std::string serialize_response(const httplib::Request &req, const httplib::Response &res, bool keep_alive);
+
+// 序列化流式响应头(如 SSE), 不带 Content-Length, 响应体以连接关闭结束
+std::string serialize_stream_head(const httplib::Response &res);
+} // namespace xiunneg::http
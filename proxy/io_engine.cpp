@@ -0,0 +1,670 @@
+// io_engine.cpp
+#include "io_engine.h"
+
+#include <stdexcept>
+
+#ifdef __linux__
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <unordered_map>
+
+#include <unistd.h>
+#include <linux/io_uring.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#endif
+
+using namespace xiunneg;
+
+BufferPool::BufferPool(std::size_t count, std::size_t buffer_size) :
+    buffer_size_(buffer_size),
+    storage_(count * buffer_size) {
+    free_list_.reserve(count);
+    for (std::size_t i = count; i > 0; --i) {
+        free_list_.push_back(static_cast<int>(i - 1));
+    }
+}
+
+BufferPool::Buffer BufferPool::acquire() {
+    // 池耗尽时退化为临时缓冲区
+    if (free_list_.empty()) {
+        return Buffer{.data = new char[buffer_size_], .size = buffer_size_, .index = -1};
+    }
+    auto index = free_list_.back();
+    free_list_.pop_back();
+    return Buffer{.data = data(index), .size = buffer_size_, .index = registered_ ? index : -1};
+}
+
+void BufferPool::release(const Buffer &buffer) {
+    if (buffer.data == nullptr) return;
+    if (buffer.data < storage_.data() || buffer.data >= storage_.data() + storage_.size()) {
+        delete[] buffer.data;
+        return;
+    }
+    free_list_.push_back(static_cast<int>((buffer.data - storage_.data()) / buffer_size_));
+}
+
+std::size_t BufferPool::count() const {
+    return storage_.size() / buffer_size_;
+}
+
+std::size_t BufferPool::buffer_size() const {
+    return buffer_size_;
+}
+
+char *BufferPool::data(int index) {
+    return storage_.data() + static_cast<std::size_t>(index) * buffer_size_;
+}
+
+void BufferPool::set_registered(bool registered) {
+    registered_ = registered;
+}
+
+bool BufferPool::registered() const {
+    return registered_;
+}
+
+IoEngine::IoEngine(const Config &config) :
+    buffers_(config.buffer_count, config.buffer_size) {
+}
+
+BufferPool &IoEngine::buffers() {
+    return buffers_;
+}
+
+const BufferPool &IoEngine::buffers() const {
+    return buffers_;
+}
+
+std::string_view IoEngine::kind_name(Kind kind) {
+    switch (kind) {
+    case Kind::EPOLL: return "epoll";
+    case Kind::IO_URING: return "io_uring";
+    default: return "unknown";
+    }
+}
+
+#ifdef __linux__
+namespace {
+class EpollEngine final : public IoEngine {
+private:
+    enum class OpType {
+        NONE,
+        ACCEPT,
+        RECV,
+        CONNECT,
+        SEND
+    };
+
+    struct PendingOp {
+        OpType type = OpType::NONE;
+        char *data = nullptr;
+        std::size_t size = 0;
+        Callback cb;
+    };
+
+    struct FdState {
+        PendingOp read;
+        PendingOp write;
+        uint32_t events = 0;
+    };
+
+    int epoll_fd_;
+    int event_fd_;
+    std::unordered_map<int, FdState> fds_;
+    std::vector<std::pair<Callback, int>> ready_; // 已完成待分发的回调
+
+public:
+    explicit EpollEngine(const Config &config) :
+        IoEngine(config) {
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (epoll_fd_ < 0 || event_fd_ < 0) {
+            throw std::runtime_error(std::string("EpollEngine 初始化失败: ") + std::strerror(errno));
+        }
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = event_fd_;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, event_fd_, &ev);
+    }
+
+    ~EpollEngine() override {
+        ::close(event_fd_);
+        ::close(epoll_fd_);
+    }
+
+    Kind kind() const override {
+        return Kind::EPOLL;
+    }
+
+    void accept(int listen_fd, Callback cb) override {
+        submit(listen_fd, PendingOp{.type = OpType::ACCEPT, .cb = std::move(cb)});
+    }
+
+    void connect(int fd, const sockaddr_storage &addr, uint32_t addr_len, Callback cb) override {
+        if (::connect(fd, reinterpret_cast<const sockaddr *>(&addr), addr_len) == 0) {
+            ready_.emplace_back(std::move(cb), 0);
+        } else if (errno == EINPROGRESS) {
+            park(fd, PendingOp{.type = OpType::CONNECT, .cb = std::move(cb)});
+        } else {
+            ready_.emplace_back(std::move(cb), -errno);
+        }
+    }
+
+    void recv(int fd, const BufferPool::Buffer &buffer, Callback cb) override {
+        submit(fd, PendingOp{.type = OpType::RECV, .data = buffer.data, .size = buffer.size, .cb = std::move(cb)});
+    }
+
+    void send(int fd, const char *data, std::size_t size, int, Callback cb) override {
+        submit(fd, PendingOp{.type = OpType::SEND, .data = const_cast<char *>(data), .size = size, .cb = std::move(cb)});
+    }
+
+    void close(int fd) override {
+        auto it = fds_.find(fd);
+        if (it != fds_.end()) {
+            if (it->second.read.cb) ready_.emplace_back(std::move(it->second.read.cb), -ECANCELED);
+            if (it->second.write.cb) ready_.emplace_back(std::move(it->second.write.cb), -ECANCELED);
+            if (it->second.events) epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+            fds_.erase(it);
+        }
+        ::close(fd);
+    }
+
+    void poll(int timeout_ms) override {
+        dispatch_ready();
+
+        epoll_event events[256];
+        auto n = epoll_wait(epoll_fd_, events, 256, ready_.empty() ? timeout_ms : 0);
+        for (int i = 0; i < n; ++i) {
+            auto fd = events[i].data.fd;
+            if (fd == event_fd_) {
+                uint64_t value;
+                while (::read(event_fd_, &value, sizeof(value)) > 0) {
+                }
+                continue;
+            }
+            on_event(fd, events[i].events);
+        }
+
+        dispatch_ready();
+    }
+
+    void wake() override {
+        uint64_t value = 1;
+        [[maybe_unused]] auto n = ::write(event_fd_, &value, sizeof(value));
+    }
+
+private:
+    // 立即尝试一次,未就绪时挂起等待事件
+    void submit(int fd, PendingOp op) {
+        auto result = perform(fd, op);
+        if (result == -EAGAIN || result == -EWOULDBLOCK) {
+            park(fd, std::move(op));
+        } else {
+            ready_.emplace_back(std::move(op.cb), result);
+        }
+    }
+
+    int perform(int fd, const PendingOp &op) {
+        ssize_t n = -1;
+        switch (op.type) {
+        case OpType::ACCEPT: n = ::accept4(fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC); break;
+        case OpType::RECV: n = ::recv(fd, op.data, op.size, 0); break;
+        case OpType::SEND: n = ::send(fd, op.data, op.size, MSG_NOSIGNAL); break;
+        case OpType::CONNECT: {
+            int error = 0;
+            socklen_t len = sizeof(error);
+            getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len);
+            return -error;
+        }
+        default: return -EINVAL;
+        }
+        return n >= 0 ? static_cast<int>(n) : -errno;
+    }
+
+    void park(int fd, PendingOp op) {
+        auto &state = fds_[fd];
+        if (op.type == OpType::ACCEPT || op.type == OpType::RECV) {
+            state.read = std::move(op);
+        } else {
+            state.write = std::move(op);
+        }
+        update_interest(fd, state);
+    }
+
+    void update_interest(int fd, FdState &state) {
+        uint32_t events = (state.read.cb ? uint32_t(EPOLLIN) : 0u) | (state.write.cb ? uint32_t(EPOLLOUT) : 0u);
+        if (events == state.events) return;
+
+        epoll_event ev{};
+        ev.events = events;
+        ev.data.fd = fd;
+        if (state.events == 0) {
+            epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev);
+        } else if (events == 0) {
+            epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+        } else {
+            epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &ev);
+        }
+        state.events = events;
+    }
+
+    void on_event(int fd, uint32_t events) {
+        auto it = fds_.find(fd);
+        if (it == fds_.end()) return;
+        auto &state = it->second;
+
+        auto try_complete = [this, fd](PendingOp &op) {
+            if (!op.cb) return;
+            auto result = perform(fd, op);
+            if (result == -EAGAIN || result == -EWOULDBLOCK) return;
+            ready_.emplace_back(std::move(op.cb), result);
+            op = PendingOp{};
+        };
+
+        if (events & (EPOLLIN | EPOLLERR | EPOLLHUP)) try_complete(state.read);
+        if (events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) try_complete(state.write);
+
+        update_interest(fd, state);
+        if (state.events == 0) {
+            fds_.erase(it);
+        }
+    }
+
+    void dispatch_ready() {
+        while (!ready_.empty()) {
+            std::vector<std::pair<Callback, int>> batch;
+            batch.swap(ready_);
+            for (auto &[cb, result] : batch) {
+                cb(result);
+            }
+        }
+    }
+};
+
+class UringEngine final : public IoEngine {
+private:
+    struct Op {
+        Callback cb;
+        sockaddr_storage addr;
+        __kernel_timespec ts;
+        Op *prev = nullptr; // 在途链表
+        Op *next = nullptr;
+    };
+
+    int ring_fd_ = -1;
+    io_uring_params params_{};
+
+    void *sq_ptr_ = MAP_FAILED;
+    void *cq_ptr_ = MAP_FAILED;
+    std::size_t sq_size_ = 0;
+    std::size_t cq_size_ = 0;
+    io_uring_sqe *sqes_ = static_cast<io_uring_sqe *>(MAP_FAILED);
+
+    unsigned *sq_head_;
+    unsigned *sq_tail_;
+    unsigned *sq_mask_;
+    unsigned *sq_array_;
+    unsigned *cq_head_;
+    unsigned *cq_tail_;
+    unsigned *cq_mask_;
+    io_uring_cqe *cqes_;
+
+    unsigned to_submit_ = 0; // 已填充未提交的 SQE 数
+
+    int event_fd_ = -1;
+    uint64_t event_value_ = 0;
+    Op wake_op_; // 常驻的 eventfd 读操作
+    // 在途超时中最早的一个, 被更早的超时取代后旧的到期时只多唤醒一次
+    Op *timeout_op_ = nullptr;
+    std::chrono::steady_clock::time_point timeout_deadline_;
+
+    // 在途操作(不含 wake_op_), 析构时据此取消并回收
+    Op *inflight_ = nullptr;
+    // 析构时取消与等待使用, 完成时不回调
+    bool closing_ = false;
+    bool wake_pending_ = false;
+    bool drain_expired_ = false;
+    Op cancel_op_;
+    Op drain_timeout_op_;
+
+public:
+    explicit UringEngine(const Config &config) :
+        IoEngine(config) {
+        ring_fd_ = static_cast<int>(syscall(__NR_io_uring_setup, config.queue_depth, &params_));
+        if (ring_fd_ < 0) {
+            throw std::runtime_error(std::string("io_uring_setup 失败: ") + std::strerror(errno));
+        }
+        // ACCEPT/CONNECT/SEND/RECV 需要 5.7 以上内核, 以 FAST_POLL 特性判断
+        if (!(params_.features & IORING_FEAT_FAST_POLL)) {
+            release();
+            throw std::runtime_error("io_uring 内核版本过旧");
+        }
+
+        sq_size_ = params_.sq_off.array + params_.sq_entries * sizeof(unsigned);
+        cq_size_ = params_.cq_off.cqes + params_.cq_entries * sizeof(io_uring_cqe);
+        if (params_.features & IORING_FEAT_SINGLE_MMAP) {
+            sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+        }
+
+        sq_ptr_ = mmap(nullptr, sq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+        if (params_.features & IORING_FEAT_SINGLE_MMAP) {
+            cq_ptr_ = sq_ptr_;
+        } else {
+            cq_ptr_ = mmap(nullptr, cq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+        }
+        sqes_ = static_cast<io_uring_sqe *>(mmap(nullptr, params_.sq_entries * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE,
+                                                 MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES));
+        if (sq_ptr_ == MAP_FAILED || cq_ptr_ == MAP_FAILED || sqes_ == MAP_FAILED) {
+            release();
+            throw std::runtime_error("io_uring mmap 失败");
+        }
+
+        auto *sq = static_cast<char *>(sq_ptr_);
+        sq_head_ = reinterpret_cast<unsigned *>(sq + params_.sq_off.head);
+        sq_tail_ = reinterpret_cast<unsigned *>(sq + params_.sq_off.tail);
+        sq_mask_ = reinterpret_cast<unsigned *>(sq + params_.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned *>(sq + params_.sq_off.array);
+        auto *cq = static_cast<char *>(cq_ptr_);
+        cq_head_ = reinterpret_cast<unsigned *>(cq + params_.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned *>(cq + params_.cq_off.tail);
+        cq_mask_ = reinterpret_cast<unsigned *>(cq + params_.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params_.cq_off.cqes);
+
+        register_buffers();
+
+        event_fd_ = eventfd(0, EFD_CLOEXEC);
+        arm_wake();
+    }
+
+    ~UringEngine() override {
+        if (ring_fd_ >= 0) cancel_inflight();
+        release();
+        if (event_fd_ >= 0) ::close(event_fd_);
+    }
+
+    Kind kind() const override {
+        return Kind::IO_URING;
+    }
+
+    void accept(int listen_fd, Callback cb) override {
+        auto *sqe = next_sqe(make_op(std::move(cb)));
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->fd = listen_fd;
+        sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+        commit();
+    }
+
+    void connect(int fd, const sockaddr_storage &addr, uint32_t addr_len, Callback cb) override {
+        auto *op = make_op(std::move(cb));
+        std::memcpy(&op->addr, &addr, sizeof(addr));
+        auto *sqe = next_sqe(op);
+        sqe->opcode = IORING_OP_CONNECT;
+        sqe->fd = fd;
+        sqe->addr = reinterpret_cast<uint64_t>(&op->addr);
+        sqe->off = addr_len;
+        commit();
+    }
+
+    void recv(int fd, const BufferPool::Buffer &buffer, Callback cb) override {
+        auto *sqe = next_sqe(make_op(std::move(cb)));
+        sqe->fd = fd;
+        sqe->addr = reinterpret_cast<uint64_t>(buffer.data);
+        sqe->len = static_cast<uint32_t>(buffer.size);
+        if (buffer.index >= 0) {
+            sqe->opcode = IORING_OP_READ_FIXED;
+            sqe->buf_index = static_cast<uint16_t>(buffer.index);
+        } else {
+            sqe->opcode = IORING_OP_RECV;
+        }
+        commit();
+    }
+
+    void send(int fd, const char *data, std::size_t size, int buffer_index, Callback cb) override {
+        auto *sqe = next_sqe(make_op(std::move(cb)));
+        sqe->fd = fd;
+        sqe->addr = reinterpret_cast<uint64_t>(data);
+        sqe->len = static_cast<uint32_t>(size);
+        if (buffer_index >= 0) {
+            sqe->opcode = IORING_OP_WRITE_FIXED;
+            sqe->buf_index = static_cast<uint16_t>(buffer_index);
+        } else {
+            sqe->opcode = IORING_OP_SEND;
+            sqe->msg_flags = MSG_NOSIGNAL;
+        }
+        commit();
+    }
+
+    void close(int fd) override {
+        // 内核持有文件引用, 先 shutdown 让挂起的 accept/recv 立即完成
+        ::shutdown(fd, SHUT_RDWR);
+        ::close(fd);
+    }
+
+    void poll(int timeout_ms) override {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+        if (timeout_ms >= 0 && (timeout_op_ == nullptr || deadline < timeout_deadline_)) {
+            auto *op = make_op(nullptr);
+            op->ts.tv_sec = timeout_ms / 1000;
+            op->ts.tv_nsec = static_cast<long long>(timeout_ms % 1000) * 1000000;
+            auto *sqe = next_sqe(op);
+            sqe->opcode = IORING_OP_TIMEOUT;
+            sqe->addr = reinterpret_cast<uint64_t>(&op->ts);
+            sqe->len = 1;
+            commit();
+            timeout_op_ = op;
+            timeout_deadline_ = deadline;
+        }
+
+        // 一次系统调用完成批量提交与等待
+        enter(cq_ready() ? 0 : 1);
+        reap();
+    }
+
+    void wake() override {
+        uint64_t value = 1;
+        [[maybe_unused]] auto n = ::write(event_fd_, &value, sizeof(value));
+    }
+
+private:
+    Op *make_op(Callback cb) {
+        auto *op = new Op{};
+        op->cb = std::move(cb);
+        op->next = inflight_;
+        if (inflight_) inflight_->prev = op;
+        inflight_ = op;
+        return op;
+    }
+
+    void free_op(Op *op) {
+        if (op->prev) op->prev->next = op->next;
+        else inflight_ = op->next;
+        if (op->next) op->next->prev = op->prev;
+        delete op;
+    }
+
+    /**
+     * ************************************************************************
+     * @brief 关闭 ring 前以 ASYNC_CANCEL 取消全部在途操作并等待完成, 回收 Op 而不回调:
+     *        此时协程帧已随事件循环销毁, 且 ring 关闭后内核异步退出期间
+     *        仍可能写入即将释放的注册缓冲区; 无法取消的操作最多等待 1 秒
+     * ************************************************************************
+     */
+    void cancel_inflight() {
+        closing_ = true;
+        wake_pending_ = true;
+        try {
+            // 提交队列满时 next_sqe 会收割完成项并回收 Op, 先取出全部目标
+            std::vector<uint64_t> targets{reinterpret_cast<uint64_t>(&wake_op_)};
+            for (auto *op = inflight_; op != nullptr; op = op->next) {
+                targets.push_back(reinterpret_cast<uint64_t>(op));
+            }
+            for (auto target : targets) {
+                auto *sqe = next_sqe(&cancel_op_);
+                sqe->opcode = IORING_OP_ASYNC_CANCEL;
+                sqe->addr = target;
+                commit();
+            }
+
+            drain_timeout_op_.ts.tv_sec = 1;
+            auto *sqe = next_sqe(&drain_timeout_op_);
+            sqe->opcode = IORING_OP_TIMEOUT;
+            sqe->addr = reinterpret_cast<uint64_t>(&drain_timeout_op_.ts);
+            sqe->len = 1;
+            commit();
+
+            while ((inflight_ != nullptr || wake_pending_) && !drain_expired_) {
+                enter(cq_ready() ? 0 : 1);
+                reap();
+            }
+        } catch (const std::runtime_error &) {
+            // io_uring_enter 失败, 直接关闭 ring
+        }
+        // 超时仍未完成的操作由内核在关闭 ring 时取消, Op 不再被访问
+        while (inflight_ != nullptr) free_op(inflight_);
+    }
+
+    void release() {
+        if (sqes_ != MAP_FAILED) munmap(sqes_, params_.sq_entries * sizeof(io_uring_sqe));
+        if (cq_ptr_ != MAP_FAILED && cq_ptr_ != sq_ptr_) munmap(cq_ptr_, cq_size_);
+        if (sq_ptr_ != MAP_FAILED) munmap(sq_ptr_, sq_size_);
+        sqes_ = static_cast<io_uring_sqe *>(MAP_FAILED);
+        sq_ptr_ = cq_ptr_ = MAP_FAILED;
+        if (ring_fd_ >= 0) ::close(ring_fd_);
+        ring_fd_ = -1;
+    }
+
+    void register_buffers() {
+        std::vector<iovec> iovecs(buffers_.count());
+        for (std::size_t i = 0; i < iovecs.size(); ++i) {
+            iovecs[i].iov_base = buffers_.data(static_cast<int>(i));
+            iovecs[i].iov_len = buffers_.buffer_size();
+        }
+        // 受 RLIMIT_MEMLOCK 限制可能失败, 失败时以普通 RECV/SEND 工作
+        auto ret = syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_BUFFERS, iovecs.data(), iovecs.size());
+        buffers_.set_registered(ret == 0);
+    }
+
+    void arm_wake() {
+        wake_op_.cb = nullptr;
+        auto *sqe = next_sqe(&wake_op_);
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = event_fd_;
+        sqe->addr = reinterpret_cast<uint64_t>(&event_value_);
+        sqe->len = sizeof(event_value_);
+        commit();
+    }
+
+    io_uring_sqe *next_sqe(Op *op) {
+        auto head = std::atomic_ref<unsigned>(*sq_head_).load(std::memory_order_acquire);
+        auto tail = *sq_tail_;
+        // 提交队列已满, 先把积压的 SQE 交给内核
+        while (tail - head >= params_.sq_entries) {
+            enter(0);
+            head = std::atomic_ref<unsigned>(*sq_head_).load(std::memory_order_acquire);
+        }
+        auto index = tail & *sq_mask_;
+        auto *sqe = &sqes_[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->user_data = reinterpret_cast<uint64_t>(op);
+        sq_array_[index] = index;
+        return sqe;
+    }
+
+    void commit() {
+        std::atomic_ref<unsigned>(*sq_tail_).store(*sq_tail_ + 1, std::memory_order_release);
+        ++to_submit_;
+    }
+
+    void enter(unsigned wait_nr) {
+        for (;;) {
+            auto flags = wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0u;
+            auto ret = syscall(__NR_io_uring_enter, ring_fd_, to_submit_, wait_nr, flags, nullptr, 0);
+            if (ret >= 0) {
+                to_submit_ -= static_cast<unsigned>(ret);
+                return;
+            }
+            if (errno == EINTR) continue;
+            if (errno == EBUSY || errno == EAGAIN) {
+                // 完成队列积压, 先收割再提交
+                reap();
+                wait_nr = 0;
+                continue;
+            }
+            throw std::runtime_error(std::string("io_uring_enter 失败: ") + std::strerror(errno));
+        }
+    }
+
+    bool cq_ready() const {
+        return *cq_head_ != std::atomic_ref<unsigned>(*cq_tail_).load(std::memory_order_acquire);
+    }
+
+    void reap() {
+        std::vector<std::pair<Op *, int>> completions;
+        auto head = *cq_head_;
+        auto tail = std::atomic_ref<unsigned>(*cq_tail_).load(std::memory_order_acquire);
+        while (head != tail) {
+            auto &cqe = cqes_[head & *cq_mask_];
+            completions.emplace_back(reinterpret_cast<Op *>(cqe.user_data), cqe.res);
+            ++head;
+        }
+        std::atomic_ref<unsigned>(*cq_head_).store(head, std::memory_order_release);
+
+        for (auto [op, result] : completions) {
+            if (closing_) {
+                // 取消阶段只回收
+                if (op == &wake_op_) {
+                    wake_pending_ = false;
+                } else if (op == &drain_timeout_op_) {
+                    drain_expired_ = true;
+                } else if (op != &cancel_op_) {
+                    free_op(op);
+                }
+            } else if (op == &wake_op_) {
+                arm_wake();
+            } else if (!op->cb) {
+                // 超时操作
+                if (op == timeout_op_) timeout_op_ = nullptr;
+                free_op(op);
+            } else {
+                auto cb = std::move(op->cb);
+                free_op(op);
+                cb(result);
+            }
+        }
+    }
+};
+} // namespace
+#endif // __linux__
+
+bool IoEngine::supported() {
+#ifdef __linux__
+    return true;
+#else
+    return false;
+#endif
+}
+
+std::unique_ptr<IoEngine> IoEngine::create(const Config &config) {
+#ifdef __linux__
+    // 内核按 EPIPE 返回写关闭连接的错误, 不需要信号
+    std::signal(SIGPIPE, SIG_IGN);
+
+    if (config.kind == Kind::IO_URING) {
+        try {
+            return std::make_unique<UringEngine>(config);
+        } catch (const std::runtime_error &) {
+            // 回退 epoll
+        }
+    }
+    return std::make_unique<EpollEngine>(config);
+#else
+    return nullptr;
+#endif
+}
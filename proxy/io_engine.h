@@ -0,0 +1,123 @@
+// io_engine.h
+#pragma once
+
+/**
+ * ************************************************************************
+ *
+ * @file io_engine.h
+ * @author xiunneg
+ * @brief  仅支持 Linux 平台,完成式异步 I/O 引擎:
+ *         io_uring 实现使用注册缓冲区与批量提交,不可用时回退到 epoll 实现,
+ *         两者对上层暴露相同的 提交操作 -> 完成回调 接口。
+ *         引擎不是线程安全的,除 wake 外只能在调用 poll 的线程中使用
+ * ************************************************************************
+ * @copyright Copyright (c) 2025 xiunneg
+ * ************************************************************************
+ */
+
+#include <stdint.h>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+struct sockaddr_storage;
+
+namespace xiunneg {
+
+// 固定大小的缓冲区池, io_uring 引擎会将其注册到内核
+class BufferPool {
+public:
+    struct Buffer {
+        char *data = nullptr;
+        std::size_t size = 0;
+        int index = -1; // 注册缓冲区下标, -1 表示未注册的临时缓冲区
+    };
+
+private:
+    std::size_t buffer_size_;
+    std::vector<char> storage_;
+    std::vector<int> free_list_;
+    bool registered_ = false;
+
+public:
+    BufferPool(std::size_t count, std::size_t buffer_size);
+
+    Buffer acquire();
+    void release(const Buffer &buffer);
+
+    std::size_t count() const;
+    std::size_t buffer_size() const;
+    char *data(int index);
+
+    void set_registered(bool registered);
+    bool registered() const;
+};
+
+class IoEngine {
+public:
+    enum class Kind {
+        EPOLL = 1,
+        IO_URING
+    };
+
+    // 完成回调: >= 0 为字节数或新连接的 fd, < 0 为 -errno
+    using Callback = std::function<void(int result)>;
+
+    struct Config {
+        Kind kind = Kind::IO_URING;
+        unsigned queue_depth = 4096;         // 提交队列深度
+        std::size_t buffer_count = 1024;     // 缓冲区数量
+        std::size_t buffer_size = 16 * 1024; // 单个缓冲区大小
+    };
+
+protected:
+    BufferPool buffers_;
+
+public:
+    explicit IoEngine(const Config &config);
+    virtual ~IoEngine() = default;
+
+    IoEngine(const IoEngine &) = delete;
+    IoEngine &operator=(const IoEngine &) = delete;
+
+    /**
+     * ************************************************************************
+     * @brief 创建引擎, io_uring 不可用(内核过旧或被禁用)时回退到 epoll
+     *
+     * @param[in] config  引擎参数
+     *
+     * @return 引擎, 当前平台不支持时返回 nullptr
+     * ************************************************************************
+     */
+    static std::unique_ptr<IoEngine> create(const Config &config);
+    static bool supported();
+    static std::string_view kind_name(Kind kind);
+
+    virtual Kind kind() const = 0;
+
+    // 所有 fd 须为非阻塞套接字, 同一 fd 同时至多一个读方向(accept/recv)与一个写方向(connect/send)操作
+    virtual void accept(int listen_fd, Callback cb) = 0;
+    virtual void connect(int fd, const sockaddr_storage &addr, uint32_t addr_len, Callback cb) = 0;
+    virtual void recv(int fd, const BufferPool::Buffer &buffer, Callback cb) = 0;
+    virtual void send(int fd, const char *data, std::size_t size, int buffer_index, Callback cb) = 0;
+
+    // 关闭 fd, 该 fd 上未完成的操作以错误完成
+    virtual void close(int fd) = 0;
+
+    /**
+     * ************************************************************************
+     * @brief 提交积压的操作,等待并分发完成回调
+     *
+     * @param[in] timeout_ms  最长等待时间, -1 为一直等待直到 wake
+     * ************************************************************************
+     */
+    virtual void poll(int timeout_ms) = 0;
+
+    // 线程安全, 唤醒阻塞中的 poll
+    virtual void wake() = 0;
+
+    BufferPool &buffers();
+    const BufferPool &buffers() const;
+};
+} // namespace xiunneg
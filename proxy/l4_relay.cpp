@@ -0,0 +1,324 @@
+// l4_relay.cpp
+#include "l4_relay.h"
+
+#include <charconv>
+#include <format>
+#include <optional>
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#endif
+
+using namespace xiunneg;
+
+namespace {
+constexpr std::size_t kPreambleLimit = 64;
+
+// 协程被销毁时关闭尚未移交的 fd
+struct FdGuard {
+    EventLoop *loop;
+    int fd;
+
+    ~FdGuard() {
+        if (fd >= 0) loop->close_fd(fd);
+    }
+
+    int release() {
+        return std::exchange(fd, -1);
+    }
+};
+
+std::string peer_name(int fd) {
+#ifdef __linux__
+    sockaddr_storage addr{};
+    socklen_t len = sizeof(addr);
+    if (getpeername(fd, reinterpret_cast<sockaddr *>(&addr), &len) == 0) {
+        char ip[INET6_ADDRSTRLEN]{};
+        if (addr.ss_family == AF_INET) {
+            auto *addr4 = reinterpret_cast<sockaddr_in *>(&addr);
+            inet_ntop(AF_INET, &addr4->sin_addr, ip, sizeof(ip));
+            return std::format("{}:{}", ip, ntohs(addr4->sin_port));
+        }
+        if (addr.ss_family == AF_INET6) {
+            auto *addr6 = reinterpret_cast<sockaddr_in6 *>(&addr);
+            inet_ntop(AF_INET6, &addr6->sin6_addr, ip, sizeof(ip));
+            return std::format("[{}]:{}", ip, ntohs(addr6->sin6_port));
+        }
+    }
+#endif
+    return "unknown";
+}
+
+void shutdown_fd(int fd, bool both) {
+#ifdef __linux__
+    ::shutdown(fd, both ? SHUT_RDWR : SHUT_WR);
+#endif
+}
+} // namespace
+
+// 一条透传连接, 两个方向的搬运协程都结束后关闭
+struct L4Relay::Pipe {
+    EventLoop *loop;
+    std::shared_ptr<module::SimpleLoggerInterface> logger;
+    std::string peer;
+    int machine_no = 0;
+    int client_fd = -1;
+    int upstream_fd = -1;
+    uint64_t bytes_up = 0;   // 客户端 -> 上游
+    uint64_t bytes_down = 0; // 上游 -> 客户端
+    std::optional<EventLoop::Deadline> idle; // 空闲计时, 两个方向的收发共用, 到期时两端一并 shutdown
+
+    Pipe(EventLoop *owner, std::shared_ptr<module::SimpleLoggerInterface> log) :
+        loop(owner),
+        logger(std::move(log)) {
+    }
+
+    Pipe(const Pipe &) = delete;
+    Pipe &operator=(const Pipe &) = delete;
+
+    ~Pipe() {
+        bool timed_out = idle && idle->expired();
+        idle.reset();
+        loop->close_fd(client_fd);
+        loop->close_fd(upstream_fd);
+        SIMPLE_LOG_INFO(*logger, "{} L4 服务[{}] 断开{}, 上行 {} 字节, 下行 {} 字节", peer, machine_no, timed_out ? "(空闲超时)" : "", bytes_up, bytes_down);
+    }
+};
+
+L4Relay::L4Relay(const Config &config, Logger logger) :
+    config_(config),
+    logger_(logger),
+    limiter_(config.log_limit, logger),
+    loop_(config.engine) {
+}
+
+L4Relay::~L4Relay() {
+    stop();
+    loop_.clear_sessions();
+    for (auto &[port, listener] : listeners_) {
+        close_listener(*listener);
+    }
+    if (preamble_) close_listener(*preamble_);
+}
+
+bool L4Relay::supported() {
+    return IoEngine::supported();
+}
+
+void L4Relay::on_snapshot(const PortScanner::SnapshotPtr &snapshot) {
+    loop_.post([this, snapshot]() {
+        sync_listeners(*snapshot);
+    });
+}
+
+bool L4Relay::start() {
+    if (config_.preamble_port != 0) {
+        int fd = loop_.listen(config_.host, config_.preamble_port);
+        if (fd < 0) {
+            logger_->error(std::format("L4 前导路由绑定 {}:{} 失败", config_.host, config_.preamble_port));
+            return false;
+        }
+        preamble_ = std::make_shared<Listener>(Listener{.fd = fd, .port = config_.preamble_port});
+        loop_.spawn(accept_loop(preamble_, 0));
+        SIMPLE_LOG_INFO(*logger_, "L4 前导路由监听 {}:{}", config_.host, config_.preamble_port);
+    }
+
+    thread_ = std::thread([this]() {
+        SIMPLE_LOG_INFO(*logger_, "L4 透传启动, I/O 引擎: {}", IoEngine::kind_name(loop_.engine().kind()));
+        loop_.run();
+    });
+    return true;
+}
+
+void L4Relay::stop() {
+    loop_.stop();
+    if (thread_.joinable())
+        thread_.join();
+}
+
+module::LogLimiter &L4Relay::limiter() {
+    return limiter_;
+}
+
+std::chrono::milliseconds L4Relay::idle_timeout() const {
+    return std::chrono::seconds(config_.idle_timeout_sec);
+}
+
+void L4Relay::sync_listeners(const PortScanner::Snapshot &snapshot) {
+    const auto &ports = snapshot.ports;
+    ports_ = ports;
+    unix_paths_ = snapshot.unix_paths;
+    ipv6_only_ = snapshot.ipv6_only;
+    remotes_ = snapshot.remotes;
+    if (config_.listen_base == 0) return;
+
+    // 服务消失, 关闭其监听端口, 已建立的连接不受影响
+    std::erase_if(listeners_, [this, &ports](auto &item) {
+        if (ports.contains(item.first)) return false;
+        close_listener(*item.second);
+        logger_->info(std::format("L4 服务[{}] 下线, 关闭监听 {}", item.first - config_.base_port, item.second->port));
+        return true;
+    });
+
+    for (auto port : ports) {
+        if (port < config_.base_port || listeners_.contains(port)) continue;
+
+        int machine_no = port - config_.base_port;
+        int listen_port = config_.listen_base + machine_no;
+        if (listen_port > UINT16_MAX) {
+            logger_->warn(std::format("L4 服务[{}] 的监听端口 {} 超出范围", machine_no, listen_port));
+            continue;
+        }
+
+        int fd = loop_.listen(config_.host, static_cast<uint16_t>(listen_port));
+        if (fd < 0) {
+            logger_->error(std::format("L4 服务[{}] 绑定 {}:{} 失败", machine_no, config_.host, listen_port));
+            continue;
+        }
+        auto listener = std::make_shared<Listener>(Listener{.fd = fd, .port = static_cast<uint16_t>(listen_port)});
+        listeners_.emplace(port, listener);
+        loop_.spawn(accept_loop(listener, port));
+        logger_->info(std::format("L4 服务[{}] 上线, 监听 {}:{}", machine_no, config_.host, listen_port));
+    }
+}
+
+void L4Relay::close_listener(Listener &listener) {
+    if (!listener.open) return;
+    // 挂起中的 accept 以错误完成, 接受协程随之退出
+    listener.open = false;
+    loop_.close_fd(listener.fd);
+}
+
+coro::Task<> L4Relay::accept_loop(std::shared_ptr<Listener> listener, uint16_t upstream_port) {
+    for (;;) {
+        int fd = co_await coro::async_accept(loop_.engine(), listener->fd);
+        if (!listener->open) {
+            if (fd >= 0) loop_.close_fd(fd);
+            co_return;
+        }
+        if (fd < 0) continue;
+
+#ifdef __linux__
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+#endif
+        if (upstream_port == 0) {
+            loop_.spawn(read_preamble(fd));
+        } else {
+            loop_.spawn(relay(fd, upstream_port, {}));
+        }
+    }
+}
+
+coro::Task<> L4Relay::read_preamble(int client_fd) {
+    FdGuard client{&loop_, client_fd};
+    // 迟迟不发送前导的客户端到期断开, 须先于 client 析构
+    EventLoop::Deadline deadline{&loop_, client_fd};
+    deadline.arm(idle_timeout());
+    auto &engine = loop_.engine();
+
+    std::string line;
+    auto newline = std::string::npos;
+    while ((newline = line.find('\n')) == std::string::npos) {
+        if (line.size() > kPreambleLimit) {
+            SIMPLE_LOG_ERROR_LIMITED(limiter_, "L4 前导过长", "{} L4 前导过长", peer_name(client_fd));
+            co_return;
+        }
+        auto buffer = engine.buffers().acquire();
+        int n = co_await coro::async_recv(engine, client_fd, buffer);
+        if (n > 0) line.append(buffer.data, static_cast<std::size_t>(n));
+        engine.buffers().release(buffer);
+        if (n <= 0) co_return;
+    }
+
+    std::string_view text(line.data(), newline);
+    if (!text.empty() && text.back() == '\r') text.remove_suffix(1);
+
+    int machine_no{};
+    auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), machine_no);
+    if (ec != std::errc{} || end != text.data() + text.size()) {
+        SIMPLE_LOG_ERROR_LIMITED(limiter_, "L4 前导不是整数", "{} L4 前导[{}] 不是整数!", peer_name(client_fd), text);
+        co_return;
+    }
+
+    auto target_sevice = static_cast<int>(config_.base_port) + machine_no;
+    if (target_sevice < 0 || target_sevice > UINT16_MAX || !ports_.contains(static_cast<uint16_t>(target_sevice))) {
+        SIMPLE_LOG_ERROR_LIMITED(limiter_, std::format("L4 服务不存在 {}", machine_no), "{} L4 该服务[{}]不存在!", peer_name(client_fd), machine_no);
+        co_return;
+    }
+
+    deadline.cancel();
+    co_await relay(client.release(), static_cast<uint16_t>(target_sevice), line.substr(newline + 1));
+}
+
+coro::Task<> L4Relay::relay(int client_fd, uint16_t upstream_port, std::string pending) {
+    FdGuard client{&loop_, client_fd};
+    auto peer = peer_name(client_fd);
+    int machine_no = upstream_port - config_.base_port;
+
+    std::string error_msg;
+    int upstream_fd = -1;
+    if (auto it = unix_paths_.find(upstream_port); it != unix_paths_.end()) {
+        upstream_fd = co_await loop_.connect_unix(it->second, error_msg);
+    } else if (auto remote = remotes_.find(upstream_port); remote != remotes_.end()) {
+        upstream_fd = co_await loop_.connect_tcp(remote->second.host, remote->second.port, error_msg, idle_timeout());
+    } else {
+        std::string host = ipv6_only_.contains(upstream_port) ? "::1" : "127.0.0.1";
+        upstream_fd = co_await loop_.connect_tcp(host, upstream_port, error_msg, idle_timeout());
+    }
+    if (upstream_fd < 0) {
+        SIMPLE_LOG_ERROR_LIMITED(limiter_, std::format("L4 转发失败 {}", machine_no), "{} L4 转发服务[{}]失败! {}", peer, machine_no, error_msg);
+        co_return;
+    }
+
+    auto pipe = std::make_shared<Pipe>(&loop_, logger_);
+    pipe->peer = peer;
+    pipe->machine_no = machine_no;
+    pipe->client_fd = client.release();
+    pipe->upstream_fd = upstream_fd;
+    pipe->idle.emplace(&loop_, pipe->client_fd, upstream_fd);
+    SIMPLE_LOG_INFO(*logger_, "{} L4 -> 服务[{}]", peer, machine_no);
+
+    // 前导之后已收到的字节
+    if (!pending.empty()) {
+        if (!co_await loop_.send_all(upstream_fd, pending, -1, &*pipe->idle, idle_timeout())) co_return;
+        pipe->bytes_up += pending.size();
+    }
+
+    loop_.spawn(pump(pipe, false));
+    loop_.spawn(pump(pipe, true));
+}
+
+coro::Task<> L4Relay::pump(std::shared_ptr<Pipe> pipe, bool upstream_to_client) {
+    int from = upstream_to_client ? pipe->upstream_fd : pipe->client_fd;
+    int to = upstream_to_client ? pipe->client_fd : pipe->upstream_fd;
+    auto &bytes = upstream_to_client ? pipe->bytes_down : pipe->bytes_up;
+    auto &engine = loop_.engine();
+
+    for (;;) {
+        // 任一方向有数据都重新计时, 两个方向都空闲到期时 shutdown 两端, 挂起的收发随即结束
+        pipe->idle->arm(idle_timeout());
+        auto buffer = engine.buffers().acquire();
+        int n = co_await coro::async_recv(engine, from, buffer);
+        if (n <= 0) {
+            engine.buffers().release(buffer);
+            // 对端正常关闭时只半关闭另一端的写方向, 出错时两端都关闭
+            shutdown_fd(to, n < 0);
+            if (n < 0) shutdown_fd(from, true);
+            co_return;
+        }
+
+        // 读入的就是注册缓冲区, 原样写出
+        bool ok = co_await loop_.send_all(to, std::string_view(buffer.data, static_cast<std::size_t>(n)), buffer.index, &*pipe->idle, idle_timeout());
+        engine.buffers().release(buffer);
+        if (!ok) {
+            shutdown_fd(from, true);
+            shutdown_fd(to, true);
+            co_return;
+        }
+        bytes += static_cast<uint64_t>(n);
+    }
+}
@@ -0,0 +1,101 @@
+// l4_relay.h
+#pragma once
+
+/**
+ * ************************************************************************
+ *
+ * @file l4_relay.h
+ * @author xiunneg
+ * @brief  仅支持 Linux 平台,四层透传:不解析协议,在客户端与 base_port + machine_no 之间双向搬运字节。
+ *         两种入口:
+ *         1. 每台机器一个监听端口 listen_base + machine_no,随扫描器快照增删;
+ *         2. 前导路由端口,客户端先发送一行 "<machine_no>\n",其后的字节原样转发
+ * ************************************************************************
+ * @copyright Copyright (c) 2025 xiunneg
+ * ************************************************************************
+ */
+
+#include "coro.h"
+#include "event_loop.h"
+#include "port_scanner/port_scanner.h"
+#include "simple_log/log_limiter.h"
+#include "simple_log/simple_log.h"
+
+#include <stdint.h>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace xiunneg {
+
+class L4Relay {
+    using Logger = std::shared_ptr<module::SimpleLoggerInterface>;
+
+public:
+    struct Config {
+        std::string host = "0.0.0.0";
+        uint16_t base_port = 0;     // 基准端口, 上游端口 = base_port + machine_no
+        uint16_t listen_base = 0;   // 每台机器的监听端口 = listen_base + machine_no, 0 不开启
+        uint16_t preamble_port = 0; // 前导路由监听端口, 0 不开启
+        int idle_timeout_sec = 5;   // 两个方向都没有数据时断开, 同时作为连接上游与等待前导的超时, 秒
+        IoEngine::Config engine;
+        module::LogLimiter::Config log_limit; // 逐连接错误日志的限流
+    };
+
+private:
+    struct Listener {
+        int fd = -1;
+        uint16_t port = 0; // 监听端口
+        bool open = true;
+    };
+    struct Pipe;
+
+    Config config_;
+    Logger logger_;
+    module::LogLimiter limiter_; // 逐连接的错误日志按类别与服务号限流
+    EventLoop loop_;
+
+    // 以下仅事件循环线程访问
+    std::unordered_map<uint16_t, std::shared_ptr<Listener>> listeners_; // 上游端口 -> 监听
+    std::set<uint16_t> ports_;                                          // 最新快照中的上游端口
+    std::map<uint16_t, std::string> unix_paths_;                        // 经 Unix 域套接字访问的上游
+    std::set<uint16_t> ipv6_only_;                                      // 只在 IPv6 上监听的上游
+    std::map<uint16_t, PortScanner::RemoteEndpoint> remotes_;           // 远程上游
+    std::shared_ptr<Listener> preamble_;
+
+    std::thread thread_;
+
+public:
+    L4Relay(const Config &config, Logger logger);
+    ~L4Relay();
+
+    L4Relay(const L4Relay &) = delete;
+    L4Relay &operator=(const L4Relay &) = delete;
+
+    static bool supported();
+
+    // 作为 PortScanner 的订阅回调使用, 线程安全
+    void on_snapshot(const PortScanner::SnapshotPtr &snapshot);
+
+    bool start();
+    void stop();
+
+    module::LogLimiter &limiter();
+
+private:
+    void sync_listeners(const PortScanner::Snapshot &snapshot);
+    void close_listener(Listener &listener);
+
+    // upstream_port 为 0 表示前导路由监听
+    coro::Task<> accept_loop(std::shared_ptr<Listener> listener, uint16_t upstream_port);
+    coro::Task<> read_preamble(int client_fd);
+    coro::Task<> relay(int client_fd, uint16_t upstream_port, std::string pending);
+    coro::Task<> pump(std::shared_ptr<Pipe> pipe, bool upstream_to_client);
+
+    std::chrono::milliseconds idle_timeout() const;
+};
+} // namespace xiunneg
@@ -0,0 +1,127 @@
+// route.cpp
+#include "route.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <format>
+
+using namespace xiunneg;
+
+namespace {
+// 平台错误码换算为 errno
+int to_errno(int error) {
+#ifdef _WIN32
+    switch (error) {
+    case WSAECONNREFUSED: return ECONNREFUSED;
+    case WSAEMFILE: return EMFILE;
+    case WSAETIMEDOUT: return ETIMEDOUT;
+    case WSAEWOULDBLOCK: return EINPROGRESS;
+    case WSAENAMETOOLONG: return ENAMETOOLONG;
+    default: return error == 0 ? 0 : EIO;
+    }
+#else
+    return error;
+#endif
+}
+
+int last_socket_error() {
+#ifdef _WIN32
+    return to_errno(WSAGetLastError());
+#else
+    return errno;
+#endif
+}
+} // namespace
+
+Route xiunneg::resolve_route(const httplib::Request &req, uint16_t base_port, const PortScanner::Snapshot &snapshot) {
+    Route route;
+    if (!req.has_param("machine_no")) {
+        route.error_msg = "缺少参数 machine_no";
+        return route;
+    }
+
+    try {
+        route.machine_no = std::stoi(req.get_param_value("machine_no"));
+    } catch (const std::out_of_range &e) {
+        route.error_msg = std::format("参数 machine_no[{}] 超出范围! {}", req.get_param_value("machine_no"), e.what());
+        return route;
+    } catch (const std::invalid_argument &e) {
+        route.error_msg = std::format("参数 machine_no[{}] 不是整数! {}", req.get_param_value("machine_no"), e.what());
+        return route;
+    }
+
+    auto target_sevice = static_cast<int>(base_port) + route.machine_no;
+    if (target_sevice < 0 || target_sevice > UINT16_MAX || !snapshot.ports.contains(static_cast<uint16_t>(target_sevice))) {
+        route.error_msg = std::format("该服务[{}]不存在!", req.get_param_value("machine_no"));
+        return route;
+    }
+
+    route.ok = true;
+    route.port = static_cast<uint16_t>(target_sevice);
+    if (auto it = snapshot.unix_paths.find(route.port); it != snapshot.unix_paths.end()) {
+        route.unix_path = it->second;
+    }
+    route.ipv6 = snapshot.ipv6_only.contains(route.port);
+    if (auto it = snapshot.remotes.find(route.port); it != snapshot.remotes.end()) {
+        route.remote_host = it->second.host;
+        route.remote_port = it->second.port;
+    }
+    return route;
+}
+
+std::string Route::upstream_host() const {
+    if (!unix_path.empty()) return unix_path;
+    if (!remote_host.empty()) return remote_host;
+    return ipv6 ? "::1" : "127.0.0.1";
+}
+
+uint16_t Route::upstream_port() const {
+    return remote_host.empty() ? port : remote_port;
+}
+
+int xiunneg::probe_connect_error(const Route &route, int timeout_ms) {
+    sockaddr_storage addr{};
+    socklen_t addr_len = 0;
+    auto host = route.upstream_host();
+    auto *addr4 = reinterpret_cast<sockaddr_in *>(&addr);
+    auto *addr6 = reinterpret_cast<sockaddr_in6 *>(&addr);
+    auto *addr_un = reinterpret_cast<sockaddr_un *>(&addr);
+    if (!route.unix_path.empty()) {
+        if (host.size() >= sizeof(addr_un->sun_path)) return ENAMETOOLONG;
+        addr_un->sun_family = AF_UNIX;
+        std::copy(host.begin(), host.end(), addr_un->sun_path);
+        addr_len = sizeof(sockaddr_un);
+    } else if (inet_pton(AF_INET, host.c_str(), &addr4->sin_addr) == 1) {
+        addr4->sin_family = AF_INET;
+        addr4->sin_port = htons(route.upstream_port());
+        addr_len = sizeof(sockaddr_in);
+    } else if (inet_pton(AF_INET6, host.c_str(), &addr6->sin6_addr) == 1) {
+        addr6->sin6_family = AF_INET6;
+        addr6->sin6_port = htons(route.upstream_port());
+        addr_len = sizeof(sockaddr_in6);
+    } else {
+        return EINVAL;
+    }
+
+    socket_t sock = socket(addr.ss_family, SOCK_STREAM, 0);
+    if (sock == INVALID_SOCKET) return last_socket_error();
+    httplib::detail::set_nonblocking(sock, true);
+
+    int error = 0;
+    if (connect(sock, reinterpret_cast<sockaddr *>(&addr), addr_len) != 0) {
+        error = last_socket_error();
+        // TCP 的连接结果异步得知; Unix 域套接字的 EAGAIN 为 backlog 已满, 直接返回
+        if (error == EINPROGRESS) {
+            if (httplib::detail::select_write(sock, timeout_ms / 1000, (timeout_ms % 1000) * 1000) > 0) {
+                int so_error = 0;
+                socklen_t len = sizeof(so_error);
+                getsockopt(sock, SOL_SOCKET, SO_ERROR, reinterpret_cast<char *>(&so_error), &len);
+                error = to_errno(so_error);
+            } else {
+                error = ETIMEDOUT;
+            }
+        }
+    }
+    httplib::detail::close_socket(sock);
+    return error;
+}
@@ -0,0 +1,92 @@
+// route.h
+#pragma once
+
+/**
+ * ************************************************************************
+ *
+ * @file route.h
+ * @author xiunneg
+ * @brief  转发路由,由 machine_no 参数解析目标服务,httplib 与异步引擎两条 I/O 路径共用
+ * ************************************************************************
+ * @copyright Copyright (c) 2025 xiunneg
+ * ************************************************************************
+ */
+
+#include "httplib.h"
+#include "port_scanner/port_scanner.h"
+
+#include <stdint.h>
+#include <cerrno>
+#include <chrono>
+#include <string>
+
+namespace xiunneg {
+
+struct Route {
+    bool ok = false;
+    int machine_no = 0;
+    uint16_t port = 0;     // 目标服务在快照中的端口, 远程服务时为其编号
+    std::string unix_path; // 非空时经 Unix 域套接字连接, 不走回环 TCP
+    bool ipv6 = false;     // 服务只在 IPv6 上监听, 经 ::1 连接
+    std::string remote_host; // 非空时为远程服务, 连接 remote_host:remote_port
+    uint16_t remote_port = 0;
+    std::string error_msg;
+
+    // 连接上游使用的地址: Unix 域套接字路径、远程地址或回环地址
+    std::string upstream_host() const;
+    // 连接上游使用的端口
+    uint16_t upstream_port() const;
+};
+
+// 一次上游转发的结果
+struct ForwardResult {
+    std::string error_msg;      // 为空表示成功
+    std::string body;           // 响应体, 零拷贝转发时为空
+    std::size_t body_bytes = 0; // 响应体字节数
+    bool spliced = false;       // 响应体是否已由零拷贝路径写出
+    int connect_error = 0;       // 未能连上上游时的 errno, 已连上或原因未知时为 0
+    uint16_t port = 0;           // 目标上游端口
+    int upstream_status = 0;     // 上游响应状态码, 未收到响应时为 0
+
+    // 上游确已不在监听(拒绝连接、Unix 域套接字文件不存在), 可立即退出路由;
+    // fd 耗尽、backlog 已满、超时等本机或瞬时原因不能说明服务已下线
+    bool upstream_gone() const { return connect_error == ECONNREFUSED || connect_error == ENOENT; }
+
+    // 各阶段耗时, 微秒, -1 表示该路径无法单独测量
+    std::chrono::steady_clock::time_point received{}; // 请求解析完成的时间, 访问日志以此计算总耗时
+    int64_t queue_us = -1;   // 等待工作线程或事件循环到开始转发
+    int64_t connect_us = -1; // 建立上游连接, 复用空闲连接时为 0
+    int64_t ttfb_us = -1;    // 发出请求到收到上游响应头
+};
+
+// 两个时间点之间的微秒数
+inline int64_t elapsed_us(std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
+}
+
+/**
+ * ************************************************************************
+ * @brief 解析请求的 machine_no 参数, 目标服务须在快照中
+ *
+ * @param[in] req  请求
+ * @param[in] base_port  基准端口
+ * @param[in] snapshot  当前端口快照
+ *
+ * @return 路由结果, ok 为 false 时 error_msg 为返回给客户端的错误信息
+ * ************************************************************************
+ */
+Route resolve_route(const httplib::Request &req, uint16_t base_port, const PortScanner::Snapshot &snapshot);
+
+/**
+ * ************************************************************************
+ * @brief 以一次非阻塞 connect 探测上游连不上的原因; httplib 不保留 connect 的错误码,
+ *        其 Error::Connection 由此细分, 只在转发失败时调用
+ *
+ * @param[in] route  目标服务
+ * @param[in] timeout_ms  等待连接结果的上限
+ *
+ * @return errno, 如 ECONNREFUSED、ENOENT、EMFILE、EAGAIN; 超时为 ETIMEDOUT, 此次连上为 0
+ * ************************************************************************
+ */
+int probe_connect_error(const Route &route, int timeout_ms);
+} // namespace xiunneg
@@ -0,0 +1,150 @@
+// service_registry.cpp
+#include "service_registry.h"
+
+#include <algorithm>
+#include <format>
+#include <utility>
+
+using namespace xiunneg;
+
+ServiceRegistry::ServiceRegistry(const Config &config, Logger logger) :
+    config_(config),
+    logger_(logger),
+    wheel_(std::chrono::milliseconds(config.tick_ms)) {
+    config_.tick_ms = std::max<uint32_t>(config_.tick_ms, 1);
+    config_.default_ttl_ms = std::max<uint32_t>(config_.default_ttl_ms, config_.tick_ms);
+    config_.max_ttl_ms = std::max(config_.max_ttl_ms, config_.default_ttl_ms);
+}
+
+ServiceRegistry::~ServiceRegistry() {
+    stop();
+}
+
+void ServiceRegistry::set_listener(Listener listener) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    listener_ = std::move(listener);
+    notify_locked();
+}
+
+void ServiceRegistry::run() {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        running_ = true;
+    }
+    worker_ = std::thread([this]() {
+        const auto tick = std::chrono::milliseconds(config_.tick_ms);
+        std::unique_lock<std::mutex> lock(mtx_);
+        while (running_) {
+            auto expired = wheel_.advance(TimingWheel::Clock::now());
+            for (auto id : expired) {
+                auto it = registrations_.find(id);
+                if (it == registrations_.end()) continue;
+                logger_->warn(std::format("注册服务 {}({}:{}) 心跳超时, 已移除", it->second.info.name, it->second.info.endpoint.host, it->second.info.endpoint.port));
+                keys_.erase(it->second.key);
+                registrations_.erase(it);
+            }
+            if (!expired.empty()) {
+                dirty_ = true;
+            }
+            if (std::exchange(dirty_, false) && listener_) {
+                std::map<uint16_t, PortScanner::ServiceInfo> services;
+                for (const auto &[key, id] : keys_) {
+                    services.emplace(key, registrations_.at(id).info);
+                }
+                auto listener = listener_;
+                lock.unlock();
+                listener(services);
+                lock.lock();
+            }
+            cv_.wait_for(lock, tick, [this]() {
+                return !running_ || dirty_;
+            });
+        }
+    });
+}
+
+void ServiceRegistry::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        running_ = false;
+    }
+    cv_.notify_one();
+    if (worker_.joinable())
+        worker_.join();
+}
+
+std::optional<TimingWheel::Id> ServiceRegistry::register_service(Registration registration, std::string &error_msg) {
+    if (!PortScanner::is_ip_literal(registration.info.endpoint.host)) {
+        error_msg = std::format("地址[{}] 不是 IP 字面量", registration.info.endpoint.host);
+        return std::nullopt;
+    }
+    if (registration.info.endpoint.port == 0) {
+        error_msg = "端口不能为 0";
+        return std::nullopt;
+    }
+    registration.ttl_ms = lease_ms(registration.ttl_ms);
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    TimingWheel::Id id = 0;
+    if (auto it = keys_.find(registration.key); it != keys_.end()) {
+        auto &current = registrations_.at(it->second);
+        if (current.info.endpoint != registration.info.endpoint) {
+            error_msg = std::format("编号已被 {}:{} 注册", current.info.endpoint.host, current.info.endpoint.port);
+            return std::nullopt;
+        }
+        id = it->second;
+        bool changed = current.info != registration.info;
+        current = std::move(registration);
+        wheel_.schedule(id, std::chrono::milliseconds(current.ttl_ms));
+        if (changed) notify_locked();
+        return id;
+    }
+
+    id = next_id_++;
+    logger_->info(std::format("注册服务 {}({}:{}) 编号 {}", registration.info.name, registration.info.endpoint.host, registration.info.endpoint.port, registration.key));
+    keys_.emplace(registration.key, id);
+    wheel_.schedule(id, std::chrono::milliseconds(registration.ttl_ms));
+    registrations_.emplace(id, std::move(registration));
+    notify_locked();
+    return id;
+}
+
+uint32_t ServiceRegistry::lease_ms(uint32_t ttl_ms) const {
+    if (ttl_ms == 0) return config_.default_ttl_ms;
+    return std::clamp(ttl_ms, config_.tick_ms, config_.max_ttl_ms);
+}
+
+bool ServiceRegistry::heartbeat(TimingWheel::Id id) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto it = registrations_.find(id);
+    if (it == registrations_.end()) return false;
+    wheel_.schedule(id, std::chrono::milliseconds(it->second.ttl_ms));
+    return true;
+}
+
+bool ServiceRegistry::deregister(TimingWheel::Id id) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto it = registrations_.find(id);
+    if (it == registrations_.end()) return false;
+    logger_->info(std::format("注销服务 {}({}:{})", it->second.info.name, it->second.info.endpoint.host, it->second.info.endpoint.port));
+    wheel_.cancel(id);
+    keys_.erase(it->second.key);
+    registrations_.erase(it);
+    notify_locked();
+    return true;
+}
+
+std::vector<std::pair<TimingWheel::Id, ServiceRegistry::Registration>> ServiceRegistry::list() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    std::vector<std::pair<TimingWheel::Id, Registration>> items;
+    items.reserve(keys_.size());
+    for (const auto &[key, id] : keys_) {
+        items.emplace_back(id, registrations_.at(id));
+    }
+    return items;
+}
+
+void ServiceRegistry::notify_locked() {
+    dirty_ = true;
+    cv_.notify_one();
+}
@@ -0,0 +1,101 @@
+// service_registry.h
+#pragma once
+
+/**
+ * ************************************************************************
+ *
+ * @file service_registry.h
+ * @author xiunneg
+ * @brief  服务注册表,服务主动注册并以心跳续期,过期由分层时间轮处理;
+ *         注册表变化时回调, 由端口扫描器与扫描结果合并为同一路由视图
+ * ************************************************************************
+ * @copyright Copyright (c) 2025 xiunneg
+ * ************************************************************************
+ */
+
+#include "port_scanner/port_scanner.h"
+#include "timing_wheel.h"
+
+#include <stdint.h>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace xiunneg {
+
+class ServiceRegistry {
+    using Logger = std::shared_ptr<module::SimpleLoggerInterface>;
+
+public:
+    struct Config {
+        uint32_t tick_ms = 100;          // 时间轮精度
+        uint32_t default_ttl_ms = 10000; // 未指定 ttl 时的租期
+        uint32_t max_ttl_ms = 300000;    // 租期上限
+    };
+
+    struct Registration {
+        uint16_t key;                        // 快照中的编号, base_port + machine_no
+        PortScanner::ServiceInfo info;       // 名称、地址、权重与元数据
+        uint32_t ttl_ms = 0;                 // 租期, 每次心跳重新计时
+    };
+
+    // 注册表变化时以全量 key -> 服务 回调, 在后台线程中释放注册表锁后调用, 连续变化只回调最新一版
+    using Listener = std::function<void(const std::map<uint16_t, PortScanner::ServiceInfo> &)>;
+
+private:
+    Config config_;
+    Logger logger_;
+
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    TimingWheel wheel_;
+    std::unordered_map<TimingWheel::Id, Registration> registrations_;
+    std::map<uint16_t, TimingWheel::Id> keys_; // key -> 注册 id
+    TimingWheel::Id next_id_ = 1;
+    Listener listener_;
+    bool dirty_ = false; // 有未回调的变化, 由后台线程清除
+
+    std::thread worker_;
+    bool running_ = false;
+
+public:
+    ServiceRegistry(const Config &config, Logger logger);
+    ~ServiceRegistry();
+
+    void set_listener(Listener listener);
+
+    void run();
+    void stop();
+
+    /**
+     * ************************************************************************
+     * @brief 注册服务; 同一 key 以相同地址重复注册视为续期并更新信息
+     *
+     * @param[in] registration  注册信息, ttl_ms 为 0 时使用默认租期
+     * @param[out] error_msg  失败原因
+     *
+     * @return 注册 id, key 已被其他地址占用时返回空
+     * ************************************************************************
+     */
+    std::optional<TimingWheel::Id> register_service(Registration registration, std::string &error_msg);
+
+    // 实际租期: 0 取默认值, 其余限制在 [tick_ms, max_ttl_ms]
+    uint32_t lease_ms(uint32_t ttl_ms) const;
+
+    // 心跳续期, id 不存在(已过期或注销)时返回 false, 服务应重新注册
+    bool heartbeat(TimingWheel::Id id);
+    bool deregister(TimingWheel::Id id);
+
+    std::vector<std::pair<TimingWheel::Id, Registration>> list();
+
+private:
+    // 标记变化并唤醒后台线程, 请求线程不在注册表锁内执行回调
+    void notify_locked();
+};
+} // namespace xiunneg
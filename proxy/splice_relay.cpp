@@ -0,0 +1,341 @@
+// splice_relay.cpp
+#include "splice_relay.h"
+#include "http_codec.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <format>
+#include <memory>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+using namespace xiunneg;
+
+SpliceRelay::SpliceRelay(const Config &config) :
+    config_(config) {
+}
+
+SpliceRelay::~SpliceRelay() {
+    retain({});
+}
+
+bool SpliceRelay::supported() {
+#ifdef __linux__
+    return true;
+#else
+    return false;
+#endif
+}
+
+#ifdef __linux__
+namespace {
+constexpr std::size_t kHeaderLimit = 64 * 1024;
+
+// 每个工作线程复用一对管道,中途失败的管道可能残留数据,需要重建
+struct PipePair {
+    int read_fd = -1;
+    int write_fd = -1;
+
+    ~PipePair() {
+        reset();
+    }
+
+    bool open(std::size_t size) {
+        if (read_fd >= 0) return true;
+        int fds[2];
+        if (pipe2(fds, O_CLOEXEC) != 0) return false;
+        read_fd = fds[0];
+        write_fd = fds[1];
+        fcntl(write_fd, F_SETPIPE_SZ, static_cast<int>(size));
+        return true;
+    }
+
+    void reset() {
+        if (read_fd >= 0) close(read_fd);
+        if (write_fd >= 0) close(write_fd);
+        read_fd = write_fd = -1;
+    }
+};
+
+thread_local PipePair t_pipe;
+
+// 失败返回负的 errno
+int connect_upstream(const std::string &host, uint16_t port, int timeout_sec) {
+    sockaddr_storage addr{};
+    socklen_t addr_len = 0;
+    int family = AF_INET;
+
+    auto *addr4 = reinterpret_cast<sockaddr_in *>(&addr);
+    auto *addr6 = reinterpret_cast<sockaddr_in6 *>(&addr);
+    auto *addr_un = reinterpret_cast<sockaddr_un *>(&addr);
+    if (host.starts_with('/')) {
+        if (host.size() >= sizeof(addr_un->sun_path)) return -ENAMETOOLONG;
+        family = AF_UNIX;
+        addr_un->sun_family = AF_UNIX;
+        std::copy(host.begin(), host.end(), addr_un->sun_path);
+        addr_len = sizeof(sockaddr_un);
+    } else if (inet_pton(AF_INET, host.c_str(), &addr4->sin_addr) == 1) {
+        addr4->sin_family = AF_INET;
+        addr4->sin_port = htons(port);
+        addr_len = sizeof(sockaddr_in);
+    } else if (inet_pton(AF_INET6, host.c_str(), &addr6->sin6_addr) == 1) {
+        family = AF_INET6;
+        addr6->sin6_family = AF_INET6;
+        addr6->sin6_port = htons(port);
+        addr_len = sizeof(sockaddr_in6);
+    } else {
+        return -EINVAL;
+    }
+
+    int fd = socket(family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -errno;
+
+    timeval tv{.tv_sec = timeout_sec, .tv_usec = 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    if (connect(fd, reinterpret_cast<sockaddr *>(&addr), addr_len) != 0) {
+        int error = errno;
+        close(fd);
+        return -error;
+    }
+    return fd;
+}
+
+bool send_all(int fd, const char *data, std::size_t size) {
+    while (size > 0) {
+        auto n = send(fd, data, size, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        data += n;
+        size -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+// 读取上游响应头, prefix 为随响应头读入的部分响应体; 未收到任何数据即失败时 received 为 false
+bool read_response_head(int fd, http::ResponseHead &head, std::string &prefix, bool &received) {
+    std::string buffer;
+    char chunk[16 * 1024];
+    received = false;
+
+    for (;;) {
+        auto n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0) return false;
+        received = true;
+        buffer.append(chunk, static_cast<std::size_t>(n));
+
+        std::size_t consumed{};
+        auto status = http::parse_response_head(buffer, head, consumed);
+        if (status == http::ParseStatus::ERROR) return false;
+        if (status == http::ParseStatus::COMPLETE) {
+            prefix = buffer.substr(consumed);
+            return true;
+        }
+    }
+}
+
+// 按 Content-Length / 分块编码 / 连接关闭 收取其余响应体, 连接关闭界定的响应体不可复用连接
+bool read_body(int fd, const http::ResponseHead &head, std::string_view prefix, std::string &body, bool &reusable) {
+    http::ResponseBodyReader reader(head);
+    char chunk[16 * 1024];
+    reusable = false;
+
+    auto status = reader.feed(prefix, body);
+    while (status == http::ParseStatus::INCOMPLETE) {
+        auto n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n == 0) return reader.finish_on_eof() == http::ParseStatus::COMPLETE;
+        if (n < 0) return false;
+        status = reader.feed(std::string_view(chunk, static_cast<std::size_t>(n)), body);
+    }
+    reusable = status == http::ParseStatus::COMPLETE && head.keep_alive;
+    return status == http::ParseStatus::COMPLETE;
+}
+
+// 将 remaining 字节经管道从 from 搬运到 to
+bool splice_body(int from, int to, std::size_t remaining, std::size_t pipe_size) {
+    if (!t_pipe.open(pipe_size)) return false;
+
+    while (remaining > 0) {
+        auto in = splice(from, nullptr, t_pipe.write_fd, nullptr,
+                         std::min(remaining, pipe_size), SPLICE_F_MOVE | SPLICE_F_MORE);
+        if (in <= 0) return false;
+
+        auto pending = static_cast<std::size_t>(in);
+        while (pending > 0) {
+            auto out = splice(t_pipe.read_fd, nullptr, to, nullptr,
+                              pending, SPLICE_F_MOVE | SPLICE_F_MORE);
+            if (out <= 0) return false;
+            pending -= static_cast<std::size_t>(out);
+        }
+        remaining -= static_cast<std::size_t>(in);
+    }
+    return true;
+}
+
+struct SpliceState {
+    int upstream_fd;
+    int client_fd;
+    std::size_t pipe_size = 0;
+    std::size_t remaining = 0; // 尚未从上游读出的响应体字节数
+    std::string prefix;
+
+    SpliceState(int upstream, int client) :
+        upstream_fd(upstream),
+        client_fd(client) {
+    }
+    SpliceState(const SpliceState &) = delete;
+    SpliceState &operator=(const SpliceState &) = delete;
+
+    ~SpliceState() {
+        close(upstream_fd);
+    }
+};
+} // namespace
+#endif // __linux__
+
+SpliceRelay::Result SpliceRelay::forward(const Route &route, const httplib::Request &req, httplib::Response &res, socket_t client_sock) {
+    Result result;
+#ifdef __linux__
+    if (client_sock == INVALID_SOCKET) {
+        result.error_msg = "客户端套接字不可用";
+        return result;
+    }
+
+    const auto host = route.upstream_host();
+    const auto port = route.upstream_port();
+    const auto request = http::build_upstream_request(req, true);
+
+    for (;;) {
+        auto connect_begin = std::chrono::steady_clock::now();
+        int upstream_fd = acquire(route.port, host, port);
+        bool reused = upstream_fd >= 0;
+        if (!reused) {
+            upstream_fd = connect_upstream(host, port, config_.timeout_sec);
+        }
+        auto request_begin = std::chrono::steady_clock::now();
+        result.connect_us = reused ? 0 : elapsed_us(connect_begin, request_begin);
+        if (upstream_fd < 0) {
+            result.error_msg = std::format("连接上游 {}:{} 失败: {}", host, port, std::strerror(-upstream_fd));
+            result.connect_error = -upstream_fd;
+            return result;
+        }
+
+        http::ResponseHead head;
+        std::string prefix;
+        bool received = false;
+        if (!send_all(upstream_fd, request.data(), request.size()) || !read_response_head(upstream_fd, head, prefix, received)) {
+            close(upstream_fd);
+            // 空闲连接已被上游关闭时换一条新连接重试, 新建的连接不重试
+            if (reused && !received) continue;
+            result.error_msg = std::format("读取上游 {}:{} 响应头失败", host, port);
+            return result;
+        }
+        result.ttfb_us = elapsed_us(request_begin, std::chrono::steady_clock::now());
+        result.upstream_status = head.status;
+
+        // 定长且足够大的响应体走零拷贝, 搬运完后关闭上游连接
+        if (!head.chunked && head.has_length
+            && head.content_length >= config_.min_splice_bytes
+            && prefix.size() <= head.content_length) {
+            auto state = std::make_shared<SpliceState>(upstream_fd, client_sock);
+            state->pipe_size = config_.pipe_size;
+            state->remaining = head.content_length - prefix.size();
+            state->prefix = std::move(prefix);
+
+            res.set_header("Content-Length", std::to_string(head.content_length));
+            res.set_content_provider(
+                "application/json",
+                [state](size_t, httplib::DataSink &sink) {
+                    if (!state->prefix.empty()) {
+                        if (!sink.write(state->prefix.data(), state->prefix.size())) return false;
+                        state->prefix.clear();
+                    }
+                    if (!splice_body(state->upstream_fd, state->client_fd, state->remaining, state->pipe_size)) {
+                        t_pipe.reset();
+                        return false;
+                    }
+                    state->remaining = 0;
+                    sink.done();
+                    return true;
+                });
+
+            result.ok = true;
+            result.spliced = true;
+            result.body_bytes = head.content_length;
+            return result;
+        }
+
+        // 其余响应体读入用户态, 完整读完且上游允许时连接留待复用
+        std::string body;
+        bool reusable = false;
+        if (!read_body(upstream_fd, head, prefix, body, reusable)) {
+            close(upstream_fd);
+            result.error_msg = std::format("读取上游 {}:{} 响应体失败", host, port);
+            return result;
+        }
+        if (reusable) {
+            release(route.port, {upstream_fd, host, port});
+        } else {
+            close(upstream_fd);
+        }
+
+        result.ok = true;
+        result.body_bytes = body.size();
+        result.body = std::move(body);
+        return result;
+    }
+#else
+    result.error_msg = "当前平台不支持 splice 零拷贝转发";
+    return result;
+#endif
+}
+
+void SpliceRelay::retain(const std::set<uint16_t> &ports) {
+    std::unique_lock lck(pool_mtx_);
+    std::erase_if(idle_upstreams_, [&ports](auto &item) {
+        if (ports.contains(item.first)) return false;
+#ifdef __linux__
+        for (auto &upstream : item.second) close(upstream.fd);
+#endif
+        return true;
+    });
+}
+
+int SpliceRelay::acquire(uint16_t route_port, const std::string &host, uint16_t port) {
+#ifdef __linux__
+    std::unique_lock lck(pool_mtx_);
+    auto it = idle_upstreams_.find(route_port);
+    while (it != idle_upstreams_.end() && !it->second.empty()) {
+        auto upstream = std::move(it->second.back());
+        it->second.pop_back();
+        // 服务地址变化(TCP/IPv6/Unix 域套接字/远程)后, 旧连接直接关闭
+        if (upstream.host == host && upstream.port == port) {
+            return upstream.fd;
+        }
+        close(upstream.fd);
+    }
+#endif
+    return -1;
+}
+
+void SpliceRelay::release(uint16_t route_port, IdleUpstream upstream) {
+#ifdef __linux__
+    std::unique_lock lck(pool_mtx_);
+    auto &upstreams = idle_upstreams_[route_port];
+    if (upstreams.size() < config_.max_idle_per_port) {
+        upstreams.push_back(std::move(upstream));
+        return;
+    }
+    lck.unlock();
+    close(upstream.fd);
+#endif
+}
@@ -0,0 +1,101 @@
+// splice_relay.h
+#pragma once
+
+/**
+ * ************************************************************************
+ *
+ * @file splice_relay.h
+ * @author xiunneg
+ * @brief  仅支持 Linux 平台,基于 splice 的零拷贝转发:
+ *         响应头在用户态解析后,响应体经由管道在上游套接字与客户端套接字之间搬运,
+ *         不进入用户态内存; 读入用户态的响应结束后上游连接按端口保留复用
+ * ************************************************************************
+ * @copyright Copyright (c) 2025 xiunneg
+ * ************************************************************************
+ */
+
+#include "httplib.h"
+#include "route.h"
+
+#include <stdint.h>
+#include <set>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace xiunneg {
+
+class SpliceRelay {
+public:
+    struct Config {
+        std::size_t min_splice_bytes = 1 << 20; // 响应体达到该大小才走零拷贝,否则读入用户态
+        std::size_t pipe_size = 1 << 20;        // 管道容量
+        int timeout_sec = 5;                    // 上游读写超时,秒
+        std::size_t max_idle_per_port = 32;     // 每个端口最多保留的空闲上游连接
+    };
+
+    struct Result {
+        bool ok = false;
+        bool spliced = false;       // 响应体是否经由 splice 转发
+        std::size_t body_bytes = 0; // 响应体字节数
+        std::string body;            // 未走零拷贝时读入用户态的响应体
+        int connect_error = 0;       // 未能连上上游时的 errno
+        int upstream_status = 0;     // 上游响应状态码
+        int64_t connect_us = -1;     // 建立上游连接耗时, 微秒
+        int64_t ttfb_us = -1;        // 发出请求到读完上游响应头, 微秒
+        std::string error_msg;
+    };
+
+private:
+    // 保持连接的空闲上游, 服务地址变化后丢弃
+    struct IdleUpstream {
+        int fd = -1;
+        std::string host;
+        uint16_t port = 0;
+    };
+
+    Config config_;
+
+    std::mutex pool_mtx_;
+    std::unordered_map<uint16_t, std::vector<IdleUpstream>> idle_upstreams_;
+
+public:
+    explicit SpliceRelay(const Config &config);
+    ~SpliceRelay();
+
+    SpliceRelay(const SpliceRelay &) = delete;
+    SpliceRelay &operator=(const SpliceRelay &) = delete;
+
+    static bool supported();
+
+    /**
+     * ************************************************************************
+     * @brief 向上游发起 GET 请求并填充响应,响应体足够大时零拷贝写入 client_sock;
+     *        读入用户态的响应完整结束且上游允许时, 连接归还到 route.port 的空闲连接中
+     *
+     * @param[in] route  已解析的路由, 连接 route.upstream_host():route.upstream_port()
+     * @param[in] req  客户端请求
+     * @param[out] res  客户端响应
+     * @param[in] client_sock  客户端套接字,见 GatewayServer::current_socket
+     *
+     * @return 转发结果, ok 为 false 时 res 未被修改; 未走零拷贝时响应体在 body 中, 由调用方写入 res
+     * ************************************************************************
+     */
+    Result forward(const Route &route, const httplib::Request &req, httplib::Response &res, socket_t client_sock);
+
+    /**
+     * ************************************************************************
+     * @brief 关闭不在端口集合中的空闲连接
+     *
+     * @param[in] ports  当前存活的端口集合
+     * ************************************************************************
+     */
+    void retain(const std::set<uint16_t> &ports);
+
+private:
+    // 取出一条到 host:port 的空闲连接, 没有时返回 -1
+    int acquire(uint16_t route_port, const std::string &host, uint16_t port);
+    void release(uint16_t route_port, IdleUpstream upstream);
+};
+} // namespace xiunneg
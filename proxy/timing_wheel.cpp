@@ -0,0 +1,82 @@
+// timing_wheel.cpp
+#include "timing_wheel.h"
+
+#include <algorithm>
+
+using namespace xiunneg;
+
+TimingWheel::TimingWheel(std::chrono::milliseconds tick, Clock::time_point start) :
+    tick_(std::max(tick, std::chrono::milliseconds(1))),
+    start_(start) {
+}
+
+void TimingWheel::schedule(Id id, std::chrono::milliseconds delay) {
+    // 向上取整, 至少下一个 tick
+    auto ticks = static_cast<uint64_t>(std::max<int64_t>(1, (delay.count() + tick_.count() - 1) / tick_.count()));
+
+    auto it = entries_.find(id);
+    if (it != entries_.end()) {
+        slots_[it->second.level][it->second.slot].erase(it->second.it);
+    } else {
+        it = entries_.emplace(id, Entry{}).first;
+    }
+    it->second.expire_tick = current_tick_ + ticks;
+    place(id, it->second);
+}
+
+void TimingWheel::cancel(Id id) {
+    auto it = entries_.find(id);
+    if (it == entries_.end()) return;
+    slots_[it->second.level][it->second.slot].erase(it->second.it);
+    entries_.erase(it);
+}
+
+std::vector<TimingWheel::Id> TimingWheel::advance(Clock::time_point now) {
+    std::vector<Id> expired;
+    auto target = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(now - start_).count() / tick_.count());
+
+    while (current_tick_ < target) {
+        ++current_tick_;
+        // 第 0 层绕回时, 上一层当前槽位的条目均在未来 64 个 tick 内到期;
+        // 多层同时绕回时先下放高层, 使其条目能继续落入低层当前槽位再被下放
+        int top = 0;
+        while (top + 1 < kLevels && (current_tick_ & ((1ull << (kSlotBits * (top + 1))) - 1)) == 0) {
+            ++top;
+        }
+        for (int level = top; level >= 1; --level) {
+            cascade(level);
+        }
+
+        auto &slot = slots_[0][current_tick_ & (kSlots - 1)];
+        while (!slot.empty()) {
+            auto id = slot.front();
+            slot.pop_front();
+            entries_.erase(id);
+            expired.push_back(id);
+        }
+    }
+    return expired;
+}
+
+void TimingWheel::place(Id id, Entry &entry) {
+    auto delta = entry.expire_tick - current_tick_;
+    int level = 0;
+    while (level + 1 < kLevels && delta >= (1ull << (kSlotBits * (level + 1)))) {
+        ++level;
+    }
+    // 超出最高层范围的条目放在最高层, 下放时重新计算
+    auto expire = std::min<uint64_t>(entry.expire_tick, current_tick_ + (1ull << (kSlotBits * kLevels)) - 1);
+    entry.level = level;
+    entry.slot = (expire >> (kSlotBits * level)) & (kSlots - 1);
+    auto &slot = slots_[level][entry.slot];
+    entry.it = slot.insert(slot.end(), id);
+}
+
+void TimingWheel::cascade(int level) {
+    auto &slot = slots_[level][(current_tick_ >> (kSlotBits * level)) & (kSlots - 1)];
+    auto ids = std::move(slot);
+    slot.clear();
+    for (auto id : ids) {
+        place(id, entries_.at(id));
+    }
+}
@@ -0,0 +1,72 @@
+// timing_wheel.h
+#pragma once
+
+/**
+ * ************************************************************************
+ *
+ * @file timing_wheel.h
+ * @author xiunneg
+ * @brief  分层时间轮,按 id 调度到期事件,调度、续期、取消与每个 tick 的推进均为 O(1),
+ *         非线程安全,由调用方加锁
+ * ************************************************************************
+ * @copyright Copyright (c) 2025 xiunneg
+ * ************************************************************************
+ */
+
+#include <stdint.h>
+#include <array>
+#include <chrono>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+namespace xiunneg {
+
+class TimingWheel {
+public:
+    using Id = uint64_t;
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr int kLevels = 4;
+    static constexpr int kSlotBits = 6;
+    static constexpr uint64_t kSlots = 1ull << kSlotBits; // 每层槽数, 4 层共覆盖 64^4 个 tick
+
+private:
+    struct Entry {
+        uint64_t expire_tick;
+        int level;
+        uint64_t slot;
+        std::list<Id>::iterator it;
+    };
+
+    std::chrono::milliseconds tick_;
+    Clock::time_point start_;
+    uint64_t current_tick_ = 0;
+
+    std::array<std::array<std::list<Id>, kSlots>, kLevels> slots_;
+    std::unordered_map<Id, Entry> entries_;
+
+public:
+    explicit TimingWheel(std::chrono::milliseconds tick, Clock::time_point start = Clock::now());
+
+    // 在 delay 后到期, id 已存在时改为新的到期时间(续期)
+    void schedule(Id id, std::chrono::milliseconds delay);
+    void cancel(Id id);
+    std::size_t size() const { return entries_.size(); }
+
+    /**
+     * ************************************************************************
+     * @brief 推进到 now, 逐 tick 处理, 仅在低层槽位绕回时把上层槽位的条目下放
+     *
+     * @param[in] now  当前时间
+     *
+     * @return 到期的 id, 已从时间轮中移除
+     * ************************************************************************
+     */
+    std::vector<Id> advance(Clock::time_point now);
+
+private:
+    void place(Id id, Entry &entry);
+    void cascade(int level);
+};
+} // namespace xiunneg
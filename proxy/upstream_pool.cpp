@@ -0,0 +1,48 @@
+// upstream_pool.cpp
+#include "upstream_pool.h"
+
+using namespace xiunneg;
+
+UpstreamPool::UpstreamPool(std::size_t max_idle_per_port) :
+    max_idle_per_port_(max_idle_per_port) {
+}
+
+UpstreamPool::ClientPtr UpstreamPool::acquire(const Route &route) {
+    // httplib 以 host 保存 Unix 域套接字路径
+    const auto host = route.upstream_host();
+    const auto port = route.upstream_port();
+    {
+        std::unique_lock lck(pool_mtx_);
+        auto it = idle_clients_.find(route.port);
+        while (it != idle_clients_.end() && !it->second.empty()) {
+            auto client = std::move(it->second.back());
+            it->second.pop_back();
+            // 服务地址变化(TCP/IPv6/Unix 域套接字/远程)后, 旧连接直接丢弃
+            if (client->host() == host && client->port() == port) {
+                return client;
+            }
+        }
+    }
+
+    auto client = std::make_unique<httplib::Client>(host, port);
+    if (!route.unix_path.empty()) {
+        client->set_address_family(AF_UNIX);
+    }
+    client->set_keep_alive(true);
+    return client;
+}
+
+void UpstreamPool::release(uint16_t port, ClientPtr client) {
+    std::unique_lock lck(pool_mtx_);
+    auto &clients = idle_clients_[port];
+    if (clients.size() < max_idle_per_port_) {
+        clients.push_back(std::move(client));
+    }
+}
+
+void UpstreamPool::retain(const std::set<uint16_t> &ports) {
+    std::unique_lock lck(pool_mtx_);
+    std::erase_if(idle_clients_, [&ports](const auto &item) {
+        return !ports.contains(item.first);
+    });
+}
@@ -0,0 +1,72 @@
+// upstream_pool.h
+#pragma once
+
+/**
+ * ************************************************************************
+ *
+ * @file upstream_pool.h
+ * @author xiunneg
+ * @brief  上游连接池,按端口缓存保持长连接的 httplib::Client,由单个分片独占;
+ *         服务注册了 Unix 域套接字时经 AF_UNIX 连接
+ * ************************************************************************
+ * @copyright Copyright (c) 2025 xiunneg
+ * ************************************************************************
+ */
+
+#include "httplib.h"
+#include "route.h"
+
+#include <stdint.h>
+#include <set>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <unordered_map>
+
+namespace xiunneg {
+
+class UpstreamPool {
+public:
+    using ClientPtr = std::unique_ptr<httplib::Client>;
+
+private:
+    std::size_t max_idle_per_port_; // 每个端口最多缓存的空闲连接
+
+    std::mutex pool_mtx_;
+    std::unordered_map<uint16_t, std::vector<ClientPtr>> idle_clients_;
+
+public:
+    explicit UpstreamPool(std::size_t max_idle_per_port = 32);
+
+    /**
+     * ************************************************************************
+     * @brief 取出一个到路由目标的客户端,无空闲连接时新建
+     *
+     * @param[in] route  已解析的路由, 按 route.port 归类空闲连接
+     *
+     * @return 客户端,用完后通过 release(route.port, ...) 归还
+     * ************************************************************************
+     */
+    ClientPtr acquire(const Route &route);
+
+    /**
+     * ************************************************************************
+     * @brief 归还客户端,仅应归还请求成功的客户端
+     *
+     * @param[in] port  上游端口
+     * @param[in] client  客户端
+     * ************************************************************************
+     */
+    void release(uint16_t port, ClientPtr client);
+
+    /**
+     * ************************************************************************
+     * @brief 丢弃不在端口集合中的空闲连接
+     *
+     * @param[in] ports  当前存活的端口集合
+     * ************************************************************************
+     */
+    void retain(const std::set<uint16_t> &ports);
+};
+} // namespace xiunneg
@@ -9,12 +9,98 @@ if __name__ == "__main__":
     base["port"] = 11000
 
     scanner = {}
-    scanner["begin"] = 5600
-    scanner["end"] = 5620
-    scanner["scan_interval"] = 5
+    scanner["ranges"] = [{"begin": 5600, "end": 5620}]
+    scanner["min_scan_interval_ms"] = 100
+    scanner["max_scan_interval_ms"] = 5000
+    scanner["snapshot_path"] = ""
+    scanner["shm_name"] = ""
+
+    gateway = {}
+    gateway["shards"] = 1
+    gateway["worker_threads"] = 0
+    gateway["pin_cores"] = False
+    gateway["journal_size"] = 256
+    gateway["max_streams"] = 0
+
+    relay = {}
+    relay["splice"] = False
+    relay["splice_min_bytes"] = 1048576
+
+    engine = {}
+    engine["type"] = "httplib"
+    engine["buffers"] = 1024
+    engine["buffer_size"] = 16384
+
+    l4 = {}
+    l4["listen_base"] = 0
+    l4["preamble_port"] = 0
+    l4["idle_timeout_sec"] = 5
+
+    unix = {}
+    unix["socket_dir"] = ""
+    unix["sockets"] = {}
+
+    remote = {}
+    remote["timeout_ms"] = 200
+    remote["max_in_flight"] = 4096
+    remote["ports"] = [{"begin": 7000, "end": 7019}]
+    remote["hosts"] = []
+
+    registry = {}
+    registry["tick_ms"] = 100
+    registry["default_ttl_ms"] = 10000
+    registry["max_ttl_ms"] = 300000
+
+    admin = {}
+    admin["allow"] = ["127.0.0.1", "::1"]
+
+    gossip = {}
+    gossip["bind"] = ""
+    gossip["port"] = 7946
+    gossip["advertise_host"] = "127.0.0.1"
+    gossip["seeds"] = []
+    gossip["secret"] = ""
+    gossip["period_ms"] = 200
+    gossip["suspect_timeout_ms"] = 2000
+
+    access_log = {}
+    access_log["path"] = "access.log"
+    access_log["format"] = "json"
+    access_log["buffer_bytes"] = 65536
+    access_log["flush_interval_ms"] = 1000
+
+    log = {}
+    log["level"] = "info"
+    log["levels"] = {}
+    log["rotate_mb"] = 0
+    log["rotate_interval_s"] = 0
+    log["retention"] = 7
+    log["compress"] = True
+    log["sinks"] = {}
+    log["default_sinks"] = []
+    log["logger_sinks"] = {}
+    log["suppress_burst"] = 10
+    log["suppress_window_ms"] = 1000
+    log["suppress_max_keys"] = 1024
+    log["info_sample_percent"] = 100
+    log["binary"] = False
+    log["binary_path"] = "gateway.blog"
+    log["buffer_bytes"] = 1048576
+    log["flush_interval_ms"] = 100
 
     config["base"] = base
     config["scanner"] = scanner
+    config["gateway"] = gateway
+    config["relay"] = relay
+    config["engine"] = engine
+    config["l4"] = l4
+    config["remote"] = remote
+    config["unix"] = unix
+    config["registry"] = registry
+    config["admin"] = admin
+    config["gossip"] = gossip
+    config["access_log"] = access_log
+    config["log"] = log
 
     with open("config/config.json", "w", encoding="utf-8") as f:
         json.dump(config, f, indent=4)
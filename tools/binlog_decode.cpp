@@ -0,0 +1,341 @@
+// binlog_decode.cpp
+// 二进制日志解码工具: Binlog_Decode <file> [-v]
+// 按调用点的格式串还原文本, 输出格式与 SimpleLogger 相同; -v 时在行尾附加源文件与行号
+#include "simple_log/binary_log.h"
+
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <optional>
+#include <string>
+#include <variant>
+#include <vector>
+
+#ifdef WIN32
+#include <Windows.h>
+class CHCP {
+public:
+    CHCP() {
+        SetConsoleOutputCP(65001);
+    }
+} chcp;
+#endif // WIN32
+
+using namespace module;
+
+using Arg = std::variant<int64_t, uint64_t, double, bool, std::string>;
+
+struct Site {
+    LogLevel level;
+    uint32_t line;
+    std::string file;
+    std::string format;
+    std::vector<binlog::ArgType> args;
+};
+
+struct Record {
+    uint64_t ticks;
+    uint32_t site;
+    uint16_t logger;
+    std::vector<Arg> args;
+};
+
+struct Clock {
+    uint64_t ticks;
+    int64_t unix_ns;
+};
+
+// 顺序读取, 越界时返回 false
+class Reader {
+    const char *pos_;
+    const char *end_;
+
+public:
+    Reader(const char *begin, const char *end) :
+        pos_(begin),
+        end_(end) {}
+
+    bool done() const { return pos_ >= end_; }
+    std::size_t remaining() const { return static_cast<std::size_t>(end_ - pos_); }
+
+    template <typename T>
+    bool get(T &value) {
+        if (remaining() < sizeof(T)) return false;
+        std::memcpy(&value, pos_, sizeof(T));
+        pos_ += sizeof(T);
+        return true;
+    }
+
+    bool get_string(std::string &text) {
+        uint32_t length = 0;
+        if (!get(length) || remaining() < length) return false;
+        text.assign(pos_, length);
+        pos_ += length;
+        return true;
+    }
+
+    bool get_block(Reader &block, std::size_t length) {
+        if (remaining() < length) return false;
+        block = Reader(pos_, pos_ + length);
+        pos_ += length;
+        return true;
+    }
+
+    bool starts_with(std::string_view prefix) const {
+        return remaining() >= prefix.size() && std::string_view(pos_, prefix.size()) == prefix;
+    }
+
+    void skip(std::size_t bytes) { pos_ += std::min(bytes, remaining()); }
+};
+
+// 一次进程运行写入的内容, 以文件头分隔
+struct Segment {
+    std::vector<Site> sites;
+    std::map<uint16_t, std::string> loggers;
+    std::vector<std::vector<Record>> blocks;
+    std::vector<Clock> clocks;
+    uint64_t dropped = 0;
+};
+
+static bool read_arg(Reader &reader, binlog::ArgType type, Arg &arg) {
+    switch (type) {
+    case binlog::ArgType::INT: {
+        int64_t value;
+        if (!reader.get(value)) return false;
+        arg = value;
+        return true;
+    }
+    case binlog::ArgType::UINT: {
+        uint64_t value;
+        if (!reader.get(value)) return false;
+        arg = value;
+        return true;
+    }
+    case binlog::ArgType::FLOAT: {
+        double value;
+        if (!reader.get(value)) return false;
+        arg = value;
+        return true;
+    }
+    case binlog::ArgType::BOOL: {
+        uint8_t value;
+        if (!reader.get(value)) return false;
+        arg = value != 0;
+        return true;
+    }
+    case binlog::ArgType::STRING: {
+        std::string value;
+        if (!reader.get_string(value)) return false;
+        arg = std::move(value);
+        return true;
+    }
+    }
+    return false;
+}
+
+static bool parse(Reader &reader, std::vector<Segment> &segments, std::string &error) {
+    const std::string_view magic(binlog::FILE_MAGIC, sizeof(binlog::FILE_MAGIC));
+    while (!reader.done()) {
+        if (reader.starts_with(magic)) {
+            reader.skip(magic.size());
+            segments.emplace_back();
+            continue;
+        }
+        if (segments.empty()) {
+            error = "文件头无效";
+            return false;
+        }
+        auto &segment = segments.back();
+
+        binlog::BlockKind kind;
+        uint32_t length = 0;
+        Reader block(nullptr, nullptr);
+        if (!reader.get(kind) || !reader.get(length) || !reader.get_block(block, length)) {
+            error = "文件不完整";
+            return false;
+        }
+
+        switch (kind) {
+        case binlog::BlockKind::SITE: {
+            uint32_t id = 0;
+            Site site;
+            uint8_t count = 0;
+            if (!block.get(id) || !block.get(site.level) || !block.get(site.line) ||
+                !block.get_string(site.file) || !block.get_string(site.format) || !block.get(count)) {
+                error = "调用点块损坏";
+                return false;
+            }
+            site.args.resize(count);
+            for (auto &type : site.args) {
+                if (!block.get(type)) {
+                    error = "调用点块损坏";
+                    return false;
+                }
+            }
+            if (segment.sites.size() <= id) segment.sites.resize(id + 1);
+            segment.sites[id] = std::move(site);
+            break;
+        }
+        case binlog::BlockKind::LOGGER: {
+            uint16_t id = 0;
+            std::string name;
+            if (!block.get(id) || !block.get_string(name)) {
+                error = "日志器块损坏";
+                return false;
+            }
+            segment.loggers[id] = std::move(name);
+            break;
+        }
+        case binlog::BlockKind::CLOCK: {
+            Clock clock;
+            if (!block.get(clock.ticks) || !block.get(clock.unix_ns) || !block.get(segment.dropped)) {
+                error = "时钟块损坏";
+                return false;
+            }
+            segment.clocks.push_back(clock);
+            break;
+        }
+        case binlog::BlockKind::RECORDS: {
+            auto &records = segment.blocks.emplace_back();
+            while (!block.done()) {
+                Record record;
+                if (!block.get(record.site) || !block.get(record.logger) || !block.get(record.ticks) ||
+                    record.site >= segment.sites.size()) {
+                    error = "记录损坏";
+                    return false;
+                }
+                for (auto type : segment.sites[record.site].args) {
+                    if (!read_arg(block, type, record.args.emplace_back())) {
+                        error = "记录参数损坏";
+                        return false;
+                    }
+                }
+                records.push_back(std::move(record));
+            }
+            break;
+        }
+        default:
+            // 未知块跳过, 兼容后续新增的块类型
+            break;
+        }
+    }
+    return true;
+}
+
+// 按格式串逐个替换 {...}, 每个替换字段单独交给 std::vformat 以保留格式说明
+static std::string format_message(const std::string &format, const std::vector<Arg> &args) {
+    std::string out;
+    std::size_t next = 0;
+    for (std::size_t i = 0; i < format.size(); ++i) {
+        char c = format[i];
+        if ((c == '{' || c == '}') && i + 1 < format.size() && format[i + 1] == c) {
+            out += c;
+            ++i;
+            continue;
+        }
+        if (c != '{') {
+            out += c;
+            continue;
+        }
+        auto close = format.find('}', i);
+        if (close == std::string::npos || next >= args.size()) {
+            out.append(format, i);
+            break;
+        }
+        auto field = "{" + format.substr(i + 1, close - i - 1) + "}";
+        try {
+            out += std::visit([&field](const auto &value) {
+                return std::vformat(field, std::make_format_args(value));
+            }, args[next]);
+        } catch (const std::format_error &) {
+            out += field;
+        }
+        ++next;
+        i = close;
+    }
+    return out;
+}
+
+static std::string timestamp(int64_t unix_ns) {
+    auto seconds = static_cast<std::time_t>(unix_ns / 1000000000);
+    auto ms = (unix_ns / 1000000) % 1000;
+
+    std::tm tm_snapshot;
+#if defined(_MSC_VER)
+    localtime_s(&tm_snapshot, &seconds);
+#else
+    localtime_r(&seconds, &tm_snapshot);
+#endif
+    char buffer[64];
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &tm_snapshot);
+    return std::format("{}.{:03}", buffer, ms);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::cerr << "用法: " << argv[0] << " <file> [-v]" << std::endl;
+        return 1;
+    }
+    bool verbose = argc > 2 && std::string_view(argv[2]) == "-v";
+
+    std::ifstream file(argv[1], std::ios::in | std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "无法打开 " << argv[1] << std::endl;
+        return 1;
+    }
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    std::vector<Segment> segments;
+    std::string error;
+    Reader reader(content.data(), content.data() + content.size());
+    bool ok = parse(reader, segments, error);
+
+    for (auto &segment : segments) {
+        // 以首尾两次校准线性换算, 只有一次校准时时间戳计数按纳秒处理
+        std::optional<Clock> first, last;
+        if (!segment.clocks.empty()) {
+            first = segment.clocks.front();
+            last = segment.clocks.back();
+        }
+        double ns_per_tick = 1.0;
+        if (first && last && last->ticks > first->ticks) {
+            ns_per_tick = static_cast<double>(last->unix_ns - first->unix_ns) / static_cast<double>(last->ticks - first->ticks);
+        }
+        auto to_unix_ns = [&](uint64_t ticks) {
+            if (!first) return static_cast<int64_t>(0);
+            return first->unix_ns + static_cast<int64_t>((static_cast<double>(ticks) - static_cast<double>(first->ticks)) * ns_per_tick);
+        };
+
+        for (auto &records : segment.blocks) {
+            // 同一块内来自多个线程的缓冲区, 按时间戳归并
+            std::stable_sort(records.begin(), records.end(), [](const Record &a, const Record &b) {
+                return a.ticks < b.ticks;
+            });
+            for (const auto &record : records) {
+                const auto &site = segment.sites[record.site];
+                auto logger = segment.loggers.find(record.logger);
+                std::cout << std::format("[{}][{}][{}] {}",
+                                         timestamp(to_unix_ns(record.ticks)),
+                                         logger != segment.loggers.end() ? logger->second : std::to_string(record.logger),
+                                         level_name(site.level),
+                                         format_message(site.format, record.args));
+                if (verbose) {
+                    std::cout << std::format(" ({}:{})", site.file, site.line);
+                }
+                std::cout << '\n';
+            }
+        }
+        if (segment.dropped > 0) {
+            std::cerr << "缓冲区已满丢弃 " << segment.dropped << " 条记录" << std::endl;
+        }
+    }
+
+    if (!ok) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    return 0;
+}